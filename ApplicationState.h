@@ -5,10 +5,13 @@
 #ifndef SLIDING_WINDOW_APPLICATIONSTATE_H
 #define SLIDING_WINDOW_APPLICATIONSTATE_H
 
+#include <stdio.h>
 #include <sys/stat.h>
+#include <functional>
 #include <vector>
 
 #include "ConnectionSettings.h"
+#include "Trace.h"
 
 using namespace std;
 
@@ -16,8 +19,23 @@ enum Role {
     NO_ROLE, CLIENT, SERVER
 };
 
+/* Lets an application embedding the engine supply the data it sends and take the data it receives, in place of files on
+ * disk. Any stream stdio can read or write will do, such as one from fmemopen() or fopencookie(). Streams aren't resumed,
+ * patched with a delta or deduplicated, as those need the file itself
+ */
+struct DataStreams {
+    function<FILE *(const string &name, uint64_t &size)> openSource; // Client - the data to send as name, and its size
+    function<FILE *(const string &name)> openSink; // Server - where the data received as name is written, in order
+};
+
 struct ApplicationState {
     bool verbose = false;
+    bool interactive = true; // Prompt for settings not given on the command line, rather than take their defaults
+    bool serveOnce = false; // Server - exit after the first connection
+    FILE *console = stdout; // Where connections report their progress; NULL silences them
+    DataStreams streams; // Files on disk unless set
+    string tracePath; // Binary trace of the packets, rewritten after each connection; empty disables tracing
+    int traceLevel = TRACE_LEVEL_PACKETS; // How much is traced when tracePath is set
     Role role = NO_ROLE;
     struct ConnectionSettings connectionSettings{};
 
@@ -28,6 +46,7 @@ struct ApplicationState {
 
     string filePath;
     string fileName;
+    vector<string> filePaths; // Client - every file to send, in order, over the one connection; filePath is the first
     struct stat fileStats{};
 };
 
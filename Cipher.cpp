@@ -0,0 +1,215 @@
+//
+// Created on 10/19/26.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/rand.h>
+
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "Cipher.h"
+
+CipherSuite preferredCipher() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("aes") && __builtin_cpu_supports("pclmul")) return AES_256_GCM;
+#elif defined(__aarch64__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    if ((hwcap & HWCAP_AES) && (hwcap & HWCAP_PMULL)) return AES_256_GCM;
+#endif
+    return CHACHA20_POLY1305;
+}
+
+const char *cipherName(CipherSuite suite) {
+    switch (suite) {
+        case AES_256_GCM:
+            return "AES-256-GCM";
+        case CHACHA20_POLY1305:
+            return "ChaCha20-Poly1305";
+        default:
+            return "none";
+    }
+}
+
+bool loadPsk(const string &path, vector<unsigned char> &psk) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == NULL) return false;
+
+    psk.resize(CIPHER_MAX_PSK_BYTES);
+    psk.resize(fread(psk.data(), 1, psk.size(), file));
+    fclose(file);
+
+    return psk.size() >= CIPHER_MIN_PSK_BYTES;
+}
+
+PacketCipher::PacketCipher(CipherSuite suite, const vector<unsigned char> &psk, bool client) : suite(suite), client(client), psk(psk) {
+    // The client's early key is all it needs to start sending. The server's own waits on the client's salt
+    if (client) {
+        RAND_bytes(clientSalt, CIPHER_SALT_BYTES);
+        sealCtx = keyed(true, CLIENT_EARLY_KEY);
+        sealEarly = true;
+    }
+}
+
+PacketCipher::~PacketCipher() {
+    EVP_CIPHER_CTX_free(sealCtx);
+    EVP_CIPHER_CTX_free(openCtx);
+    EVP_CIPHER_CTX_free(earlyCtx);
+}
+
+// Derives one of the connection's keys and sets up a context that seals or opens with it. The key schedule is worked out
+// here once, leaving each packet only its nonce to set
+EVP_CIPHER_CTX *PacketCipher::keyed(bool encrypt, Key key) {
+    unsigned char salt[2 * CIPHER_SALT_BYTES], derivedKey[CIPHER_KEY_BYTES];
+    memcpy(salt, clientSalt, CIPHER_SALT_BYTES);
+    memcpy(salt + CIPHER_SALT_BYTES, serverSalt, CIPHER_SALT_BYTES);
+    const char *labels[] = {"sliding_window client early key", "sliding_window client key", "sliding_window server key"};
+    const char *label = labels[key];
+    size_t keySize = sizeof(derivedKey);
+
+    EVP_PKEY_CTX *kdf = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, NULL);
+    bool derived = kdf != NULL && EVP_PKEY_derive_init(kdf) > 0 && EVP_PKEY_CTX_set_hkdf_md(kdf, EVP_sha256()) > 0 &&
+                   EVP_PKEY_CTX_set1_hkdf_salt(kdf, salt, key == CLIENT_EARLY_KEY ? CIPHER_SALT_BYTES : sizeof(salt)) > 0 &&
+                   EVP_PKEY_CTX_set1_hkdf_key(kdf, psk.data(), (int) psk.size()) > 0 &&
+                   EVP_PKEY_CTX_add1_hkdf_info(kdf, (const unsigned char *) label, (int) strlen(label)) > 0 &&
+                   EVP_PKEY_derive(kdf, derivedKey, &keySize) > 0;
+    EVP_PKEY_CTX_free(kdf);
+    if (!derived) return NULL;
+
+    const EVP_CIPHER *cipher = suite == AES_256_GCM ? EVP_aes_256_gcm() : EVP_chacha20_poly1305();
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (ctx == NULL || EVP_CipherInit_ex(ctx, cipher, NULL, NULL, NULL, encrypt) <= 0 ||
+            EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, CIPHER_IV_BYTES, NULL) <= 0 ||
+            EVP_CipherInit_ex(ctx, NULL, NULL, derivedKey, NULL, encrypt) <= 0) {
+        EVP_CIPHER_CTX_free(ctx);
+        ctx = NULL;
+    }
+    OPENSSL_cleanse(derivedKey, sizeof(derivedKey));
+
+    return ctx;
+}
+
+static void packetIv(uint64_t nonce, unsigned char *iv) {
+    memset(iv, 0, CIPHER_IV_BYTES);
+    for (int i = 0; i < 8; i++) iv[CIPHER_IV_BYTES - 1 - i] = (unsigned char) (nonce >> (8 * i));
+}
+
+bool PacketCipher::seal(const Packet &pkt, Packet &sealed) {
+    if (sealCtx == NULL) return false;
+
+    sealed.header = pkt.header;
+    sealed.handshake = pkt.handshake;
+    sealed.sqn = pkt.sqn;
+    Packet::Header &header = sealed.header;
+    header.cipher = suite;
+    header.nonce = ++this->sealed;
+    header.chksum = 0;
+    header.flags.early = sealEarly ? 1 : 0;
+    memset(header.tag, 0, sizeof(header.tag));
+    if (header.handshakeSize() != 0) memcpy(sealed.handshake.salt, client ? clientSalt : serverSalt, CIPHER_SALT_BYTES);
+
+    int size = (int) header.payloadSize(), len = 0;
+    if (wire.size() < (size_t) size) wire.resize(size);
+    sealed.payload = size == 0 ? NULL : wire.data();
+
+    unsigned char iv[CIPHER_IV_BYTES];
+    packetIv(header.nonce, iv);
+
+    // The header and any handshake are authenticated as they go on the wire, padding and all, with the tag zeroed
+    int handshakeSize = (int) header.handshakeSize();
+    return EVP_EncryptInit_ex(sealCtx, NULL, NULL, NULL, iv) > 0 &&
+           EVP_EncryptUpdate(sealCtx, NULL, &len, (const unsigned char *) &header, sizeof(Packet::Header)) > 0 &&
+           (handshakeSize == 0 || EVP_EncryptUpdate(sealCtx, NULL, &len, (const unsigned char *) &sealed.handshake, handshakeSize) > 0) &&
+           (size == 0 || EVP_EncryptUpdate(sealCtx, (unsigned char *) sealed.payload, &len, (const unsigned char *) pkt.payload, size) > 0) &&
+           EVP_EncryptFinal_ex(sealCtx, NULL, &len) > 0 &&
+           EVP_CIPHER_CTX_ctrl(sealCtx, EVP_CTRL_AEAD_GET_TAG, CIPHER_TAG_BYTES, header.tag) > 0;
+}
+
+bool PacketCipher::open(Packet &pkt) {
+    Packet::Header &header = pkt.header;
+    if (header.cipher != suite || !fresh(header.nonce)) return false;
+
+    if (openCtx != NULL) {
+        // Early packets are only taken until the first sealed under the client's session key
+        bool early = header.flags.early == 1;
+        if (early && earlyCtx == NULL) return false;
+        if (!open(pkt, early ? earlyCtx : openCtx)) return false;
+
+        if (!early && earlyCtx != NULL) {
+            EVP_CIPHER_CTX_free(earlyCtx);
+            earlyCtx = NULL;
+        }
+        accept(header.nonce);
+        return true;
+    }
+
+    // The first SYN or ping from the other end brings the salt its key is derived from. It's only kept once a packet
+    // sealed with that key has been opened, so a forged one can't lock the real one out
+    if (header.flags.syn != 1 && header.flags.ping != 1) return false;
+    if ((header.flags.early == 1) == client) return false;
+    memcpy(client ? serverSalt : clientSalt, pkt.handshake.salt, CIPHER_SALT_BYTES);
+
+    EVP_CIPHER_CTX *ctx = keyed(false, client ? SERVER_KEY : CLIENT_EARLY_KEY);
+    if (ctx == NULL || !open(pkt, ctx)) {
+        EVP_CIPHER_CTX_free(ctx);
+        return false;
+    }
+    accept(header.nonce);
+
+    if (client) {
+        // With the server's salt in, the client moves off its early key
+        openCtx = ctx;
+        EVP_CIPHER_CTX_free(sealCtx);
+        sealCtx = keyed(true, CLIENT_KEY);
+        sealEarly = false;
+    } else {
+        earlyCtx = ctx;
+        RAND_bytes(serverSalt, CIPHER_SALT_BYTES);
+        sealCtx = keyed(true, SERVER_KEY);
+        openCtx = keyed(false, CLIENT_KEY);
+    }
+    return true;
+}
+
+bool PacketCipher::open(Packet &pkt, EVP_CIPHER_CTX *ctx) {
+    Packet::Header &header = pkt.header;
+    unsigned char tag[CIPHER_TAG_BYTES], iv[CIPHER_IV_BYTES];
+    memcpy(tag, header.tag, CIPHER_TAG_BYTES);
+    memset(header.tag, 0, sizeof(header.tag));
+    packetIv(header.nonce, iv);
+    unsigned char *payload = (unsigned char *) pkt.payload;
+    int size = (int) header.payloadSize(), handshakeSize = (int) header.handshakeSize(), len = 0;
+
+    return EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, iv) > 0 &&
+           EVP_DecryptUpdate(ctx, NULL, &len, (const unsigned char *) &header, sizeof(Packet::Header)) > 0 &&
+           (handshakeSize == 0 || EVP_DecryptUpdate(ctx, NULL, &len, (const unsigned char *) &pkt.handshake, handshakeSize) > 0) &&
+           (size == 0 || EVP_DecryptUpdate(ctx, payload, &len, payload, size) > 0) &&
+           EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, CIPHER_TAG_BYTES, tag) > 0 &&
+           EVP_DecryptFinal_ex(ctx, NULL, &len) > 0;
+}
+
+// Whether the nonce is new: above the highest opened, or within the window below it and not opened yet. The word holding
+// the highest nonce is shared with the oldest end of the window, so the window is a word short of its full size
+bool PacketCipher::fresh(uint64_t nonce) const {
+    if (nonce == 0) return false;
+    if (nonce > highest) return true;
+    if (highest - nonce >= CIPHER_REPLAY_WINDOW - 64) return false;
+
+    return (seen[(nonce / 64) % (CIPHER_REPLAY_WINDOW / 64)] & (1ULL << (nonce % 64))) == 0;
+}
+
+void PacketCipher::accept(uint64_t nonce) {
+    const uint64_t words = CIPHER_REPLAY_WINDOW / 64;
+
+    // Clear the words the window slides past
+    if (nonce > highest) {
+        for (uint64_t word = highest / 64 + 1; word <= nonce / 64 && word <= highest / 64 + words; word++) seen[word % words] = 0;
+        highest = nonce;
+    }
+    seen[(nonce / 64) % words] |= 1ULL << (nonce % 64);
+}
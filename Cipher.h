@@ -0,0 +1,85 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_CIPHER_H
+#define SLIDING_WINDOW_CIPHER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ConnectionSettings.h"
+#include "Packet.h"
+
+#define CIPHER_KEY_BYTES 32
+#define CIPHER_SALT_BYTES 16 // random salt each end contributes to the session keys
+#define CIPHER_TAG_BYTES 16
+#define CIPHER_IV_BYTES 12 // 4 zero bytes, then the packet's nonce counter
+#define CIPHER_MIN_PSK_BYTES 16 // shortest pre-shared key accepted
+#define CIPHER_MAX_PSK_BYTES 4096 // bytes of the key file read at most
+#define CIPHER_REPLAY_WINDOW 4096 // nonces below the highest opened that may still arrive, reordered
+
+typedef struct evp_cipher_ctx_st EVP_CIPHER_CTX;
+
+using namespace std;
+
+// The suite this CPU runs fastest: AES-GCM when it has AES and carry-less multiply instructions, ChaCha20-Poly1305 otherwise
+CipherSuite preferredCipher();
+
+const char *cipherName(CipherSuite suite);
+
+// Reads the pre-shared key from path, returning false if it can't be read or is shorter than CIPHER_MIN_PSK_BYTES
+bool loadPsk(const string &path, vector<unsigned char> &psk);
+
+/* Seals and opens the packets of one encrypted connection. Keys are derived with HKDF-SHA256 from the pre-shared key and
+ * the salts carried in the clear by the SYN and ping packets. Until the client has the server's salt it seals under an
+ * early key derived from its own salt alone, so data can follow a fast-start SYN; once the SYN-ACK is in, both directions
+ * use keys derived from both salts. Only the SYN and any fast-start data are sealed under the early key, and those are the
+ * only packets a recording of the connection can replay to another server. The server refuses early packets once the
+ * client's session key is in use.
+ *
+ * Packets are numbered in the order they're sealed and that number is the nonce; every send, resends included, is sealed
+ * afresh, and a nonce that has been opened before is refused. The header, in the clear, is authenticated with the payload,
+ * and the tag takes the CRC's place.
+ */
+class PacketCipher {
+    enum Key {CLIENT_EARLY_KEY, CLIENT_KEY, SERVER_KEY};
+
+    CipherSuite suite;
+    bool client;
+    vector<unsigned char> psk;
+    unsigned char clientSalt[CIPHER_SALT_BYTES]{};
+    unsigned char serverSalt[CIPHER_SALT_BYTES]{};
+    EVP_CIPHER_CTX *sealCtx = NULL; // keyed for our direction; NULL until the salts it needs are known
+    EVP_CIPHER_CTX *openCtx = NULL; // keyed for the peer's direction
+    EVP_CIPHER_CTX *earlyCtx = NULL; // opens the client's early packets, until its session key is in use (server only)
+    bool sealEarly = false; // sealCtx holds the early key (client only)
+    uint64_t sealed = 0;
+    vector<char> wire; // the sealed payload of the packet being sent
+    uint64_t highest = 0; // highest nonce opened
+    uint64_t seen[CIPHER_REPLAY_WINDOW / 64]{}; // nonces opened within the window below highest, a bit each
+
+    EVP_CIPHER_CTX *keyed(bool encrypt, Key key);
+    bool open(Packet &pkt, EVP_CIPHER_CTX *ctx);
+    bool fresh(uint64_t nonce) const;
+    void accept(uint64_t nonce);
+
+public:
+    PacketCipher(CipherSuite suite, const vector<unsigned char> &psk, bool client);
+    ~PacketCipher();
+
+    PacketCipher(const PacketCipher &) = delete;
+    PacketCipher &operator=(const PacketCipher &) = delete;
+
+    // Numbers a copy of the packet and seals it into sealed, whose payload is the cipher's own buffer until the next seal.
+    // The packet itself stays in the clear
+    bool seal(const Packet &pkt, Packet &sealed);
+
+    // Authenticates the packet and decrypts its payload in place, returning false if it was damaged, tampered with or
+    // replayed
+    bool open(Packet &pkt);
+};
+
+
+#endif //SLIDING_WINDOW_CIPHER_H
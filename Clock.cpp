@@ -0,0 +1,7 @@
+//
+// Created on 10/19/26.
+//
+
+#include "Clock.h"
+
+atomic<int64_t> Clock::virtualUs{-1};
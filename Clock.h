@@ -0,0 +1,40 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_CLOCK_H
+#define SLIDING_WINDOW_CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+/* Every time the protocol reads goes through here so the simulator can run it on a virtual clock. Until simulate() is
+ * called these are the system and steady clocks; after it, both read the time the simulator last set.
+ */
+class Clock {
+    static atomic<int64_t> virtualUs; // negative while the real clocks are in use
+
+public:
+    static chrono::time_point<chrono::system_clock> now() {
+        int64_t us = virtualUs.load(memory_order_acquire);
+        if (us < 0) return chrono::system_clock::now();
+        return chrono::time_point<chrono::system_clock>(chrono::duration_cast<chrono::system_clock::duration>(chrono::microseconds(us)));
+    }
+
+    static chrono::time_point<chrono::steady_clock> steadyNow() {
+        int64_t us = virtualUs.load(memory_order_acquire);
+        if (us < 0) return chrono::steady_clock::now();
+        return chrono::time_point<chrono::steady_clock>(chrono::duration_cast<chrono::steady_clock::duration>(chrono::microseconds(us)));
+    }
+
+    // Switches to virtual time, starting at (and thereafter set to) the given microseconds
+    static void simulate(int64_t us) {
+        virtualUs.store(us, memory_order_release);
+    }
+};
+
+
+#endif //SLIDING_WINDOW_CLOCK_H
@@ -0,0 +1,116 @@
+//
+// Created on 10/19/26.
+//
+
+#include <memory>
+
+#include "Compression.h"
+
+Compressor::Compressor() {
+    // Negative window bits select raw deflate; every chunk is independent so the zlib framing would be wasted bytes
+    deflateInit2(&stream, COMPRESSION_LEVEL, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+}
+
+Compressor::~Compressor() {
+    deflateEnd(&stream);
+}
+
+size_t Compressor::compress(const char *in, size_t len, char *out, size_t capacity) {
+    if (len == 0 || capacity == 0) return 0;
+
+    deflateReset(&stream);
+    stream.next_in = (Bytef *) in;
+    stream.avail_in = len;
+    stream.next_out = (Bytef *) out;
+    stream.avail_out = capacity;
+
+    // Anything but Z_STREAM_END means the output ran out of room
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) return 0;
+
+    return capacity - stream.avail_out;
+}
+
+Decompressor::Decompressor() {
+    inflateInit2(&stream, -MAX_WBITS);
+}
+
+Decompressor::~Decompressor() {
+    inflateEnd(&stream);
+}
+
+bool Decompressor::decompress(const char *in, size_t len, char *out, size_t rawSize) {
+    inflateReset(&stream);
+    stream.next_in = (Bytef *) in;
+    stream.avail_in = len;
+    stream.next_out = (Bytef *) out;
+    stream.avail_out = rawSize;
+
+    return inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.avail_out == 0;
+}
+
+// Runs on a worker; each worker keeps its own stream
+static CompressedChunk compressChunk(const vector<char> &raw) {
+    thread_local Compressor compressor;
+    CompressedChunk chunk;
+
+    chunk.rawSize = raw.size();
+    chunk.data.resize(raw.size());
+
+    // Only keep the compressed form if it's smaller
+    size_t compressedSize = compressor.compress(raw.data(), raw.size(), chunk.data.data(), raw.size() - (raw.empty() ? 0 : 1));
+    if (compressedSize > 0) {
+        chunk.data.resize(compressedSize);
+        chunk.compressed = true;
+    } else {
+        chunk.data = raw;
+    }
+
+    return chunk;
+}
+
+CompressionPipeline::CompressionPipeline(FILE *file, unsigned int chunkSize, const ChunkSchedule &schedule, unsigned int threads) : pool(threads) {
+    this->file = file;
+    this->chunkSize = chunkSize;
+    this->schedule = schedule;
+    this->depth = (threads == 0 ? 1 : threads) * COMPRESSION_READ_AHEAD;
+}
+
+void CompressionPipeline::readAhead() {
+    while (!eof && !schedule.empty() && pending.size() < depth) {
+        uint64_t offset = schedule.next() * chunkSize;
+        if ((uint64_t) ftello(file) != offset) fseeko(file, (off_t) offset, SEEK_SET);
+
+        auto raw = make_shared<vector<char>>(chunkSize);
+        size_t bytesRead = fread(raw->data(), sizeof(char), chunkSize, file);
+
+        raw->resize(bytesRead);
+        bool last = schedule.empty() || bytesRead < chunkSize;
+        if (last) eof = true;
+
+        auto task = make_shared<packaged_task<CompressedChunk()>>([raw, offset, last] {
+            CompressedChunk chunk = compressChunk(*raw);
+            chunk.offset = offset;
+            chunk.last = last;
+            return chunk;
+        });
+        pending.push_back(task->get_future());
+        pool.submit([task] { (*task)(); });
+    }
+}
+
+CompressedChunk &CompressionPipeline::next() {
+    readAhead();
+
+    // Past the end of the file
+    if (pending.empty()) {
+        current = CompressedChunk();
+        return current;
+    }
+
+    current = pending.front().get();
+    pending.pop_front();
+
+    readAhead();
+
+    return current;
+}
@@ -0,0 +1,84 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_COMPRESSION_H
+#define SLIDING_WINDOW_COMPRESSION_H
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <vector>
+#include <zlib.h>
+
+#include "ConnectionSettings.h"
+#include "Resume.h"
+#include "WorkerPool.h"
+
+#define COMPRESSION_LEVEL 1 // zlib's fastest level; the link, not the ratio, is the bottleneck
+#define COMPRESSION_READ_AHEAD 2 // chunks queued per worker ahead of the send loop
+
+using namespace std;
+
+// Raw deflate (no zlib header/trailer) of independent chunks, reusing one stream
+class Compressor {
+    z_stream stream{};
+
+public:
+    Compressor();
+    ~Compressor();
+
+    Compressor(const Compressor &) = delete;
+    Compressor &operator=(const Compressor &) = delete;
+
+    // Compresses in into out, returning the compressed size, or 0 if it didn't fit in capacity bytes
+    size_t compress(const char *in, size_t len, char *out, size_t capacity);
+};
+
+class Decompressor {
+    z_stream stream{};
+
+public:
+    Decompressor();
+    ~Decompressor();
+
+    Decompressor(const Decompressor &) = delete;
+    Decompressor &operator=(const Decompressor &) = delete;
+
+    // Inflates in into out, returning false unless it produced exactly rawSize bytes
+    bool decompress(const char *in, size_t len, char *out, size_t rawSize);
+};
+
+struct CompressedChunk {
+    vector<char> data; // payload as it goes on the wire
+    unsigned int rawSize = 0; // bytes of the file this chunk holds
+    uint64_t offset = 0; // where in the file it was read from
+    bool last = false; // no chunks are left to send after this one
+    bool compressed = false; // false if compressing didn't make the chunk smaller, in which case data is the raw chunk
+};
+
+/* Reads the scheduled packet-sized chunks of a file and compresses them on a worker pool, keeping a few chunks per worker
+ * in flight ahead of the send loop so it rarely waits on the codec. Chunks come back out in schedule order.
+ */
+class CompressionPipeline {
+    FILE *file;
+    unsigned int chunkSize;
+    ChunkSchedule schedule;
+    unsigned int depth;
+    bool eof = false;
+    deque<future<CompressedChunk>> pending;
+    CompressedChunk current;
+    WorkerPool pool; // last so it's destroyed (and joined) first
+
+    void readAhead();
+
+public:
+    CompressionPipeline(FILE *file, unsigned int chunkSize, const ChunkSchedule &schedule, unsigned int threads);
+
+    // Next chunk of the file
+    CompressedChunk &next();
+};
+
+
+#endif //SLIDING_WINDOW_COMPRESSION_H
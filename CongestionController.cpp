@@ -0,0 +1,134 @@
+//
+// Created on 10/19/26.
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "Clock.h"
+#include "CongestionController.h"
+
+#define INITIAL_WINDOW 4
+#define CUBIC_C 0.4
+#define CUBIC_BETA 0.7
+#define RENO_BETA 0.5
+#define DELAY_BETA 0.85
+#define DELAY_THRESHOLD 2 // Reduce once the smoothed RTT exceeds this multiple of the minimum RTT...
+#define DELAY_FLOOR_MS 5 // ...and at least this much queueing delay has built up
+
+CongestionController::CongestionController(CongestionAlgorithm algorithm, unsigned int maxWindow) {
+    this->algorithm = algorithm;
+    this->maxWindow = max(maxWindow, 1u);
+    this->cwnd = (algorithm == NO_CC) ? this->maxWindow : min((unsigned int) INITIAL_WINDOW, this->maxWindow);
+    this->ssthresh = this->maxWindow;
+}
+
+unsigned int CongestionController::window() const {
+    unsigned int wnd = (unsigned int) cwnd;
+    return max(1u, min(wnd, maxWindow));
+}
+
+void CongestionController::setMaxWindow(unsigned int maxWindow) {
+    this->maxWindow = max(maxWindow, 1u);
+    if (algorithm == NO_CC || cwnd > this->maxWindow) cwnd = this->maxWindow;
+    if (ssthresh > this->maxWindow) ssthresh = this->maxWindow;
+}
+
+void CongestionController::onAck(chrono::microseconds rtt) {
+    if (algorithm == NO_CC) return;
+
+    if (rtt.count() > 0) {
+        updateRtt(rtt);
+
+        // Queueing delay is building up along the path; back off before it turns into loss
+        if (cwnd > ssthresh && srtt > minRtt * DELAY_THRESHOLD && srtt - minRtt > chrono::milliseconds(DELAY_FLOOR_MS)) {
+            reduce(DELAY_BETA);
+            return;
+        }
+    }
+
+    if (cwnd < ssthresh) {
+        // Slow start
+        cwnd += 1;
+    } else if (algorithm == RENO) {
+        cwnd += 1 / cwnd;
+    } else {
+        cubicUpdate();
+    }
+
+    // Don't let the window run away from the limit the receiver can accept
+    if (cwnd > maxWindow) cwnd = maxWindow;
+}
+
+void CongestionController::onLoss() {
+    if (algorithm == NO_CC) return;
+
+    reduce(algorithm == CUBIC ? CUBIC_BETA : RENO_BETA);
+}
+
+void CongestionController::onTimeout() {
+    if (algorithm == NO_CC) return;
+
+    ssthresh = max(cwnd * (algorithm == CUBIC ? CUBIC_BETA : RENO_BETA), 2.0);
+    wMax = cwnd;
+    cwnd = 1;
+    epochStart = {};
+    lastReduction = Clock::steadyNow();
+}
+
+chrono::microseconds CongestionController::smoothedRtt() const {
+    return srtt;
+}
+
+bool CongestionController::inSlowStart() const {
+    return algorithm != NO_CC && cwnd < ssthresh;
+}
+
+// Multiplicative decrease; only applied once per round trip so a burst of losses from the same window counts as one
+void CongestionController::reduce(double beta) {
+    auto now = Clock::steadyNow();
+    if (lastReduction.time_since_epoch().count() != 0 && now - lastReduction < srtt) return;
+
+    wMax = cwnd;
+    cwnd = max(cwnd * beta, 1.0);
+    ssthresh = max(cwnd, 2.0);
+    epochStart = {};
+    lastReduction = now;
+}
+
+void CongestionController::updateRtt(chrono::microseconds rtt) {
+    if (srtt.count() == 0) {
+        srtt = rtt;
+        rttvar = rtt / 2;
+        minRtt = rtt;
+    } else {
+        chrono::microseconds delta = (srtt > rtt) ? srtt - rtt : rtt - srtt;
+        rttvar = (rttvar * 3 + delta) / 4;
+        srtt = (srtt * 7 + rtt) / 8;
+        if (rtt < minRtt) minRtt = rtt;
+    }
+}
+
+// W(t) = C(t - K)^3 + Wmax, with a Reno-friendly lower bound
+void CongestionController::cubicUpdate() {
+    auto now = Clock::steadyNow();
+
+    if (epochStart.time_since_epoch().count() == 0) {
+        epochStart = now;
+        if (wMax < cwnd) wMax = cwnd;
+        k = cbrt(wMax * (1 - CUBIC_BETA) / CUBIC_C);
+        wEst = cwnd;
+    }
+
+    double t = chrono::duration<double>(now - epochStart + srtt).count();
+    double target = CUBIC_C * pow(t - k, 3) + wMax;
+    wEst += (3 * (1 - CUBIC_BETA) / (1 + CUBIC_BETA)) / cwnd;
+
+    if (wEst > target) target = wEst;
+
+    if (target > cwnd) {
+        cwnd += (target - cwnd) / cwnd;
+    } else {
+        cwnd += 0.01 / cwnd;
+    }
+}
@@ -0,0 +1,64 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_CONGESTIONCONTROLLER_H
+#define SLIDING_WINDOW_CONGESTIONCONTROLLER_H
+
+#include <chrono>
+
+#include "ConnectionSettings.h"
+
+using namespace std;
+
+/* Per-connection congestion window. Grows with slow start and then Reno (AIMD) or CUBIC congestion avoidance, and backs
+ * off on loss, timeouts and RTT inflation. The window never exceeds the wSize negotiated during the handshake.
+ */
+class CongestionController {
+    CongestionAlgorithm algorithm = CUBIC;
+    double cwnd = 1;
+    double ssthresh = 0;
+    unsigned int maxWindow = 1;
+
+    // CUBIC
+    double wMax = 0;
+    double k = 0;
+    double wEst = 0; // Reno-friendly window estimate
+    chrono::time_point<chrono::steady_clock> epochStart{};
+
+    // RTT tracking
+    chrono::microseconds srtt = chrono::microseconds(0);
+    chrono::microseconds rttvar = chrono::microseconds(0);
+    chrono::microseconds minRtt = chrono::microseconds(0);
+    chrono::time_point<chrono::steady_clock> lastReduction{};
+
+    void reduce(double beta);
+    void updateRtt(chrono::microseconds rtt);
+    void cubicUpdate();
+
+public:
+    CongestionController() = default;
+    CongestionController(CongestionAlgorithm algorithm, unsigned int maxWindow);
+
+    // Number of packets which may currently be in flight
+    unsigned int window() const;
+
+    // Upper bound of the window (the negotiated wSize)
+    void setMaxWindow(unsigned int maxWindow);
+
+    // A new packet was ACK'd; rtt is zero when no valid sample exists (e.g. retransmitted packets)
+    void onAck(chrono::microseconds rtt);
+
+    // A packet timed out and had to be retransmitted
+    void onLoss();
+
+    // Every packet in flight had to be retransmitted (GBN timeout)
+    void onTimeout();
+
+    chrono::microseconds smoothedRtt() const;
+
+    bool inSlowStart() const;
+};
+
+
+#endif //SLIDING_WINDOW_CONGESTIONCONTROLLER_H
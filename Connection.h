@@ -10,9 +10,25 @@
 #include <vector>
 #include <queue>
 #include <netdb.h>
+#include <memory>
 
+#include "Compression.h"
+#include "Cipher.h"
+#include "CongestionController.h"
+#include "ConnectionSettings.h"
+#include "Dedup.h"
+#include "Delta.h"
+#include "DirectWriter.h"
+#include "DirectoryTree.h"
+#include "ForwardErrorCorrection.h"
+#include "Metrics.h"
+#include "Resume.h"
+#include "Pacer.h"
 #include "Packet.h"
+#include "PacketSizer.h"
 #include "PacketInfo.h"
+#include "SlidingWindow.h"
+#include "Transport.h"
 
 enum Status {PENDING, OPEN, CLOSED, ERROR, COMPLETE};
 
@@ -20,37 +36,85 @@ struct Connection {
     Status status = PENDING;
     struct sockaddr_in srcAddr {0,0,0,0};
     struct sockaddr_in destAddr = {0, 0, 0, 0};
-    int sockfd;
-    unsigned int sqn;
+    int sockfd; // -1 when the transport isn't a socket of our own
+    shared_ptr<Transport> transport; // Carries the packets; the socket, unless the simulator supplied its link
+    shared_ptr<PacketCipher> cipher; // Seals and opens the packets when they're encrypted under a pre-shared key
+    Protocol protocol = NO_PROTO;
+    uint64_t sqn;
     unsigned int sqnBits;
-    unsigned int sqnRange;
-    unsigned short wSize; // (R|S)WS
+    uint64_t sqnRange; // Sequence numbers are tracked in 64 bits and only wrapped to this range on the wire
+    unsigned int wSize; // (R|S)WS
+    CongestionController congestion; // Limits the packets in flight to at most wSize (client only)
+    Pacer pacer; // Spaces out data packets and enforces rate caps (client only)
+    PacketSizer sizer; // Payload size of new data packets, at most pktSizeBytes (client only)
     unsigned int pktSizeBytes;
-    unsigned int pktsSent = 0;
-    unsigned int resentPkts = 0;
-    unsigned int finalSqn = 0;
+    unsigned char fecData = 0; // FEC block shape; 0 data packets means FEC is off
+    unsigned char fecParity = 0;
+    FecEncoder fecEncoder; // Builds the parity of each block of data packets (client only)
+    FecDecoder fecDecoder; // Rebuilds lost data packets from parity (server only)
+    queue<FecParity> fecQueue; // Parity waiting on the last data packet of its block to be sent (client only)
+    queue<Packet> fecRecovered; // Rebuilt packets waiting to be handled as if they had arrived (server only)
+    uint64_t fecPkts = 0; // Parity packets sent (client) / data packets rebuilt (server)
+    CompressionCodec compression = NO_COMPRESSION;
+    shared_ptr<CompressionPipeline> compressor; // Reads and compresses the file ahead of the send loop (client only)
+    shared_ptr<Decompressor> decompressor; // (server only)
+    vector<char> rawBuffer; // Decompressed or copied payload on its way to the file (server only)
+    uint64_t wireBytes = 0; // Payload bytes sent once compressed (client only)
+    uint64_t pktsSent = 0;
+    uint64_t resentPkts = 0;
+    shared_ptr<ConnectionMetrics> metrics = make_shared<ConnectionMetrics>(); // Read by the metrics exporter while the connection runs
+    uint64_t finalSqn = 0;
     chrono::microseconds timeoutInterval;
     chrono::time_point<chrono::system_clock> timeConnectionStarted;
+    chrono::time_point<chrono::system_clock> synSent; // When the SYN went out, to time the SYN-ACK against (client only)
+    bool synPending = false; // A SYN is awaiting its SYN-ACK (client only)
     string filename;
+    string remoteName; // Where the server writes the file, relative to its save directory (client only)
+    bool batch = false; // The file is a batch of small files, unpacked once received
     FILE *file; // the file being read or written
+    shared_ptr<DirectWriter> direct; // Behind file when it's written with O_DIRECT (server only)
+    bool synced = false; // The file has been made durable since it was opened (server only)
+    bool ackHeld = false; // heldAck goes out once its packet has been written, and the file made durable if it's complete (server only)
+    PacketInfo heldAck;
+    unsigned int fileId = 0; // Which of the session's files is being sent or received; the handshake's is 0
+    queue<OutgoingFile> pendingFiles; // Files still to be sent over this connection after the current one (client only)
+    bool nextSyn = false; // The current file has been read, and the next one's SYN goes out as soon as it can (client only)
     ssize_t bytesRead = 0;
+    uint64_t fileBytes = 0; // Bytes of the file read and sent (client)
+    uint64_t transferId = 0; // Non-zero if the transfer can be resumed should the connection die
+    uint64_t fileSize = 0;
+    int64_t fileMtime = 0;
+    ChunkSchedule schedule; // Chunks left to read from the file (client only)
+    uint64_t chunkOffset = 0; // Where the next piece of the chunk being sent starts, when the sizer splits chunks (client only)
+    uint64_t chunkLeft = 0; // Bytes of that chunk still to send (client only)
+    shared_ptr<ReceiveBitmap> receivedChunks; // Chunks written to the file so far, kept beside it (server only)
+    bool resuming = false; // Picking up a partial file left by an earlier connection (server only)
+    shared_ptr<DeltaEncoder> delta; // Turns the file into copies of blocks the server has and literal data (client only)
+    vector<BlockSignature> signatures; // Of the existing copy a delta is sent against (server only)
+    FILE *basis = NULL; // The existing copy a delta transfer is rebuilt from (server only)
+    shared_ptr<DedupSender> dedup; // Offers the file's chunks and sends those the server lacks (client only)
+    shared_ptr<ChunkStore> store; // Chunks kept from earlier transfers (server only)
+    DedupDigest clientDigest{}; // What the client's dedup FIN says the file should be (server only)
+    bool digestPending = false; // The file is checked against clientDigest before its last ACK goes (server only)
 
     union lastRec {
-        unsigned int lastAckRec = 0; // LAR
-        unsigned int lastFrameRec; // LFR
+        uint64_t lastAckRec = 0; // LAR
+        uint64_t lastFrameRec; // LFR
     } lastRec;
 
     union lastFrame {
-        unsigned int largestAcceptableFrame = 0; // LAF
-        unsigned int lastFrameSent; // LFS
+        uint64_t largestAcceptableFrame = 0; // LAF
+        uint64_t lastFrameSent; // LFS
     } lastFrame;
 
     // timeout queue
     queue<PacketInfo*> timeoutQueue{};
 
     // packet buffer
-    // Packets inserted at the index (sqn % wSize) with the next in-order packet being (sqn % wSize) + 1
-    PacketInfo *pktBuffer;
+    // Packets inserted at the index (sqn & mask) with the next in-order packet being (sqn & mask) + 1
+    // GBN servers only accept in-order packets and therefore don't allocate one. SR servers write most out-of-order
+    // packets to the file as they arrive, so theirs is only a bitmap until a packet has to be held
+    SlidingWindow pktBuffer;
 };
 
 
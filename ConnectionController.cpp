@@ -3,16 +3,25 @@
 //
 
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <stdarg.h>
+#include <sys/stat.h>
 #include <string.h>
 #include <cmath>
 #include <thread>
 #include <iostream>
 
+#include "Clock.h"
 #include "ConnectionController.h"
+#include "InputHelper.h"
 #include "PacketBuilder.h"
+#include "Trace.h"
 
 #define PING_ATTEMPTS 3
 #define PING_TIMEOUT_SECONDS 5
+#define PRINT_WINDOW_MAX 32 // Large windows are truncated when printed
+#define TFO_QUEUE_LENGTH 16 // Pending TCP Fast Open connections the server accepts data from
 
 using namespace std;
 
@@ -46,7 +55,14 @@ int ConnectionController::startServer() {
     }
 
     if (appState->verbose) {
-        printf("Server bound and listening on port %i\n", appState->connectionSettings.port);
+        print("Server bound and listening on port %i\n", appState->connectionSettings.port);
+    }
+
+    // Let clients that have connected before carry their first packets in the TCP SYN
+    int fastOpenQueue = TFO_QUEUE_LENGTH;
+    if (appState->connectionSettings.tcpFastOpen &&
+            setsockopt(serverSockfd, IPPROTO_TCP, TCP_FASTOPEN, &fastOpenQueue, sizeof(fastOpenQueue)) < 0) {
+        fprintf(stderr, "Unable to enable TCP Fast Open; continuing without it\nError #: %d\n", errno);
     }
 
     if (listen(serverSockfd, 1) < 0) {
@@ -54,42 +70,90 @@ int ConnectionController::startServer() {
         return -1;
     }
 
+    startMetrics();
+
 
     do {
-        printf("Awaiting connection...\n");
+        print("Awaiting connection...\n");
         sockaddr_in clientAddr = {0,0,0,0};
         socklen_t clientAddrLen = sizeof(clientAddr);
         int clientfd = accept(serverSockfd, (struct sockaddr *) &clientAddr, &clientAddrLen);
-        Connection connection = createConnection(clientfd, clientAddr, serverAddr);
-
-        pendingConnections.push(connection);
+        pendingConnections.push(createConnection(clientfd, clientAddr, serverAddr));
         processConnections();
-    } while (true);
+    } while (!appState->serveOnce);
 
     close(serverSockfd);
+    return 0;
 }
 
 void ConnectionController::initializeConnections(const string& ipAddress) {
+    Pacer::setProcessRate(appState->connectionSettings.processRateLimit, KB * appState->connectionSettings.pktSize);
+    startMetrics();
+
     for (auto &ipAddress : appState->ipAddresses) {
         pendingConnections.push(createConnection(ipAddress));
     }
 }
 
+void ConnectionController::runConnection(const shared_ptr<Transport> &transport) {
+    if (appState->role == CLIENT) {
+        Pacer::setProcessRate(appState->connectionSettings.processRateLimit, KB * appState->connectionSettings.pktSize);
+        Connection connection = createConnection(appState->ipAddresses.front(), false, transport);
+        connection.timeConnectionStarted = Clock::now();
+        if (connection.status == PENDING) connection.status = OPEN;
+        pendingConnections.push(move(connection));
+    } else {
+        sockaddr_in addr = {0,0,0,0};
+        addr.sin_family = AF_INET;
+        pendingConnections.push(createConnection(-1, addr, addr, transport));
+    }
+
+    startMetrics();
+    processConnections();
+}
+
 void ConnectionController::processConnections() {
     while(!pendingConnections.empty()) {
-        Connection connection = pendingConnections.front();
+        Connection connection = move(pendingConnections.front());
         pendingConnections.pop();
 
+        // The connection's metrics are labelled with the peer's address
+        char convertedIP[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &connection.destAddr.sin_addr, convertedIP, INET_ADDRSTRLEN);
+        metrics.attach(connection.metrics, string(convertedIP) + ":" + to_string(ntohs(connection.destAddr.sin_port)));
+        TRACE(TRACE_LEVEL_EVENTS, TRACE_CONNECTION_OPENED, 0, ntohs(connection.destAddr.sin_port), 0);
+
         handleConnection(connection);
+
+        TRACE(TRACE_LEVEL_EVENTS, TRACE_CONNECTION_CLOSED, connection.protocol, connection.status, connection.fileId);
+        metrics.detach(connection.metrics);
+        if (metricsExporter) metricsExporter->writeStats();
+        if (!appState->tracePath.empty()) Tracer::dump(appState->tracePath, appState->role == CLIENT ? "client" : "server");
     }
 }
 
+// Starts publishing the metrics of the connections if a stats file or metrics socket was asked for
+void ConnectionController::startMetrics() {
+    ConnectionSettings &settings = appState->connectionSettings;
+    if (metricsExporter || (settings.statsPath.empty() && settings.metricsSocket.empty())) return;
+
+    metricsExporter.reset(new MetricsExporter(metrics, settings.statsPath, settings.metricsSocket));
+}
+
+// Publishes how full the window and the send queues are (client only)
+void ConnectionController::updateQueueGauges(Connection &connection) {
+    connection.metrics->windowOccupancy.set((int64_t) (connection.lastFrame.lastFrameSent - connection.lastRec.lastAckRec));
+    connection.metrics->timeoutQueueDepth.set((int64_t) connection.timeoutQueue.size());
+    connection.metrics->parityQueueDepth.set((int64_t) connection.fecQueue.size());
+}
+
 // Client implementation
-Connection ConnectionController::createConnection(const string& ipAddress, bool isPing) {
+Connection ConnectionController::createConnection(const string& ipAddress, bool isPing, const shared_ptr<Transport> &transport) {
     Connection connection{};
-    connection.sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    connection.sockfd = transport ? -1 : socket(AF_INET, SOCK_STREAM, 0);
+    connection.transport = transport ? transport : make_shared<SocketTransport>(connection.sockfd);
 
-    if (connection.sockfd < 0) {
+    if (!transport && connection.sockfd < 0) {
         fprintf(stderr, "Socket creation error\nError #: %d\n", errno);
         connection.status = ERROR;
     }
@@ -101,26 +165,58 @@ Connection ConnectionController::createConnection(const string& ipAddress, bool
     inet_pton(AF_INET, getLocalAddress().c_str(), &(connection.srcAddr.sin_addr));
 
     connection.sqn = 0;
+    connection.protocol = appState->connectionSettings.protocol;
     connection.wSize = appState->connectionSettings.wSize;
     connection.sqnBits = appState->connectionSettings.sqnBits;
     connection.sqnRange = appState->connectionSettings.sqnRange;
     connection.pktSizeBytes = KB * appState->connectionSettings.pktSize;
+    connection.fecData = appState->connectionSettings.fecData;
+    connection.fecParity = appState->connectionSettings.fecParity;
+    connection.compression = appState->connectionSettings.compression;
+
+    if (!appState->connectionSettings.psk.empty()) {
+        connection.cipher = make_shared<PacketCipher>(appState->connectionSettings.cipher, appState->connectionSettings.psk, true);
+    }
 
     if (!isPing) {
-        connection.pktBuffer = new PacketInfo[connection.wSize];
+        connection.pktBuffer.allocate(connection.wSize);
+        connection.congestion = CongestionController(appState->connectionSettings.congestionAlgorithm, connection.wSize);
         connection.timeoutInterval = appState->connectionSettings.timeoutInterval;
-        connection.file = std::fopen(appState->filePath.c_str(), "rb");
+
+        // Every file goes over this one connection, one after the other
+        vector<OutgoingFile> files = outgoingFiles();
+        openFile(connection, files.front());
+        for (size_t i = 1; i < files.size(); i++) connection.pendingFiles.push(files[i]);
     } else {
         connection.timeoutInterval = chrono::seconds(PING_TIMEOUT_SECONDS);
     }
 
     // Set socket timeout interval
-    timeval timeout = toTimeval(connection.timeoutInterval);
-    if (setsockopt(connection.sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+    if (!connection.transport->setReceiveTimeout(connection.timeoutInterval)) {
+        fprintf(stderr, "Setting socket options failed\nError #: %d\n", errno);
+        connection.status = ERROR;
+    }
+
+    // Header and payload go out as separate writes; without TCP_NODELAY a paced packet
+    // sits behind Nagle until the peer's delayed ACK fires.
+    int noDelay = 1;
+    if (!transport && setsockopt(connection.sockfd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)) < 0) {
         fprintf(stderr, "Setting socket options failed\nError #: %d\n", errno);
         connection.status = ERROR;
     }
 
+#ifdef TCP_FASTOPEN_CONNECT
+    // connect() returns straight away and the SYN carries the first write
+    int fastOpen = 1;
+    if (!isPing && !transport && appState->connectionSettings.tcpFastOpen &&
+            setsockopt(connection.sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &fastOpen, sizeof(fastOpen)) < 0) {
+        fprintf(stderr, "Unable to enable TCP Fast Open; continuing without it\nError #: %d\n", errno);
+    }
+#endif
+
+    // Data sent ahead of the SYN-ACK is numbered with our own sequence range, so it has to be wide enough already
+    if (!isPing && appState->connectionSettings.fastStart) fitSqnRange(connection);
+
     connection.lastRec.lastAckRec = 0;
     connection.lastFrame.lastFrameSent = 0;
 
@@ -128,13 +224,14 @@ Connection ConnectionController::createConnection(const string& ipAddress, bool
 }
 
 // Server implementation
-Connection ConnectionController::createConnection(int sockfd, sockaddr_in clientAddr, sockaddr_in &serverAddr) {
+Connection ConnectionController::createConnection(int sockfd, sockaddr_in clientAddr, sockaddr_in &serverAddr, const shared_ptr<Transport> &transport) {
     Connection connection{};
     connection.sockfd = sockfd;
+    connection.transport = transport ? transport : make_shared<SocketTransport>(sockfd);
     connection.status = OPEN;
-    connection.timeConnectionStarted = chrono::system_clock::now();
+    connection.timeConnectionStarted = Clock::now();
 
-    if (connection.sockfd < 0) {
+    if (!transport && connection.sockfd < 0) {
         fprintf(stderr, "Socket creation error\nError #: %d\n", errno);
         connection.status = ERROR;
     }
@@ -143,16 +240,24 @@ Connection ConnectionController::createConnection(int sockfd, sockaddr_in client
     connection.destAddr = clientAddr;
 
     connection.sqn = 0;
+    connection.protocol = appState->connectionSettings.protocol;
     connection.sqnBits = appState->connectionSettings.sqnBits;
     connection.sqnRange = appState->connectionSettings.sqnRange;
     connection.wSize = appState->connectionSettings.wSize;
     connection.pktSizeBytes = KB * appState->connectionSettings.pktSize;
     connection.timeoutInterval = appState->connectionSettings.timeoutInterval; // TTL
-    connection.pktBuffer = new PacketInfo[connection.wSize];
+    fitSqnRange(connection);
+    if (connection.protocol != GBN) connection.pktBuffer.allocate(connection.wSize, false);
 
     // Set socket timeout interval
-    timeval timeout = toTimeval(connection.timeoutInterval);
-    if (setsockopt(connection.sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+    if (!connection.transport->setReceiveTimeout(connection.timeoutInterval)) {
+        fprintf(stderr, "Setting socket options failed\nError #: %d\n", errno);
+        connection.status = ERROR;
+    }
+
+    // ACKs are single small writes; don't let Nagle hold them back
+    int noDelay = 1;
+    if (!transport && setsockopt(connection.sockfd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)) < 0) {
         fprintf(stderr, "Setting socket options failed\nError #: %d\n", errno);
         connection.status = ERROR;
     }
@@ -180,18 +285,18 @@ void ConnectionController::handleConnection(Connection &connection, bool isPing)
             return;
         }
 
-        connection.timeConnectionStarted = chrono::system_clock::now();
+        connection.timeConnectionStarted = Clock::now();
         connection.status = OPEN;
     }
 
     if (appState->verbose) {
         inet_ntop(AF_INET, &connection.srcAddr.sin_addr, convertedIP, INET_ADDRSTRLEN);
         port = htons(connection.srcAddr.sin_port);
-        printf("Source info: Address: %s, Port: %i\n", convertedIP, port);
+        print("Source info: Address: %s, Port: %i\n", convertedIP, port);
 
         inet_ntop(AF_INET, &connection.destAddr.sin_addr, convertedIP, INET_ADDRSTRLEN);
         port = htons(connection.destAddr.sin_port);
-        printf("Connection made to %s:%d\n", convertedIP, port);
+        print("Connection made to %s:%d\n", convertedIP, port);
 
     }
 
@@ -201,18 +306,22 @@ void ConnectionController::handleConnection(Connection &connection, bool isPing)
 void ConnectionController::sendPacket(Connection &connection, PacketInfo &pktInfo) {
     int originalChksum = pktInfo.pkt.header.chksum;
     bool lost = false, damaged = false;
-    if (appState->role == CLIENT) connection.pktsSent++; // pktsSent are used for another metric for servers
+    bool parity = pktInfo.pkt.header.flags.fec == 1;
+    if (appState->role == CLIENT && !parity) connection.pktsSent++; // pktsSent are used for another metric for servers
     pktInfo.count++;
 
-    if (pktInfo.pkt.header.flags.ping != 1) {
-        if (!appState->connectionSettings.damagedPackets.empty() && appState->connectionSettings.damagedPackets.front() == pktInfo.pkt.header.sqn) {
+    // A fast-start SYN is never resent, so it's spared simulated errors
+    bool fastSyn = pktInfo.pkt.header.flags.syn == 1 && pktInfo.pkt.header.flags.fast == 1;
+
+    if (pktInfo.pkt.header.flags.ping != 1 && !fastSyn) {
+        if (!parity && !appState->connectionSettings.damagedPackets.empty() && (uint64_t) appState->connectionSettings.damagedPackets.front() == pktInfo.pkt.sqn) {
             pktInfo.pkt.header.chksum = ~pktInfo.pkt.header.chksum;
             appState->connectionSettings.damagedPackets.erase(appState->connectionSettings.damagedPackets.begin());
             damaged = true;
         } else if (packetBadLuck(appState->connectionSettings.damageProb) && pktInfo.count < (appState->connectionSettings.retrylimit - 1)) {
             pktInfo.pkt.header.chksum = ~pktInfo.pkt.header.chksum;
             damaged = true;
-        } else if (!appState->connectionSettings.lostPackets.empty() && appState->connectionSettings.lostPackets.front() == pktInfo.pkt.header.sqn) {
+        } else if (!parity && !appState->connectionSettings.lostPackets.empty() && (uint64_t) appState->connectionSettings.lostPackets.front() == pktInfo.pkt.sqn) {
             lost = true;
             appState->connectionSettings.lostPackets.erase(appState->connectionSettings.lostPackets.begin());
         } else if (packetBadLuck(appState->connectionSettings.lostProb) && pktInfo.count < (appState->connectionSettings.retrylimit - 1)) {
@@ -227,18 +336,37 @@ void ConnectionController::sendPacket(Connection &connection, PacketInfo &pktInf
         pktInfo.pkt.header.chksum = PacketBuilder::generateChksum(&pktInfo.pkt);
     }
 
+    // Every send is sealed afresh, under a nonce of its own, leaving the packet in the clear for its resends
+    Packet sealed;
+    if (connection.cipher) {
+        if (!connection.cipher->seal(pktInfo.pkt, sealed)) {
+            print("Unable to encrypt packet %lu, Closing connection\n", pktInfo.pkt.sqn);
+            connection.status = ERROR;
+            return;
+        }
+        if (damaged) sealed.header.chksum = ~sealed.header.chksum;
+    }
+    Packet &wire = connection.cipher ? sealed : pktInfo.pkt;
+
     if (!lost) {
         // Send header
-        if (write(connection.sockfd, (Packet::Header *) &(pktInfo.pkt.header), sizeof(Packet::Header)) < 0) {
+        if (connection.transport->send((Packet::Header *) &(wire.header), sizeof(Packet::Header)) < 0) {
             fprintf(stderr, "Error writing header to socket\nError #: %d\n", errno);
             connection.status = ERROR;
 
             return;
         }
 
-        if (pktInfo.pkt.header.pktSize != 0 && !(pktInfo.pkt.header.flags.syn == 1 && pktInfo.pkt.header.flags.ack == 1)) {
+        if (wire.header.handshakeSize() != 0 && connection.transport->send(&wire.handshake, sizeof(Packet::Handshake)) < 0) {
+            fprintf(stderr, "Error writing handshake to socket\nError #: %d\n", errno);
+            connection.status = ERROR;
+
+            return;
+        }
+
+        if (wire.header.payloadSize() != 0) {
             // Send payload
-            if (write(connection.sockfd, (void *) pktInfo.pkt.payload, pktInfo.pkt.header.pktSize) < 0) {
+            if (connection.transport->send((void *) wire.payload, wire.header.payloadSize()) < 0) {
                 fprintf(stderr, "Error writing payload to socket\nError #: %d\n", errno);
                 connection.status = ERROR;
 
@@ -250,153 +378,293 @@ void ConnectionController::sendPacket(Connection &connection, PacketInfo &pktInf
     // Repair "damage"
     if (damaged) pktInfo.pkt.header.chksum = originalChksum;
 
+    bool resent = pktInfo.pkt.header.flags.ack != 1 && !parity && pktInfo.count > 1;
+    if (resent) connection.resentPkts++;
+
+    ConnectionMetrics &metrics = *connection.metrics;
+    if (!lost) metrics.bytesSent.add(sizeof(Packet::Header) + pktInfo.pkt.header.handshakeSize() + pktInfo.pkt.header.payloadSize());
+    if (!parity && pktInfo.pkt.header.flags.ping != 1 && pktInfo.pkt.header.flags.ack != 1) {
+        metrics.pktsSent.add();
+        metrics.payloadBytes.add(pktInfo.pkt.header.payloadSize());
+        if (resent) {
+            metrics.retransmits.add();
+            metrics.resentPayloadBytes.add(pktInfo.pkt.header.payloadSize());
+        }
+    }
+
+    uint64_t sqn = pktInfo.pkt.sqn;
+    uint16_t fileId = pktInfo.pkt.header.fileId;
+    if (pktInfo.pkt.header.flags.ack == 1) {
+        TRACE(TRACE_LEVEL_PACKETS, TRACE_ACK_SENT, sqn, 0, fileId);
+    } else if (parity) {
+        TRACE(TRACE_LEVEL_PACKETS, TRACE_PARITY_SENT, sqn, pktInfo.pkt.header.fecIndex, fileId);
+    } else if (resent) {
+        TRACE(TRACE_LEVEL_EVENTS, TRACE_PKT_RESENT, sqn, pktInfo.count, fileId);
+    } else {
+        TRACE(TRACE_LEVEL_PACKETS, TRACE_PKT_SENT, sqn, pktInfo.pkt.header.payloadSize(), fileId);
+    }
+    if (lost) TRACE(TRACE_LEVEL_EVENTS, TRACE_PKT_LOST, sqn, pktInfo.count, fileId);
+    if (damaged) TRACE(TRACE_LEVEL_EVENTS, TRACE_PKT_DAMAGED, sqn, pktInfo.count, fileId);
+
     if (appState->verbose) {
         if (pktInfo.pkt.header.flags.ack == 1) {
-            printf("Ack %u sent\n", pktInfo.pkt.header.sqn % connection.sqnRange);
+            print("Ack %u sent\n", pktInfo.pkt.header.sqn);
+        } else if (parity) {
+            print("Parity %u for block %u sent\n", pktInfo.pkt.header.fecIndex, pktInfo.pkt.header.sqn);
         } else {
-            if (pktInfo.count > 1) {
-                connection.resentPkts++;
-                printf("Packet %u re-transmitted\n", pktInfo.pkt.header.sqn % connection.sqnRange);
+            if (resent) {
+                print("Packet %u re-transmitted\n", pktInfo.pkt.header.sqn);
             } else {
-                printf("Packet %u sent\n", pktInfo.pkt.header.sqn % connection.sqnRange);
+                print("Packet %u sent\n", pktInfo.pkt.header.sqn);
             }
         }
 
         if (lost) {
-            printf("Packet LOST in transmission\n");
+            print("Packet LOST in transmission\n");
         }
     }
 
-    if (appState->role == CLIENT) {
-        if (pktInfo.pkt.header.sqn > connection.lastFrame.lastFrameSent) connection.lastFrame.lastFrameSent = pktInfo.pkt.header.sqn;
-        pktInfo.timeout = chrono::system_clock::now() + connection.timeoutInterval;
-        if (pktInfo.pkt.header.flags.ping != 1 && pktInfo.pkt.header.flags.syn != 1) connection.timeoutQueue.push(&pktInfo);
+    if (appState->role == CLIENT && parity) {
+        connection.fecPkts++;
+        connection.pacer.onSend(sizeof(Packet::Header) + pktInfo.pkt.header.pktSize, connection.congestion.smoothedRtt(),
+                                connection.congestion.window(), connection.congestion.inSlowStart());
+    } else if (appState->role == CLIENT) {
+        if (pktInfo.pkt.sqn > connection.lastFrame.lastFrameSent) connection.lastFrame.lastFrameSent = pktInfo.pkt.sqn;
+        pktInfo.sent = Clock::now();
+        pktInfo.timeout = pktInfo.sent + connection.timeoutInterval;
+
+        // The SYNs of files after the first are numbered like data, and paced and resent along with it
+        bool sequenced = pktInfo.pkt.header.flags.syn != 1 || pktInfo.pkt.header.fileId != 0;
+        if (pktInfo.pkt.header.flags.ping != 1 && sequenced) {
+            connection.pacer.onSend(sizeof(Packet::Header) + pktInfo.pkt.header.pktSize, connection.congestion.smoothedRtt(),
+                                    connection.congestion.window(), connection.congestion.inSlowStart());
+        }
+        if (pktInfo.pkt.header.flags.ping != 1 && sequenced) connection.timeoutQueue.push(&pktInfo);
+        updateQueueGauges(connection);
     }
 }
 
 void ConnectionController::sendPacket(Connection &connection, Packet &pkt) {
+    Packet sealed;
+    if (connection.cipher && !connection.cipher->seal(pkt, sealed)) {
+        print("Unable to encrypt packet %lu, Closing connection\n", pkt.sqn);
+        connection.status = ERROR;
+        return;
+    }
+    Packet &wire = connection.cipher ? sealed : pkt;
+
     // Send header
-    if (write(connection.sockfd, (Packet::Header *) &(pkt.header), sizeof(Packet::Header)) < 0) {
+    if (connection.transport->send((Packet::Header *) &(wire.header), sizeof(Packet::Header)) < 0) {
         fprintf(stderr, "Error writing header to socket\nError #: %d\n", errno);
         connection.status = ERROR;
 
         return;
     }
 
-    if (pkt.header.pktSize != 0 && !(pkt.header.flags.syn == 1 && pkt.header.flags.ack == 1)) {
+    if (wire.header.handshakeSize() != 0 && connection.transport->send(&wire.handshake, sizeof(Packet::Handshake)) < 0) {
+        fprintf(stderr, "Error writing handshake to socket\nError #: %d\n", errno);
+        connection.status = ERROR;
+
+        return;
+    }
+
+    if (wire.header.payloadSize() != 0) {
         // Send payload
-        if (write(connection.sockfd, (void *) pkt.payload, pkt.header.pktSize) < 0) {
+        if (connection.transport->send((void *) wire.payload, wire.header.payloadSize()) < 0) {
             fprintf(stderr, "Error writing payload to socket\nError #: %d\n", errno);
             connection.status = ERROR;
 
             return;
         }
     }
+    connection.metrics->bytesSent.add(sizeof(Packet::Header) + pkt.header.handshakeSize() + pkt.header.payloadSize());
+    TRACE(TRACE_LEVEL_PACKETS, pkt.header.flags.ack == 1 ? TRACE_ACK_SENT : TRACE_PKT_SENT, pkt.sqn, pkt.header.payloadSize(), pkt.header.fileId);
 
     if (appState->verbose) {
         if (pkt.header.flags.ack == 1) {
-            printf("Ack %u sent\n", pkt.header.sqn % connection.sqnRange);
+            print("Ack %u sent\n", pkt.header.sqn);
         } else {
-            printf("Packet %u sent\n", pkt.header.sqn % connection.sqnRange);
+            print("Packet %u sent\n", pkt.header.sqn);
         }
     }
 }
 
 Packet ConnectionController::recPacket(Connection &connection, bool &timeout, bool &badPkt) {
-    auto *pkt = new Packet();
-    char headerBuffer[sizeof(Packet::Header)];
-    bzero(headerBuffer, sizeof(Packet::Header));
+    Packet pkt;
     timeout = false;
     badPkt = false;
     connection.bytesRead = 0; // Overall bytes read per loop
     ssize_t bytesRead = 0; // bytes read per cycle per loop
 
     // Listen for response
-    // Read header
+    // Read header straight into the packet; it says how much payload follows and where it goes
+    char *header = (char *) &pkt.header;
     do {
-        bytesRead = read(connection.sockfd, (void *) (headerBuffer + connection.bytesRead), sizeof(Packet::Header) - connection.bytesRead);
+        bytesRead = connection.transport->receive((void *) (header + connection.bytesRead), sizeof(Packet::Header) - connection.bytesRead);
         if (bytesRead< 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 // No packets received within timeout interval
                 timeout = true;
-                printf("Timed out waiting for packet\n");
+                TRACE(TRACE_LEVEL_EVENTS, TRACE_RECV_TIMEOUT, 0, 0, connection.fileId);
+                if (appState->verbose) print("Timed out waiting for packet\n");
             } else {
                 fprintf(stderr, "Error reading header from socket\nError #: %d\n", errno);
                 connection.status = ERROR;
-                return *pkt;
+                return pkt;
             }
         }
 
+        if (bytesRead == 0) {
+            // Peer closed the connection; nothing more will arrive so treat it like running out the TTL
+            print("Connection closed by peer\n");
+            if (connection.status == OPEN) connection.status = CLOSED;
+            timeout = true;
+        }
+
         if (bytesRead > 0) connection.bytesRead += bytesRead;
     } while (connection.bytesRead < sizeof(Packet::Header) && bytesRead >= 0 && !timeout);
-    memcpy(&pkt->header, headerBuffer, sizeof(Packet::Header));
 
-    if (!timeout && pkt->header.pktSize > 0 && !(pkt->header.flags.syn == 1 && pkt->header.flags.ack == 1)) {
-        pkt->initPayload();
+    // SYNs and pings carry their handshake between the header and the payload
+    if (!timeout && pkt.header.handshakeSize() != 0) {
+        char *handshake = (char *) &pkt.handshake;
         connection.bytesRead = 0;
         bytesRead = 0;
 
         do {
-            bytesRead = read(connection.sockfd,  pkt->payload + connection.bytesRead, pkt->header.pktSize - connection.bytesRead);
+            bytesRead = connection.transport->receive(handshake + connection.bytesRead, sizeof(Packet::Handshake) - connection.bytesRead);
+            if (bytesRead < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    timeout = true;
+                    TRACE(TRACE_LEVEL_EVENTS, TRACE_RECV_TIMEOUT, 0, 0, connection.fileId);
+                    if (appState->verbose) print("Timed out waiting for packet\n");
+                } else {
+                    fprintf(stderr, "Error reading handshake from socket\nError #: %d\n", errno);
+                    connection.status = ERROR;
+                    return pkt;
+                }
+            }
+
+            if (bytesRead > 0) connection.bytesRead += bytesRead;
+        } while (connection.bytesRead < sizeof(Packet::Handshake) && bytesRead >= 0 && !timeout);
+    }
+
+    // Recover the full sequence number relative to the base of our window
+    if (!timeout) {
+        uint64_t base = (appState->role == CLIENT) ? connection.lastRec.lastAckRec + 1 : connection.lastRec.lastFrameRec + 1;
+        pkt.sqn = unwrapSqn(connection, pkt.header.sqn, base);
+    }
+
+    // The payload is read into the buffer it's kept in until written out, and never copied again
+    if (!timeout && pkt.header.payloadSize() > 0) {
+        pkt.initPayload();
+        connection.bytesRead = 0;
+        bytesRead = 0;
+
+        do {
+            bytesRead = connection.transport->receive(pkt.payload + connection.bytesRead, pkt.header.payloadSize() - connection.bytesRead);
             if (bytesRead < 0) {
                 if (errno == EAGAIN || errno == EWOULDBLOCK) {
                     // No packets received within timeout interval
                     timeout = true;
-                    printf("Timed out waiting for packet\n");
+                    TRACE(TRACE_LEVEL_EVENTS, TRACE_RECV_TIMEOUT, pkt.sqn, 0, connection.fileId);
+                    if (appState->verbose) print("Timed out waiting for packet\n");
                 } else {
                     fprintf(stderr, "Error reading header from socket\nError #: %d\n", errno);
                     connection.status = ERROR;
-                    return *pkt;
+                    return pkt;
                 }
             }
 
             if (bytesRead > 0) connection.bytesRead += bytesRead;
-        } while (connection.bytesRead < pkt->header.pktSize && bytesRead >= 0 && !timeout);
+        } while (connection.bytesRead < pkt.header.payloadSize() && bytesRead >= 0 && !timeout);
     }
 
         if (appState->verbose && !timeout) {
-            if (pkt->header.flags.ack == 1) {
-                printf("Ack %u received\n", pkt->header.sqn % connection.sqnRange);
+            if (pkt.header.flags.ack == 1) {
+                print("Ack %u received\n", pkt.header.sqn);
+            } else if (pkt.header.flags.fec == 1) {
+                print("Parity %u for block %u received\n", pkt.header.fecIndex, pkt.header.sqn);
             } else {
-                printf("Packet %u received\n", pkt->header.sqn % connection.sqnRange);
+                print("Packet %u received\n", pkt.header.sqn);
             }
         }
 //    }
 
-    if (timeout) return *pkt;
+    if (timeout) return pkt;
+
+    if (pkt.header.flags.ack == 1) {
+        TRACE(TRACE_LEVEL_PACKETS, TRACE_ACK_RECEIVED, pkt.sqn, 0, pkt.header.fileId);
+    } else if (pkt.header.flags.fec == 1) {
+        TRACE(TRACE_LEVEL_PACKETS, TRACE_PARITY_RECEIVED, pkt.sqn, pkt.header.fecIndex, pkt.header.fileId);
+    } else {
+        TRACE(TRACE_LEVEL_PACKETS, TRACE_PKT_RECEIVED, pkt.sqn, pkt.header.payloadSize(), pkt.header.fileId);
+    }
 
     // Server tracks the total number of packets received
-    if (appState->role == SERVER && pkt->header.flags.ping != 1 && pkt->header.flags.ack != 1) connection.pktsSent++;
+    bool data = pkt.header.flags.ping != 1 && pkt.header.flags.ack != 1 && pkt.header.flags.fec != 1;
+    if (appState->role == SERVER && data) connection.pktsSent++;
 
+    ConnectionMetrics &metrics = *connection.metrics;
+    metrics.bytesReceived.add(sizeof(Packet::Header) + pkt.header.handshakeSize() + pkt.header.payloadSize());
+    if (data) metrics.pktsReceived.add();
 
-    // Check if damaged
-    int chksum = pkt->header.chksum;
-    pkt->header.chksum = 0;
 
-    if (chksum != PacketBuilder::generateChksum(pkt)) {
+    // Check if damaged, or when encrypted, tampered with
+    bool intact;
+    if (!appState->connectionSettings.psk.empty() || pkt.header.cipher != NO_CIPHER) {
+        intact = openPacket(connection, pkt);
+    } else {
+        int chksum = pkt.header.chksum;
+        pkt.header.chksum = 0;
+        intact = chksum == PacketBuilder::generateChksum(&pkt);
+    }
+
+    if (!intact) {
         badPkt = true;
-        printf("Checksum FAILED!\n");
-        // Assume this broken packet will be resent so increment counter
-        if (appState->role == SERVER) connection.resentPkts++;
+        TRACE(TRACE_LEVEL_EVENTS, TRACE_CHKSUM_FAILED, pkt.sqn, 0, pkt.header.fileId);
+        if (appState->verbose) print("Checksum FAILED!\n");
+        metrics.damagedPkts.add();
+        // Assume this broken packet will be resent so increment counter (parity never is)
+        if (appState->role == SERVER && pkt.header.flags.fec != 1) {
+            connection.resentPkts++;
+            metrics.retransmits.add();
+        }
     } else {
-        if (appState->role == SERVER) printf("Checksum OK\n");
+        if (appState->role == SERVER && appState->verbose) print("Checksum OK\n");
+        if (appState->role == SERVER && data) metrics.payloadBytes.add(pkt.header.payloadSize());
+    }
+
+    return pkt;
+}
+
+// Authenticates and decrypts a received packet, returning false if it was damaged or tampered with. With a pre-shared key
+// every packet has to be sealed under it; without one, none can be opened
+bool ConnectionController::openPacket(Connection &connection, Packet &pkt) {
+    vector<unsigned char> &psk = appState->connectionSettings.psk;
+    bool handshake = pkt.header.flags.syn == 1 || pkt.header.flags.ping == 1;
+
+    if (psk.empty() || pkt.header.cipher == NO_CIPHER || pkt.header.cipher > CHACHA20_POLY1305) {
+        if (handshake) print(psk.empty() ? "Packet is encrypted, but no pre-shared key was given\n" : "Packet isn't encrypted, Dropping it\n");
+        return false;
     }
 
-    return *pkt;
+    // The server seals with whichever suite the client chose
+    if (!connection.cipher) connection.cipher = make_shared<PacketCipher>((CipherSuite) pkt.header.cipher, psk, false);
+    return connection.cipher->open(pkt);
 }
 
 // Implements full round trip communication between client/server, returning the ack'd packet
 Packet ConnectionController::sendAndRec(Connection &connection, PacketInfo &pktInfo, bool &timeout, bool &badPkt) {
-    auto *pkt = new Packet();
+    Packet pkt;
     bool acked = false;
 
     // Resend packet up to RETRY times or until ack'd
     // TODO: Should probably utilize the timeout queue instead of a while loop
-    while (pktInfo.count < appState->connectionSettings.retrylimit && pkt->header.flags.ack != 1) {
+    while (pktInfo.count < appState->connectionSettings.retrylimit && pkt.header.flags.ack != 1) {
         sendPacket(connection, pktInfo);
-        *pkt = recPacket(connection, timeout, badPkt);
+        pkt = recPacket(connection, timeout, badPkt);
 
-        if (pkt->header.flags.ack == 1 && pkt->header.sqn == pktInfo.pkt.header.sqn) {
+        if (pkt.header.flags.ack == 1 && pkt.sqn == pktInfo.pkt.sqn) {
             acked = true;
             break;
         }
@@ -408,9 +676,9 @@ Packet ConnectionController::sendAndRec(Connection &connection, PacketInfo &pktI
     }
 
     // We've exceeded retry limit but haven't received an ACK so close connection
-    if (!acked || badPkt || timeout || (pktInfo.pkt.header.flags.syn == 1 && pkt->header.flags.syn != 1)) connection.status = CLOSED;
+    if (!acked || badPkt || timeout || (pktInfo.pkt.header.flags.syn == 1 && pkt.header.flags.syn != 1)) connection.status = CLOSED;
 
-    return *pkt;
+    return pkt;
 }
 
 // Receives a packet from the client and acks it, returning a valid client data packet
@@ -425,17 +693,37 @@ Packet ConnectionController::recAndAck(Connection &connection, bool &timeout, bo
     pktBuilder.setDestAddr(connection.destAddr);
     pktBuilder.setWSize(connection.wSize);
     pktBuilder.setSqnBits(connection.sqnBits);
+    pktBuilder.setProtocol(connection.protocol);
 
      do {
          pktBuilder.resetFlags();
+         if (connection.fecDecoder.enabled()) connection.fecDecoder.release(connection.lastRec.lastFrameRec + 1);
+
+         // Wait for next packet, unless one has been rebuilt from parity
+         bool rebuilt = nextRebuiltPacket(connection, pkt);
+         if (rebuilt) {
+             timeout = false;
+             badPkt = false;
+         } else {
+             pkt = recPacket(connection, timeout, badPkt);
+         }
 
-         // Wait for next packet
-         pkt = recPacket(connection, timeout, badPkt);
         // If we've timed out, then the connection exceeded it's TTL so we need to close the connection
         if (timeout) break;
 
+        // Parity only feeds the decoder and is never ACK'd
+        if (pkt.header.flags.fec == 1) {
+            if (!badPkt && connection.fecDecoder.enabled()) decodeFec(connection, pkt);
+            badPkt = false;
+            delete[] pkt.payload;
+            continue;
+        }
+
+        // The SYNs of later files are sequenced and handled like data; only the handshake's is answered here
+        bool handshakeSyn = pkt.header.flags.syn == 1 && pkt.header.fileId == 0;
+
         // Packet damaged or right of window
-        if (badPkt || pkt.header.sqn > (connection.lastRec.lastFrameRec + connection.wSize)) {
+        if (badPkt || pkt.sqn > (connection.lastRec.lastFrameRec + connection.wSize)) {
             // Invalid packet; discard
             printWindow(connection);
             badPkt = false;
@@ -443,9 +731,9 @@ Packet ConnectionController::recAndAck(Connection &connection, bool &timeout, bo
         }
 
         // Check if within window and a valid data packet for return; if left of window, just send ACK
-        if ((pkt.header.sqn > connection.lastRec.lastFrameRec) &&
-                (pkt.header.sqn <= (connection.lastRec.lastFrameRec + connection.wSize)) &&
-                (pkt.header.flags.ping != 1 && pkt.header.flags.syn != 1)) {
+        if ((pkt.sqn > connection.lastRec.lastFrameRec) &&
+                (pkt.sqn <= (connection.lastRec.lastFrameRec + connection.wSize)) &&
+                (pkt.header.flags.ping != 1 && !handshakeSyn)) {
            validPkt = true;
         }
 
@@ -454,36 +742,96 @@ Packet ConnectionController::recAndAck(Connection &connection, bool &timeout, bo
             return pkt;
         }
 
+        // Keep a copy of each new data packet so the rest of its FEC block can be rebuilt if one goes missing
+        if (!rebuilt && connection.fecDecoder.enabled() && pkt.sqn > connection.lastRec.lastFrameRec &&
+                pkt.header.flags.ping != 1 && !handshakeSyn) {
+            decodeFec(connection, pkt);
+        }
+
+        // GBN only accepts the next in-order packet; anything else is discarded and the last in-order packet re-ACK'd
+        bool discarded = false;
+        if (connection.protocol == GBN && pkt.header.flags.ping != 1 && !handshakeSyn &&
+                pkt.sqn != (connection.lastRec.lastFrameRec + 1)) {
+            validPkt = false;
+            discarded = true;
+        }
+
         // Toggle flag tracking if we're just starting to sync. If sync packet is sent again (lost/damaged), then
         // increment resent packet counter
-        if (pkt.header.sqn <= connection.lastRec.lastFrameRec && !startSyn) {
+        if (pkt.sqn <= connection.lastRec.lastFrameRec && !startSyn) {
             connection.resentPkts++;
+            connection.metrics->retransmits.add();
         } else {
             if (pkt.header.flags.ping != 1) startSyn = false;
         }
 
-        // Send ACK
-        pktBuilder.setSqn(pkt.header.sqn);
+        // Send ACK (cumulative for GBN)
+        pktBuilder.setSqn(discarded ? connection.lastRec.lastFrameRec : pkt.sqn);
         pktBuilder.enableAckBit();
 
-        if (pkt.header.flags.syn == 1 && pkt.header.flags.ping != 1) {
+        if (handshakeSyn && pkt.header.flags.ping != 1) {
+            // Data shaped by the client's parameters is already on its way, so they're adopted rather than dictated
+            if (pkt.header.flags.fast == 1 && !adoptClientParameters(connection, pkt)) {
+                timeout = true;
+                break;
+            }
+            pktBuilder.setWSize(connection.wSize);
+            pktBuilder.setSqnBits(connection.sqnBits);
+            pktBuilder.setProtocol(connection.protocol);
+
             pktBuilder.enableSynBit();
             pktBuilder.setPktSize(connection.pktSizeBytes);
 
-            connection.filename = pkt.payload;
-        } else if (pkt.header.flags.fin == 1) {
+            // Decode FEC if the client asked for it
+            if (!connection.fecDecoder.enabled() && pkt.header.fecData > 0 && pkt.header.fecParity > 0 &&
+                    pkt.header.fecData + pkt.header.fecParity <= MAX_FEC_SHARDS) {
+                connection.fecData = pkt.header.fecData;
+                connection.fecParity = pkt.header.fecParity;
+                connection.fecDecoder = FecDecoder(connection.fecData, connection.fecParity, connection.pktSizeBytes);
+            }
+            pktBuilder.setFec(connection.fecData, connection.fecParity);
+
+            // Inflate payloads if the client asked for a codec we know
+            if (!connection.decompressor && pkt.header.compression == DEFLATE) {
+                connection.compression = DEFLATE;
+                connection.decompressor = make_shared<Decompressor>();
+                connection.rawBuffer.resize(connection.pktSizeBytes);
+            }
+            pktBuilder.setCompression(connection.compression);
+
+            if (!acceptFile(connection, pkt, pktBuilder)) {
+                timeout = true;
+                break;
+            }
+        } else if (pkt.header.flags.fin == 1 && !discarded) {
             pktBuilder.enableFinBit();
         } else if (pkt.header.flags.ping == 1) {
             pktBuilder.enablePingBit();
         }
 
         ackPkt = pktBuilder.buildPacket();
+        if (ackPkt.header.flags.syn == 1 && (connection.resuming || connection.basis != NULL)) attachSynAckPayload(connection, ackPkt);
+        if (!discarded && connection.store && pkt.header.flags.manifest == 1 && pkt.header.flags.fin != 1) {
+            attachNeededChunks(connection, pkt, ackPkt);
+        }
         pktInfo.pkt = ackPkt;
 
-        sendPacket(connection, pktInfo);
+        // Under --ack-durable a new packet's ACK waits until it's been written, as it does once dedup is on, so the
+        // file's checked against the client's digest before the ACK that completes it goes
+        if ((appState->connectionSettings.ackDurable || connection.store) && validPkt && !discarded) {
+            connection.heldAck = pktInfo;
+            connection.ackHeld = true;
+        } else {
+            sendPacket(connection, pktInfo);
+        }
+
+        if (discarded) {
+            delete[] pkt.payload;
+            continue;
+        }
 
-        // No need to return PING or SYN packets, just ACK and continue
-        if ((pkt.header.flags.ping == 1 && pkt.header.flags.fin != 1) || pkt.header.flags.syn == 1) continue;
+        // No need to return PING or handshake SYN packets, just ACK and continue
+        if ((pkt.header.flags.ping == 1 && pkt.header.flags.fin != 1) || handshakeSyn) continue;
         if (pkt.header.flags.ping == 1 && pkt.header.flags.fin == 1) break;
     } while (!validPkt);
 
@@ -496,57 +844,47 @@ void ConnectionController::transferFile(Connection &connection) {
     bool badPkt = false;
     bool finished = false;
 
-    if (appState->role == CLIENT) {
+    if (appState->role == CLIENT && connection.protocol == GBN) {
+        sendGoBackN(connection);
+    } else if (appState->role == CLIENT) {
         // Client
         // Read file and send chunks along to server
         char *fileBuffer = new char[connection.pktSizeBytes];
-        PacketBuilder pktBuilder;
-        pktBuilder.setSrcAddr(connection.srcAddr);
-        pktBuilder.setDestAddr(connection.destAddr);
-        pktBuilder.setSqnBits(connection.sqnBits);
-        pktBuilder.setPktSize(connection.pktSizeBytes);
-        pktBuilder.setWSize(connection.wSize);
+        PacketBuilder pktBuilder = dataPacketBuilder(connection, connection.pktSizeBytes);
+        PacketBuilder parityBuilder = parityPacketBuilder(connection);
 
         do {
             // Fill the window/packet buffer
-            if (!finished) {
-                for (unsigned long i = (connection.lastFrame.lastFrameSent + 1); i <= (connection.wSize + connection.lastRec.lastAckRec); i++) {
-                    // Create data packet
-                    pktBuilder.setSqn(i);
-                    bzero(fileBuffer, connection.pktSizeBytes);
-                    connection.bytesRead = fread(fileBuffer, sizeof(char), connection.pktSizeBytes, connection.file);
-
-                    // If we read less than our packet payload size, then we're on our last packet
-                    if (connection.bytesRead < connection.pktSizeBytes) {
-                        pktBuilder.setPktSize(connection.bytesRead);
-                        pktBuilder.enableFinBit();
-                        finished = true;
-                    }
-
-                    pktBuilder.setPayload(fileBuffer);
-                    Packet newPkt = pktBuilder.buildPacket();
-                    addToPktBuffer(connection, newPkt);
-
-                    if (finished) break;
-                }
-            }
+            if (!finished) finished = fillWindow(connection, pktBuilder, parityBuilder, fileBuffer);
 
             printWindow(connection);
 
+            // Skip over packets ACK'd since they were queued so they can't hide a timed out packet behind them, and over
+            // slots refilled since by a packet not sent yet, which would otherwise go out ahead of the packets before it
+            while (!connection.timeoutQueue.empty() && (isAcked(connection, connection.timeoutQueue.front()->pkt.sqn) ||
+                                                        connection.timeoutQueue.front()->count == 0)) {
+                connection.timeoutQueue.pop();
+            }
+
             // Get next packet from buffer and send it
-            if (!connection.timeoutQueue.empty() && connection.timeoutQueue.front()->timeout < chrono::system_clock::now() && !connection.timeoutQueue.front()->acked) {
+            if (!connection.timeoutQueue.empty() && connection.timeoutQueue.front()->timeout < Clock::now() &&
+                    pacedSendAllowed(connection, *connection.timeoutQueue.front())) {
                 // Resend packet
                 PacketInfo *pktInfo = connection.timeoutQueue.front();
                 connection.timeoutQueue.pop();
-                printf("Packet %u *** TIMED OUT ***\n", pktInfo->pkt.header.sqn);
+                TRACE(TRACE_LEVEL_EVENTS, TRACE_RTO_FIRED, pktInfo->pkt.sqn, pktInfo->count, pktInfo->pkt.header.fileId);
+                if (appState->verbose) print("Packet %u *** TIMED OUT ***\n", pktInfo->pkt.header.sqn);
                 timeout = false; // reset flag
 
                 if (pktInfo->count < appState->connectionSettings.retrylimit) {
+                    connection.metrics->rtoFirings.add();
+                    connection.congestion.onLoss();
+                    connection.sizer.onLoss();
                     sendPacket(connection, *pktInfo);
                 } else {
                     char convertedIP[INET_ADDRSTRLEN];
                     inet_ntop(AF_INET, &connection.destAddr.sin_addr, convertedIP, INET_ADDRSTRLEN);
-                    printf("Packet %u exceeded RETRY limit. Closing connection to %s...\n", pktInfo->pkt.header.sqn, convertedIP);
+                    print("Packet %u exceeded RETRY limit. Closing connection to %s...\n", pktInfo->pkt.header.sqn, convertedIP);
 
                     pktBuilder.resetFlags();
                     pktBuilder.enableAckBit();
@@ -560,51 +898,54 @@ void ConnectionController::transferFile(Connection &connection) {
                 }
             }
 
-            // Send packets in window
-            for (unsigned int i = connection.lastFrame.lastFrameSent + 1; i <= (connection.wSize + connection.lastRec.lastAckRec); i++) {
-                if (connection.pktBuffer[i % connection.wSize].pkt.header.sqn <= connection.lastFrame.lastFrameSent) break;
-                if (!connection.pktBuffer[i % connection.wSize].acked) sendPacket(connection, connection.pktBuffer[i % connection.wSize]);
+            // Send packets in (congestion) window
+            for (uint64_t i = connection.lastFrame.lastFrameSent + 1; i <= (connection.congestion.window() + connection.lastRec.lastAckRec); i++) {
+                if (connection.pktBuffer[i].pkt.sqn <= connection.lastFrame.lastFrameSent) break;
+                if (!pacedSendAllowed(connection, connection.pktBuffer[i])) break;
+                if (!connection.pktBuffer.isSet(i)) sendPacket(connection, connection.pktBuffer[i]);
             }
+            sendParity(connection);
+
+            // Don't block on ACKs past the next paced send
+            chrono::microseconds paceDelay = connection.pacer.delay(nextFrameBytes(connection));
+            if (paceDelay.count() > 0 && !waitForPacket(connection, paceDelay)) continue;
 
             // Rec and process ACKs
             Packet ackPkt;
             ackPkt = recPacket(connection, timeout, badPkt);
-            if (!timeout && !badPkt && ackPkt.header.flags.ack == 1) {
-                if (ackPkt.header.sqn == (connection.lastRec.lastAckRec + 1)) connection.lastRec.lastAckRec++;
+            if (!timeout && !badPkt && ackPkt.header.flags.syn == 1) {
+                // A fast-start SYN-ACK, arriving after data has already gone out, or the SYN-ACK of a later file
+                acceptSynAck(connection, ackPkt);
+            } else if (!timeout && !badPkt && ackPkt.header.flags.ack == 1) {
+                PacketInfo &ackedInfo = connection.pktBuffer[ackPkt.sqn];
+                resolveManifest(connection, ackPkt);
+
+                // Mark associated packet as ACK'd, ignoring duplicate ACKs for packets whose slot has since been reused
+                if (ackPkt.sqn > connection.lastRec.lastAckRec && ackedInfo.pkt.sqn == ackPkt.sqn && !connection.pktBuffer.isSet(ackPkt.sqn)) {
+                    chrono::microseconds rtt = rttSample(ackedInfo);
+                    connection.pktBuffer.set(ackPkt.sqn);
+                    connection.congestion.onAck(rtt);
+                    if (rtt.count() > 0) connection.metrics->ackLatencyUs.record(rtt.count());
+                }
 
-                // Mark associated packet as ACK'd
-                connection.pktBuffer[ackPkt.header.sqn % connection.wSize].acked = true;
+                // Slide the window over the run of ACK'd packets following lastAckRec
+                connection.lastRec.lastAckRec += connection.pktBuffer.advance(connection.lastRec.lastAckRec + 1, connection.wSize);
+                if (connection.dedup) connection.dedup->acked(connection.lastRec.lastAckRec);
 
                 // Remove ACK'd packets from timeout queue
-                while(!connection.timeoutQueue.empty() && connection.timeoutQueue.front()->acked) {
+                while(!connection.timeoutQueue.empty() && isAcked(connection, connection.timeoutQueue.front()->pkt.sqn)) {
                     connection.timeoutQueue.pop();
                 }
 
-                while (!connection.timeoutQueue.empty() && connection.timeoutQueue.front()->pkt.header.sqn == ackPkt.header.sqn) {
-                    printf("Ack'd Packet detected in queue; removing\n");
+                while (!connection.timeoutQueue.empty() && connection.timeoutQueue.front()->pkt.sqn == ackPkt.sqn) {
                     connection.timeoutQueue.pop();
-                    printf("Queue size: %lu\n", connection.timeoutQueue.size());
-                }
-
-                // Check if we now have a series of ack'd packets; if so, update lastackrec
-                bool sequence = false;
-                int sequenceNum = 0;
-                for (int i = 1; i < connection.wSize; i++) {
-                    if (connection.pktBuffer[(connection.lastRec.lastAckRec + i) % connection.wSize].acked &&
-                            (connection.pktBuffer[(connection.lastRec.lastAckRec + i) % connection.wSize].pkt.header.sqn > connection.lastRec.lastAckRec)) {
-                        sequence = true;
-                        sequenceNum++;
-                    } else {
-                        break;
-                    }
+                    TRACE(TRACE_LEVEL_EVENTS, TRACE_ACKED_IN_QUEUE, ackPkt.sqn, connection.timeoutQueue.size(), ackPkt.header.fileId);
+                    if (appState->verbose) print("Ack'd Packet detected in queue; removing (queue size: %lu)\n", connection.timeoutQueue.size());
                 }
+                updateQueueGauges(connection);
 
-                if (sequence) {
-                    connection.lastRec.lastAckRec += sequenceNum;
-                }
-
-                // If we're finished AND our timeout queue is empty, then we've sent all our packets so close the connection
-                if (finished && connection.lastRec.lastAckRec == connection.lastFrame.lastFrameSent) {
+                // If we're finished AND everything up to the final packet is ACK'd, then we've sent all our packets so close the connection
+                if (finished && connection.lastRec.lastAckRec == connection.finalSqn) {
                     // Send final packet to signal time to close connection
                     pktBuilder.setSqn(connection.lastFrame.lastFrameSent + 1);
                     pktBuilder.setPktSize(0);
@@ -613,7 +954,7 @@ void ConnectionController::transferFile(Connection &connection) {
                     sendPacket(connection, pkt);
 
                     connection.status = COMPLETE;
-                    printf("Session successfully terminated\n");
+                    print("Session successfully terminated\n");
                 }
             } else {
                 // Something went wrong
@@ -623,16 +964,22 @@ void ConnectionController::transferFile(Connection &connection) {
             }
 
         } while(connection.status == OPEN);
+
+        delete[] fileBuffer;
+    } else if (appState->role == SERVER && connection.status == OPEN && connection.protocol == GBN) {
+        receiveGoBackN(connection);
     } else if (appState->role == SERVER && connection.status == OPEN) {
         // Server
         Packet pkt;
         PacketInfo pktInfo;
         bool inOrder = false;
+        int64_t buffered = 0; // packets held in the buffer until the gap before them is filled
 
         do {
             inOrder = false;
 
-            if (connection.lastRec.lastFrameRec == connection.finalSqn) {
+            // finalSqn is only known once the FIN packet arrives
+            if (connection.finalSqn != 0 && connection.lastRec.lastFrameRec == connection.finalSqn) {
                 finished = true;
                 connection.status = COMPLETE;
             }
@@ -641,247 +988,1419 @@ void ConnectionController::transferFile(Connection &connection) {
 
             if ((timeout && !finished) || (pkt.header.flags.ack == 1 && !finished)) {
                 // We've exceeded our TTL and haven't finished our transfer
-                printf("Connection closed\n");
+                print("Connection closed\n");
                 connection.status = CLOSED;
                 break;
             } else if ((timeout && finished) || (pkt.header.flags.ack == 1 && finished)) {
-                printf("Session successfully terminated\n");
+                print("Session successfully terminated\n");
                 break;
             }
 
-            // If we received a FIN packet, then we know what our last frame should be
+            // Anything after the last FIN belongs to the client's next file
+            if (finished) {
+                finished = false;
+                connection.status = OPEN;
+            }
+
+            // If we received a FIN packet, then we know what our last frame should be (until the next file's arrives)
             if (pkt.header.flags.fin == 1) {
-                connection.finalSqn = pkt.header.sqn;
+                connection.finalSqn = max(connection.finalSqn, pkt.sqn);
             }
 
             // Check if needs to be buffered (out-of-order) or not and if it's a retransmission
-            if (pkt.header.sqn == (connection.lastRec.lastFrameRec + 1)) {
+            if (pkt.sqn == (connection.lastRec.lastFrameRec + 1)) {
                 // In-order packet
 
                 connection.lastRec.lastFrameRec++;
                 inOrder = true;
-            } else if (connection.pktBuffer[pkt.header.sqn % connection.wSize].pkt.header.sqn == pkt.header.sqn &&
-                connection.pktBuffer[pkt.header.sqn % connection.wSize].acked) {
+            } else if (connection.pktBuffer.isSet(pkt.sqn)) {
                 // Out-of-order but already buffered/acked
                 connection.resentPkts++;
-            } else if (pkt.header.sqn > (connection.lastRec.lastFrameRec + 1)) {
-                // Out-of-order but not buffered/acked yet
-                addToPktBuffer(connection, pkt);
-                connection.pktBuffer[pkt.header.sqn % connection.wSize].acked = true;
+                connection.metrics->retransmits.add();
+                delete[] pkt.payload;
+            } else if (pkt.sqn > (connection.lastRec.lastFrameRec + 1)) {
+                // Out-of-order but not buffered/acked yet. Written where it belongs straight away if it can be, leaving
+                // just its bit to say it's arrived
+                if (placeable(connection, pkt)) {
+                    writePayload(connection, pkt, true);
+                    delete[] pkt.payload;
+                } else {
+                    addToPktBuffer(connection, pkt);
+                }
+                connection.pktBuffer.set(pkt.sqn);
+                buffered++;
             }
 
             // Write in-order packet payloads to file
             if (inOrder) {
 
-                if (pkt.header.pktSize > 0) {
-                    fwrite(pkt.payload, sizeof(char), pkt.header.pktSize, connection.file);
-                }
+                writePayload(connection, pkt);
+
+                delete[] pkt.payload;
             }
 
             // Check for if we now have a valid sequence buffered, and if so, write them all in series
-            bool sequence = false;
-            int sequenceNum = 0;
-            for (int i = 1; i < connection.wSize; i++) {
-                if ((connection.pktBuffer[(connection.lastRec.lastFrameRec + i) % connection.wSize].acked) &&
-                (connection.pktBuffer[(connection.lastRec.lastFrameRec + i) % connection.wSize].pkt.header.sqn > connection.lastRec.lastFrameRec)) {
-                    if (pkt.header.pktSize > 0) {
-                        fwrite(connection.pktBuffer[(connection.lastRec.lastFrameRec + i) % connection.wSize].pkt.payload, sizeof(char), pkt.header.pktSize, connection.file);
-                    }
-
-                    sequence = true;
-                    sequenceNum++;
-                } else {
-                    break;
-                }
-            }
+            unsigned int sequenceNum = connection.pktBuffer.advance(connection.lastRec.lastFrameRec + 1, connection.wSize);
+            for (uint64_t i = 1; i <= sequenceNum; i++) {
+                // Those placed as they arrived are already written
+                uint64_t sqn = connection.lastRec.lastFrameRec + i;
+                if (!connection.pktBuffer.hasSlots() || connection.pktBuffer[sqn].pkt.sqn != sqn) continue;
+
+                Packet &bufferedPkt = connection.pktBuffer[sqn].pkt;
+                writePayload(connection, bufferedPkt);
 
-            if (sequence) {
-                connection.lastRec.lastFrameRec += sequenceNum;
+                delete[] bufferedPkt.payload;
+                bufferedPkt.payload = NULL;
             }
 
+            connection.lastRec.lastFrameRec += sequenceNum;
+            buffered -= sequenceNum;
+            connection.metrics->windowOccupancy.set(buffered);
+            releaseHeldAck(connection);
+
             if (connection.status == OPEN) printWindow(connection);
         } while (connection.status == OPEN);
     }
 
     if (appState->role == CLIENT) {
-        double mbps;
-        mbps = connection.pktsSent * connection.pktSizeBytes;
-        mbps /= pow(10, 6);  // divide by a megabit
-        mbps /= chrono::duration_cast<chrono::seconds>(chrono::system_clock::now() - connection.timeConnectionStarted).count();
-        mbps *= 8; // Convert from Megabytes-per-second to Megabits-per-second
-
-        printf("Number of original packets sent: %u\n", connection.pktsSent - connection.resentPkts);
-        printf("Number of retransmitted packets: %u\n", connection.resentPkts);
-        printf("Total elapsed time (ms): %lu\n", chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now() - connection.timeConnectionStarted).count());
-
-        mbps = connection.pktsSent * connection.pktSizeBytes;
-        mbps /= pow(10, 6);  // divide by a megabit
-        mbps /= chrono::duration_cast<chrono::seconds>(chrono::system_clock::now() - connection.timeConnectionStarted).count();
-        mbps *= 8; // Convert from Megabytes-per-second to Megabits-per-second
-        printf("Total throughput (Mbps): %G\n", mbps);
-
-        mbps = (connection.pktsSent - connection.resentPkts) * connection.pktSizeBytes;
-        mbps /= pow(10, 6);  // divide by a megabit
-        mbps /= chrono::duration_cast<chrono::seconds>(chrono::system_clock::now() - connection.timeConnectionStarted).count();
-        mbps *= 8; // Convert from Megabytes-per-second to Megabits-per-second
-        printf("Effective throughput (Mbps): %G\n", mbps);
+        // Fractional seconds, so transfers under a second don't divide by zero, over the payload actually sent
+        chrono::duration<double> elapsed = Clock::now() - connection.timeConnectionStarted;
+        uint64_t payloadBytes = connection.metrics->payloadBytes.value();
+        uint64_t originalBytes = payloadBytes - connection.metrics->resentPayloadBytes.value();
+
+        print("Number of original packets sent: %lu\n", connection.pktsSent - connection.resentPkts);
+        print("Number of retransmitted packets: %lu\n", connection.resentPkts);
+        if (connection.fecData > 0) print("Number of FEC parity packets sent: %lu\n", connection.fecPkts);
+        if (connection.compression != NO_COMPRESSION && connection.fileBytes > 0) {
+            print("Compressed payload size: %lu of %lu bytes (%.1f%%)\n", connection.wireBytes, connection.fileBytes, 100.0 * connection.wireBytes / connection.fileBytes);
+        }
+        print("Total elapsed time (ms): %lu\n", (uint64_t) chrono::duration_cast<chrono::milliseconds>(elapsed).count());
+
+        if (elapsed.count() > 0) {
+            print("Total throughput (Mbps): %G\n", payloadBytes * 8 / elapsed.count() / pow(10, 6));
+            print("Effective throughput (Mbps): %G\n", originalBytes * 8 / elapsed.count() / pow(10, 6));
+        }
+
+        const Histogram &latency = connection.metrics->ackLatencyUs;
+        if (latency.count() > 0) {
+            print("ACK latency (us): p50 %lu, p99 %lu, max %lu\n", latency.quantile(0.5), latency.quantile(0.99), latency.max());
+        }
     } else {
-        printf("Last packet seq # received: %u\n", connection.lastRec.lastFrameRec);
-        printf("Number of original packets received: %u\n", connection.pktsSent - connection.resentPkts);
-        printf("Number of retransmitted packets received: %u\n", connection.resentPkts);
+        print("Last packet seq # received: %lu\n", connection.lastRec.lastFrameRec);
+        print("Number of original packets received: %lu\n", connection.pktsSent - connection.resentPkts);
+        print("Number of retransmitted packets received: %lu\n", connection.resentPkts);
+        if (connection.fecData > 0) print("Number of packets rebuilt by FEC: %lu\n", connection.fecPkts);
+        if (connection.store) print("Chunks in store: %lu\n", connection.store->size());
     }
 
     // Cleanup
-    fclose(connection.file);
-    close(connection.sockfd);
-
-    if (appState->role == CLIENT) printf("MD5: %s\n", md5(appState->filePath).c_str());
-    else printf("MD5: %s\n", md5(connection.filename).c_str());
+    while (!connection.fecQueue.empty()) {
+        delete[] connection.fecQueue.front().pktInfo.pkt.payload;
+        connection.fecQueue.pop();
+    }
+    connection.transport->close();
+    finishFile(connection, connection.status == COMPLETE);
+    discardBatches(connection);
 }
 
+// Removes the temporary batches of files that won't be sent now the connection's over (client only)
+void ConnectionController::discardBatches(Connection &connection) {
+    if (connection.batch) remove(connection.filename.c_str());
+    connection.batch = false;
 
-void ConnectionController::addToPktBuffer(Connection &connection, Packet pkt) {
-    auto pktInfo = new PacketInfo();
-    pktInfo->pkt = pkt;
-
-    delete[] connection.pktBuffer[pkt.header.sqn % connection.wSize].pkt.payload;
-    connection.pktBuffer[pkt.header.sqn % connection.wSize] = *pktInfo;
+    while (!connection.pendingFiles.empty()) {
+        if (connection.pendingFiles.front().batch) remove(connection.pendingFiles.front().path.c_str());
+        connection.pendingFiles.pop();
+    }
 }
 
-void ConnectionController::handshake(Connection &connection, bool isPing) {
-    bool timeout = false;
-    bool badPkt = false;
+// Closes out the current file once the last of it has been sent or received, or the connection has died part way
+// through it
+void ConnectionController::finishFile(Connection &connection, bool complete) {
+    if (connection.delta) {
+        print("Delta: %lu bytes copied from the server's copy, %lu literal bytes sent\n", connection.delta->matchedBytes, connection.delta->literalBytes);
+    }
+    if (connection.dedup) {
+        DedupSender &dedup = *connection.dedup;
+        print("Dedup: %lu of %lu chunks (%lu of %lu bytes) already on the server\n", dedup.offeredChunks - dedup.sentChunks,
+               dedup.offeredChunks, dedup.offeredBytes - dedup.sentBytes, dedup.offeredBytes);
+    }
 
-    if (appState->role == CLIENT) {
-        // Client
-        // Create SYN packet and wait for SYN/ACK
-        PacketBuilder pktBuilder;
-        pktBuilder.setSrcAddr(connection.srcAddr);
-        pktBuilder.setDestAddr(connection.destAddr);
-        pktBuilder.setSqnBits(connection.sqnBits);
-        pktBuilder.setWSize(connection.wSize);
-        pktBuilder.setPktSize(connection.pktSizeBytes);
+    // Everything reading the file goes before it's closed
+    connection.compressor.reset();
+    connection.delta.reset();
+    connection.dedup.reset();
 
-        if (isPing) {
-            pktBuilder.setSqn(0);
-            pktBuilder.enablePingBit();
-            pktBuilder.emptyPayload();
+    // A file received whole is made durable before it's closed, and before its resume bitmap goes, unless its last ACK
+    // already waited for that
+    bool sync = appState->connectionSettings.ioMode != IO_BUFFERED || appState->connectionSettings.ackDurable;
+    if (appState->role == SERVER && complete && sync && !connection.synced) syncOutput(connection);
+
+    if (connection.receivedChunks) {
+        if (complete) {
+            connection.receivedChunks->finish();
         } else {
-            pktBuilder.enableSynBit();
-            pktBuilder.setSqn(connection.lastFrame.lastFrameSent);
-            pktBuilder.setPayload(appState->fileName.c_str(), appState->fileName.length());
+            flushOutput(connection);
+            connection.receivedChunks->flush();
         }
+        connection.receivedChunks.reset();
+    }
 
-        Packet pkt = pktBuilder.buildPacket(), ackPkt{};
+    bool direct = (bool) connection.direct;
+    if (connection.file != NULL) fclose(connection.file);
+    connection.file = NULL;
+    connection.direct.reset();
+    connection.synced = false;
+    connection.resuming = false;
+    connection.digestPending = false;
+
+    // Swap the rebuilt copy into place, or drop it if the transfer didn't finish
+    if (connection.basis != NULL) {
+        fclose(connection.basis);
+        connection.basis = NULL;
+        connection.signatures.clear();
+
+        string rebuilt = connection.filename + DELTA_SUFFIX;
+        if (complete) rename(rebuilt.c_str(), connection.filename.c_str());
+        else remove(rebuilt.c_str());
+    }
 
-        PacketInfo pktInfo{};
-        pktInfo.pkt = pkt;
+    if (onDisk()) print("MD5: %s\n", md5(connection.filename).c_str());
 
-        if (isPing) {
-            bool pingTimeout = true;
-            for (int i = 0; i < PING_ATTEMPTS; i++) {
-                ackPkt = sendAndRec(connection,pktInfo, timeout, badPkt);
+    // md5sum has just read the whole file back into the page cache that writing it with O_DIRECT kept it out of
+    if (direct) {
+        int fd = open(connection.filename.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+    }
 
-                // Need to check if we get at least 1 valid connection, otherwise the results aren't valid
-                if (!timeout) pingTimeout = false;
-            }
+    // The batch only stood in for the files packed into it. One received into a stream is the application's to unpack
+    if (connection.batch) {
+        if (appState->role == SERVER && complete && onDisk()) unpackBatch(connection);
+        if (appState->role == CLIENT || onDisk()) remove(connection.filename.c_str());
+        connection.batch = false;
+    }
+}
 
-            // We're done pinging so close the connection
-            if (pingTimeout) {
-                connection.status = ERROR;
-            } else {
-                connection.status = CLOSED;
-            }
+// Writes out the small files and directories of a received batch beneath the save directory (server only)
+void ConnectionController::unpackBatch(Connection &connection) {
+    FILE *batch = std::fopen(connection.filename.c_str(), "rb");
+    if (batch == NULL) {
+        fprintf(stderr, "Unable to open the batch %s\n", connection.filename.c_str());
+        return;
+    }
 
-            close(connection.sockfd);
-        } else {
-            ackPkt = sendAndRec(connection,pktInfo, timeout, badPkt);
-        }
+    BatchUnpacker unpacker(appState->filePath);
+    bool unpacked = unpacker.unpack(batch);
+    fclose(batch);
 
-        if (connection.status != OPEN && !isPing) {
-            char convertedIP[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &connection.destAddr.sin_addr, convertedIP, INET_ADDRSTRLEN);
-            printf("Unable to establish handshake with %s, Closing connection\n", convertedIP);
-            return;
+    print("Batch %s: %lu files (%lu bytes) and %lu directories unpacked%s\n", connection.filename.c_str(), unpacker.files,
+           unpacker.bytes, unpacker.directories, unpacked ? "" : ", but some could not be");
+}
+
+
+// Builds the packet builder used for the packets of a transfer, its payload sized for packets of up to pktSize bytes
+PacketBuilder ConnectionController::dataPacketBuilder(Connection &connection, unsigned int pktSize) {
+    PacketBuilder pktBuilder;
+    pktBuilder.setSrcAddr(connection.srcAddr);
+    pktBuilder.setDestAddr(connection.destAddr);
+    pktBuilder.setSqnBits(connection.sqnBits);
+    pktBuilder.setPktSize(pktSize);
+    pktBuilder.setWSize(connection.wSize);
+    pktBuilder.setProtocol(connection.protocol);
+    pktBuilder.emptyPayload(); // Allocated up front as compressed packets vary pktSize
+
+    return pktBuilder;
+}
+
+// Builds the packet builder used for FEC parity packets, which carry a whole shard as their payload
+PacketBuilder ConnectionController::parityPacketBuilder(Connection &connection) {
+    PacketBuilder parityBuilder = dataPacketBuilder(connection, connection.fecEncoder.size());
+    parityBuilder.enableFecBit();
+
+    return parityBuilder;
+}
+
+// Reads the next chunks of the file into the packet buffer until the window is full, moving on to the next file with a
+// SYN of its own once one has been read. Returns true once the last chunk of the last file has been read
+bool ConnectionController::fillWindow(Connection &connection, PacketBuilder &pktBuilder, PacketBuilder &parityBuilder, char *fileBuffer) {
+    bool finished = false;
+    vector<char> dedupPayload;
+
+    for (unsigned long i = (connection.lastFrame.lastFrameSent + 1); i <= (connection.congestion.window() + connection.lastRec.lastAckRec); i++) {
+        // Already buffered but held back when the congestion window shrank
+        if (connection.pktBuffer[i].pkt.sqn == i) continue;
+
+        // Only one SYN is answered at a time, and a file's data waits on its SYN-ACK unless it's allowed to run ahead
+        if (connection.synPending && (connection.nextSyn || !earlyData())) break;
+
+        if (connection.nextSyn) {
+            // The next file's SYN takes the next sequence number, so it's resent like data and the server only opens
+            // the file once everything before it has been written
+            finishFile(connection, true);
+            openFile(connection, connection.pendingFiles.front());
+            connection.pendingFiles.pop();
+            connection.fileId++;
+            connection.nextSyn = false;
+
+            pktBuilder.resetFlags();
+            pktBuilder.setSqn(i);
+            pktBuilder.setOffset(0);
+            pktBuilder.setPktSize(connection.remoteName.length());
+            describeFile(connection, pktBuilder);
+
+            Packet syn = pktBuilder.buildPacket();
+            addToPktBuffer(connection, syn);
+            connection.synPending = true;
+            if (earlyData()) connection.schedule = ChunkSchedule(chunkCount(connection.fileSize, connection.pktSizeBytes));
+
+            // Covered by parity so blocks stay lined up with the sequence numbers
+            if (connection.fecEncoder.enabled() && connection.fecEncoder.add(syn, false)) queueParity(connection, parityBuilder);
+            continue;
         }
 
-        // Adjust parameters to align with server
-        if (!isPing) {
-            if (ackPkt.header.wSize != connection.wSize) {
-                if(ackPkt.header.wSize > connection.wSize) {
-                    free(connection.pktBuffer);
-                    connection.pktBuffer = new PacketInfo[connection.wSize];
-                }
-                connection.wSize = ackPkt.header.wSize;
+        // Create data packet
+        bool last;
+        pktBuilder.resetFlags();
+        pktBuilder.setSqn(i);
+        if (connection.delta) {
+            // Blocks the server already has go out as copies, whose only payload is where they're copied from
+            DeltaOp &op = connection.delta->next();
+            connection.bytesRead = op.length;
+            last = op.last;
+            pktBuilder.setOffset(op.offset);
+            if (op.copy) {
+                pktBuilder.enableCopyBit();
+                pktBuilder.setRawSize(op.length);
+                pktBuilder.setPktSize(sizeof(op.source));
+                pktBuilder.setPayload((const char *) &op.source, sizeof(op.source));
+            } else {
+                pktBuilder.setPktSize(op.literal.size());
+                pktBuilder.setPayload(op.literal.data(), op.literal.size());
+                connection.wireBytes += op.literal.size();
             }
-            if (ackPkt.header.pktSize != connection.pktSizeBytes) connection.pktSizeBytes = ackPkt.header.pktSize;
-            if (ackPkt.header.sqnBits != connection.sqnBits) {
-                connection.sqnBits = ackPkt.header.sqnBits;
-                if (connection.sqnBits == 32) {
-                    connection.sqnRange = -1;
-                } else {
-                    connection.sqnRange = (1 << connection.sqnBits);
-                }
+        } else if (connection.dedup) {
+            // Manifests offer the file's chunks; the chunks the server answers that it lacks follow as data
+            uint64_t offset = 0;
+            DedupOp op = connection.dedup->next(i, dedupPayload, offset);
+
+            // Nothing can be sent until the server answers an outstanding manifest
+            if (op == DEDUP_WAIT) break;
+
+            connection.bytesRead = (op == DEDUP_CHUNK) ? dedupPayload.size() : 0;
+            last = (op == DEDUP_FIN);
+            if (op == DEDUP_MANIFEST || op == DEDUP_FIN) pktBuilder.enableManifestBit();
+            pktBuilder.setOffset(offset);
+            pktBuilder.setPktSize(dedupPayload.size());
+            if (!dedupPayload.empty()) pktBuilder.setPayload(dedupPayload.data(), dedupPayload.size());
+            connection.wireBytes += dedupPayload.size();
+        } else if (connection.compressor && connection.chunkLeft == 0) {
+            // Chunks are read and compressed ahead of time; pktSize is what goes on the wire
+            CompressedChunk &chunk = connection.compressor->next();
+            connection.bytesRead = chunk.rawSize;
+            last = chunk.last;
+            pktBuilder.setOffset(chunk.offset);
+            pktBuilder.setPktSize(chunk.data.size());
+            if (chunk.compressed) {
+                pktBuilder.enableCompressedBit();
+                pktBuilder.setRawSize(chunk.rawSize);
+            }
+            pktBuilder.setPayload(chunk.data.data(), chunk.data.size());
+            connection.wireBytes += chunk.data.size();
+        } else {
+            // Chunks the server already has are skipped when resuming. Each chunk goes out in pieces of the sizer's
+            // current size, which is the whole chunk unless packets are being shrunk
+            if (connection.chunkLeft == 0) {
+                connection.chunkOffset = connection.schedule.next() * connection.pktSizeBytes;
+                connection.chunkLeft = min((uint64_t) connection.pktSizeBytes, connection.fileSize - min(connection.chunkOffset, connection.fileSize));
+            }
+            uint64_t offset = connection.chunkOffset;
+            size_t pieceSize = min((uint64_t) connection.sizer.size(), connection.chunkLeft);
+            if ((uint64_t) ftello(connection.file) != offset) fseeko(connection.file, (off_t) offset, SEEK_SET);
+
+            bzero(fileBuffer, connection.pktSizeBytes);
+            connection.bytesRead = fread(fileBuffer, sizeof(char), pieceSize, connection.file);
+            connection.chunkOffset += connection.bytesRead;
+            connection.chunkLeft = (size_t) connection.bytesRead < pieceSize ? 0 : connection.chunkLeft - pieceSize;
+            last = connection.chunkLeft == 0 && (connection.schedule.empty() || (size_t) connection.bytesRead < pieceSize);
+            pktBuilder.setOffset(offset);
+            pktBuilder.setPktSize(connection.bytesRead);
+            pktBuilder.setPayload(fileBuffer);
+            connection.wireBytes += connection.bytesRead;
+
+            unsigned int previousSize = connection.sizer.size();
+            if (connection.sizer.onSend()) {
+                print("Packet size %s to %u bytes (%.1f%% of packets resent)\n", connection.sizer.size() < previousSize ? "lowered" : "raised",
+                       connection.sizer.size(), connection.sizer.lossRate * 100);
             }
-            connection.lastRec.lastAckRec = ackPkt.header.sqn;
-            delete [] ackPkt.payload;
         }
-    } else {
-        // Server
-        // Wait for SYN packet and respond with SYN/ACK
-        // recAndAck takes care of responding to ping packets, so returned packet is first data packet
-        Packet pkt = recAndAck(connection, timeout, badPkt);
+        connection.fileBytes += connection.bytesRead;
 
-        // Connection was a ping and now it's done so close the connection
-        if (pkt.header.flags.ping == 1 && pkt.header.flags.fin == 1) {
-            close(connection.sockfd);
-            return;
+        // If nothing is left to send, then we're on the file's last packet, and the last packet if no files are left
+        if (last) {
+            pktBuilder.enableFinBit();
+            connection.finalSqn = i;
+            finished = connection.pendingFiles.empty();
+            connection.nextSyn = !finished;
         }
 
-        connection.lastRec.lastFrameRec = pkt.header.sqn;
-        connection.filename = appState->filePath + connection.filename;
-        connection.file = std::fopen(connection.filename.c_str(), "wb+");
+        Packet newPkt = pktBuilder.buildPacket();
+        addToPktBuffer(connection, newPkt);
+
+        if (connection.fecEncoder.enabled() && connection.fecEncoder.add(newPkt, finished)) queueParity(connection, parityBuilder);
 
-        // Create file with first data packet received before moving to transfer phase
-        if (pkt.header.pktSize > 0) fwrite(pkt.payload, sizeof(char), pkt.header.pktSize, connection.file);
+        if (finished) break;
     }
 
-    // Both
-    // If not Ping, transition to transfer phase
-    if (connection.status == OPEN || connection.status == COMPLETE) {
-        if (connection.status == OPEN) printWindow(connection);
+    return finished;
+}
+
+// Builds the parity packets of the block the encoder just completed. They carry the sequence number of the block's first
+// data packet and are held until its last data packet has been sent
+void ConnectionController::queueParity(Connection &connection, PacketBuilder &parityBuilder) {
+    FecEncoder &encoder = connection.fecEncoder;
+
+    parityBuilder.setSqn(encoder.start());
+    parityBuilder.setFec(encoder.blockSize(), encoder.parityCount());
+
+    for (unsigned int j = 0; j < encoder.parityCount(); j++) {
+        FecParity parity{encoder.start() + encoder.blockSize() - 1, PacketInfo{}};
+
+        parityBuilder.setFecIndex(j);
+        parityBuilder.setPayload((const char *) encoder.parityShard(j));
+        parity.pktInfo.pkt = parityBuilder.buildPacket();
+        connection.fecQueue.push(parity);
+    }
+}
+
+// Sends the parity of every block whose data has all been sent. Parity is sent once and never retransmitted
+void ConnectionController::sendParity(Connection &connection) {
+    while (!connection.fecQueue.empty() && connection.fecQueue.front().blockEnd <= connection.lastFrame.lastFrameSent) {
+        sendPacket(connection, connection.fecQueue.front().pktInfo);
+        delete[] connection.fecQueue.front().pktInfo.pkt.payload;
+        connection.fecQueue.pop();
+    }
+}
+
+// Hands a data or parity packet to the FEC decoder, queueing any packets it was able to rebuild
+void ConnectionController::decodeFec(Connection &connection, Packet &pkt) {
+    vector<Packet> rebuilt;
+
+    if (pkt.header.flags.fec == 1) {
+        connection.fecDecoder.addParity(pkt, rebuilt);
+    } else {
+        connection.fecDecoder.addData(pkt, rebuilt);
+    }
+
+    for (Packet &rebuiltPkt : rebuilt) {
+        rebuiltPkt.header.sqn = rebuiltPkt.sqn % connection.sqnRange;
+        if (appState->verbose) print("Packet %u rebuilt from parity\n", rebuiltPkt.header.sqn);
+        connection.fecRecovered.push(rebuiltPkt);
+    }
+}
+
+// Packets rebuilt from parity are handled as if they had just arrived. GBN also replays the packets the decoder still
+// holds after they were discarded for arriving out of order, once the gap before them is filled
+bool ConnectionController::nextRebuiltPacket(Connection &connection, Packet &pkt) {
+    if (!connection.fecRecovered.empty()) {
+        pkt = connection.fecRecovered.front();
+        connection.fecRecovered.pop();
+        connection.fecPkts++;
+
+        return true;
+    }
+
+    if (connection.protocol == GBN && connection.fecDecoder.enabled() && connection.fecDecoder.take(connection.lastRec.lastFrameRec + 1, pkt)) {
+        pkt.header.sqn = pkt.sqn % connection.sqnRange;
+        return true;
+    }
+
+    return false;
+}
+
+// Go-Back-N sender: keeps up to wSize packets in flight, advances on cumulative ACKs and goes back to resend every packet
+// in flight once the oldest unACK'd packet times out
+void ConnectionController::sendGoBackN(Connection &connection) {
+    bool timeout = false;
+    bool badPkt = false;
+    bool finished = false;
+    char *fileBuffer = new char[connection.pktSizeBytes];
+    PacketBuilder pktBuilder = dataPacketBuilder(connection, connection.pktSizeBytes);
+    PacketBuilder parityBuilder = parityPacketBuilder(connection);
+
+    do {
+        // Fill the window/packet buffer
+        if (!finished) finished = fillWindow(connection, pktBuilder, parityBuilder, fileBuffer);
+
+        printWindow(connection);
+
+        // Oldest unACK'd packet timed out; go back and resend everything in flight
+        PacketInfo &oldest = connection.pktBuffer[connection.lastRec.lastAckRec + 1];
+        if (connection.lastFrame.lastFrameSent > connection.lastRec.lastAckRec && oldest.timeout < Clock::now()) {
+            TRACE(TRACE_LEVEL_EVENTS, TRACE_RTO_FIRED, oldest.pkt.sqn, oldest.count, oldest.pkt.header.fileId);
+            if (appState->verbose) print("Packet %u *** TIMED OUT ***\n", oldest.pkt.header.sqn);
+
+            if (oldest.count < appState->connectionSettings.retrylimit) {
+                // Rewind so the (paced) send loop below resends the window
+                connection.metrics->rtoFirings.add();
+                connection.congestion.onTimeout();
+                connection.sizer.onLoss();
+                connection.timeoutQueue = queue<PacketInfo*>();
+                connection.lastFrame.lastFrameSent = connection.lastRec.lastAckRec;
+            } else {
+                char convertedIP[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &connection.destAddr.sin_addr, convertedIP, INET_ADDRSTRLEN);
+                print("Packet %u exceeded RETRY limit. Closing connection to %s...\n", oldest.pkt.header.sqn, convertedIP);
+
+                pktBuilder.resetFlags();
+                pktBuilder.enableAckBit();
+                pktBuilder.setSqn(connection.lastFrame.lastFrameSent + 1);
+                pktBuilder.setPktSize(0);
+                Packet pkt = pktBuilder.buildPacket();
+                sendPacket(connection, pkt);
+
+                connection.status = CLOSED;
+                break;
+            }
+        }
+
+        // Send packets in (congestion) window
+        for (uint64_t i = connection.lastFrame.lastFrameSent + 1; i <= (connection.congestion.window() + connection.lastRec.lastAckRec); i++) {
+            if (connection.pktBuffer[i].pkt.sqn <= connection.lastFrame.lastFrameSent) break;
+            if (!pacedSendAllowed(connection, connection.pktBuffer[i])) break;
+            sendPacket(connection, connection.pktBuffer[i]);
+        }
+        sendParity(connection);
+
+        // Don't block on ACKs past the next paced send
+        chrono::microseconds paceDelay = connection.pacer.delay(nextFrameBytes(connection));
+        if (paceDelay.count() > 0 && !waitForPacket(connection, paceDelay)) continue;
+
+        // Rec and process cumulative ACKs
+        Packet ackPkt;
+        ackPkt = recPacket(connection, timeout, badPkt);
+        if (!timeout && !badPkt && ackPkt.header.flags.syn == 1) {
+            // A fast-start SYN-ACK, arriving after data has already gone out, or the SYN-ACK of a later file
+            acceptSynAck(connection, ackPkt);
+        } else if (!timeout && !badPkt && ackPkt.header.flags.ack == 1) {
+            resolveManifest(connection, ackPkt);
+
+            // ACKs sent before we went back may still cover packets not yet resent
+            if (ackPkt.sqn > connection.lastRec.lastAckRec && connection.pktBuffer[ackPkt.sqn].pkt.sqn == ackPkt.sqn) {
+                // ACK n acknowledges every packet up to and including n
+                for (uint64_t i = connection.lastRec.lastAckRec + 1; i <= ackPkt.sqn; i++) {
+                    chrono::microseconds rtt = rttSample(connection.pktBuffer[i]);
+                    connection.congestion.onAck(rtt);
+                    if (rtt.count() > 0) connection.metrics->ackLatencyUs.record(rtt.count());
+                }
+
+                connection.lastRec.lastAckRec = ackPkt.sqn;
+                if (connection.dedup) connection.dedup->acked(connection.lastRec.lastAckRec);
+                if (connection.lastFrame.lastFrameSent < ackPkt.sqn) connection.lastFrame.lastFrameSent = ackPkt.sqn;
+
+                // Remove ACK'd packets from timeout queue before their buffer slots are reused
+                while (!connection.timeoutQueue.empty() && isAcked(connection, connection.timeoutQueue.front()->pkt.sqn)) {
+                    connection.timeoutQueue.pop();
+                }
+                updateQueueGauges(connection);
+            }
+
+            // If we're finished AND everything up to the final packet is ACK'd, then close the connection
+            if (finished && connection.lastRec.lastAckRec == connection.finalSqn) {
+                // Send final packet to signal time to close connection
+                pktBuilder.setSqn(connection.lastFrame.lastFrameSent + 1);
+                pktBuilder.setPktSize(0);
+                pktBuilder.enableAckBit();
+                Packet pkt = pktBuilder.buildPacket();
+                sendPacket(connection, pkt);
+
+                connection.status = COMPLETE;
+                print("Session successfully terminated\n");
+            }
+        } else {
+            // Timeout - Nothing to do as the oldest packet's timer is checked on the next loop
+            // Badpkt - Nothing to do for bad packets (ACKs) as we just discard them
+            if (connection.status != OPEN) break;
+        }
+    } while (connection.status == OPEN);
+
+    delete[] fileBuffer;
+}
+
+// Go-Back-N receiver: recAndAck only returns the next in-order packet, so every packet returned is written straight to
+// the file without buffering
+void ConnectionController::receiveGoBackN(Connection &connection) {
+    bool timeout = false;
+    bool badPkt = false;
+    bool finished = false;
+    Packet pkt;
+
+    do {
+        if (connection.finalSqn != 0 && connection.lastRec.lastFrameRec == connection.finalSqn) {
+            finished = true;
+            connection.status = COMPLETE;
+        }
+
+        pkt = recAndAck(connection, timeout, badPkt);
+
+        if ((timeout && !finished) || (pkt.header.flags.ack == 1 && !finished)) {
+            // We've exceeded our TTL and haven't finished our transfer
+            print("Connection closed\n");
+            connection.status = CLOSED;
+            break;
+        } else if ((timeout && finished) || (pkt.header.flags.ack == 1 && finished)) {
+            print("Session successfully terminated\n");
+            break;
+        }
+
+        // Anything after the last FIN belongs to the client's next file
+        if (finished) {
+            finished = false;
+            connection.status = OPEN;
+        }
+
+        // If we received a FIN packet, then we know what our last frame should be (until the next file's arrives)
+        if (pkt.header.flags.fin == 1) {
+            connection.finalSqn = pkt.sqn;
+        }
+
+        connection.lastRec.lastFrameRec++;
+
+        writePayload(connection, pkt);
+        releaseHeldAck(connection);
+
+        delete[] pkt.payload;
+
+        if (connection.status == OPEN) printWindow(connection);
+    } while (connection.status == OPEN);
+}
+
+// Round trip time of an ACK'd packet; retransmitted packets don't produce a sample since the ACK is ambiguous
+chrono::microseconds ConnectionController::rttSample(PacketInfo &pktInfo) {
+    if (pktInfo.count != 1) return chrono::microseconds(0);
+
+    return chrono::duration_cast<chrono::microseconds>(Clock::now() - pktInfo.sent);
+}
+
+// Packets at or below lastAckRec have been slid out of the window; the rest are tracked in the window's bitmap
+bool ConnectionController::isAcked(Connection &connection, uint64_t sqn) {
+    return sqn <= connection.lastRec.lastAckRec || connection.pktBuffer.isSet(sqn);
+}
+
+// Maps a sequence number received modulo sqnRange back to the full sequence number closest to reference (the base of the
+// window). Anything still in flight is within a window either side of the base, which fitSqnRange keeps unambiguous
+uint64_t ConnectionController::unwrapSqn(Connection &connection, unsigned int wireSqn, uint64_t reference) {
+    if (connection.sqnRange == 0) return wireSqn;
+
+    uint64_t half = connection.sqnRange / 2;
+    uint64_t lowest = (reference > half) ? reference - half : 0;
+
+    // sqnRange is a power of two, so the distance from lowest can be taken with a mask even if the subtraction wraps
+    return lowest + ((wireSqn - lowest) & (connection.sqnRange - 1));
+}
+
+// Widens the sequence space until it covers two full windows; any less and a retransmission from the previous lap of the
+// sequence space looks the same as a new packet
+void ConnectionController::fitSqnRange(Connection &connection) {
+    unsigned int sqnBits = connection.sqnBits;
+
+    while (connection.sqnBits < 32 && connection.sqnRange < 2 * (uint64_t) connection.wSize) {
+        connection.sqnBits++;
+        connection.sqnRange = (1ULL << connection.sqnBits);
+    }
+
+    if (connection.sqnBits != sqnBits) {
+        print("Sequence number bits raised from %u to %u to fit a window size of %u\n", sqnBits, connection.sqnBits, connection.wSize);
+    }
+}
+
+// Whether an out-of-order packet can be written to the file as soon as it arrives, rather than held until the gap before
+// it is filled: a plain data packet of the file being received, when that file is on disk to be written anywhere in. Files
+// written with O_DIRECT aren't, as they're only written efficiently front to back (server only)
+bool ConnectionController::placeable(Connection &connection, Packet &pkt) {
+    return onDisk() && connection.file != NULL && !connection.direct && pkt.header.fileId == connection.fileId && pkt.header.pktSize > 0 &&
+           pkt.header.flags.syn != 1 && pkt.header.flags.copy != 1 && pkt.header.flags.manifest != 1;
+}
+
+// Writes a received payload at the file offset it was read from
+void ConnectionController::writePayload(Connection &connection, Packet &pkt, bool place) {
+    if (pkt.header.flags.syn == 1) return nextFile(connection, pkt);
+    if (pkt.header.fileId != connection.fileId) {
+        print("Packet %lu is of file %u while file %u is being received, Closing connection\n", pkt.sqn, pkt.header.fileId, connection.fileId);
+        connection.status = ERROR;
+        return;
+    }
+    if (pkt.header.flags.copy == 1) return copyFromBasis(connection, pkt);
+    if (pkt.header.flags.manifest == 1 && pkt.header.flags.fin == 1) {
+        if (pkt.header.pktSize == sizeof(DedupDigest)) {
+            memcpy(&connection.clientDigest, pkt.payload, sizeof(DedupDigest));
+            connection.digestPending = true;
+        }
+        return;
+    }
+    if (pkt.header.flags.manifest == 1) return copyFromStore(connection, pkt);
+    if (pkt.header.pktSize == 0) return;
+
+    char *payload = pkt.payload;
+    size_t payloadSize = pkt.header.pktSize;
+    if (pkt.header.flags.compressed == 1) {
+        if (!connection.decompressor || pkt.header.rawSize > connection.pktSizeBytes ||
+                !connection.decompressor->decompress(pkt.payload, pkt.header.pktSize, connection.rawBuffer.data(), pkt.header.rawSize)) {
+            print("Unable to decompress packet %lu, Closing connection\n", pkt.sqn);
+            connection.status = ERROR;
+            return;
+        }
+
+        payload = connection.rawBuffer.data();
+        payloadSize = pkt.header.rawSize;
+    }
+
+    // Packets placed out of order go straight to their offset, leaving the in-order stream's buffer and position alone
+    bool written;
+    if (place) {
+        written = pwrite(fileno(connection.file), payload, payloadSize, (off_t) pkt.header.offset) == (ssize_t) payloadSize;
+    } else {
+        if ((uint64_t) ftello(connection.file) != pkt.header.offset) fseeko(connection.file, (off_t) pkt.header.offset, SEEK_SET);
+        written = fwrite(payload, sizeof(char), payloadSize, connection.file) == payloadSize;
+    }
+
+    // Nothing is recorded as received unless it made it into the file, so a resume sends it again
+    if (!written) {
+        print("Unable to write packet %lu to the file (Error #: %d), Closing connection\n", pkt.sqn, errno);
+        connection.status = ERROR;
+        return;
+    }
+
+    // Keep the chunk for later transfers of files that share it
+    if (connection.store) connection.store->put(chunkHash(payload, payloadSize), payload, payloadSize);
+
+    if (connection.receivedChunks && connection.receivedChunks->mark(pkt.header.offset, payloadSize)) {
+        flushOutput(connection);
+        connection.receivedChunks->flush();
+    }
+}
+
+// Closes the file just received and opens the one the client's next SYN names, answering with its SYN-ACK. The SYN is
+// only acted on once everything before it has been written, so the two files' packets never mix
+void ConnectionController::nextFile(Connection &connection, Packet &syn) {
+    finishFile(connection, true);
+    connection.fileId = syn.header.fileId;
+
+    PacketBuilder pktBuilder;
+    pktBuilder.setSrcAddr(connection.srcAddr);
+    pktBuilder.setDestAddr(connection.destAddr);
+    pktBuilder.setWSize(connection.wSize);
+    pktBuilder.setSqnBits(connection.sqnBits);
+    pktBuilder.setProtocol(connection.protocol);
+    pktBuilder.setPktSize(connection.pktSizeBytes);
+    pktBuilder.setFec(connection.fecData, connection.fecParity);
+    pktBuilder.setCompression(connection.compression);
+    pktBuilder.setFileId(connection.fileId);
+    pktBuilder.setSqn(syn.sqn);
+    pktBuilder.enableSynBit();
+    pktBuilder.enableAckBit();
+
+    if (!acceptFile(connection, syn, pktBuilder)) return;
+    openOutput(connection);
+
+    Packet synAck = pktBuilder.buildPacket();
+    if (connection.resuming || connection.basis != NULL) attachSynAckPayload(connection, synAck);
+    sendPacket(connection, synAck);
+    delete[] synAck.payload;
+}
+
+// Copies the blocks of our existing copy a delta packet refers to into the new copy
+void ConnectionController::copyFromBasis(Connection &connection, Packet &pkt) {
+    if (connection.basis == NULL) {
+        print("Unable to copy packet %lu without an existing copy, Closing connection\n", pkt.sqn);
+        connection.status = ERROR;
+        return;
+    }
+
+    uint64_t copyOffset = 0;
+    if (pkt.header.pktSize != sizeof(copyOffset)) {
+        print("Copy packet %lu doesn't say where to copy from, Closing connection\n", pkt.sqn);
+        connection.status = ERROR;
+        return;
+    }
+    memcpy(&copyOffset, pkt.payload, sizeof(copyOffset));
+
+    if (connection.rawBuffer.size() < connection.pktSizeBytes) connection.rawBuffer.resize(connection.pktSizeBytes);
+    fseeko(connection.basis, (off_t) copyOffset, SEEK_SET);
+    if ((uint64_t) ftello(connection.file) != pkt.header.offset) fseeko(connection.file, (off_t) pkt.header.offset, SEEK_SET);
+
+    for (uint64_t remaining = pkt.header.rawSize; remaining > 0;) {
+        size_t len = min(remaining, (uint64_t) connection.pktSizeBytes);
+        if (fread(connection.rawBuffer.data(), sizeof(char), len, connection.basis) != len) {
+            print("Unable to copy packet %lu from the existing copy, Closing connection\n", pkt.sqn);
+            connection.status = ERROR;
+            return;
+        }
+
+        if (fwrite(connection.rawBuffer.data(), sizeof(char), len, connection.file) != len) {
+            print("Unable to write packet %lu to the file (Error #: %d), Closing connection\n", pkt.sqn, errno);
+            connection.status = ERROR;
+            return;
+        }
+        remaining -= len;
+    }
+}
+
+// Takes on the window size, packet size, protocol and sequence range of a fast-start client's SYN, returning false if
+// they're out of the range we'd accept
+bool ConnectionController::adoptClientParameters(Connection &connection, Packet &syn) {
+    Packet::Header &header = syn.header;
+    if (header.wSize == 0 || header.wSize > MAX_WINDOW_SIZE || header.pktSize == 0 || header.pktSize > MAX_PKT_SIZE_KB * KB ||
+            (header.protocol != SR && header.protocol != GBN) || header.sqnBits == 0 || header.sqnBits > 32 ||
+            (1ULL << header.sqnBits) < 2 * (uint64_t) header.wSize) {
+        print("Fast-start SYN has parameters out of range, Closing connection\n");
+        connection.status = ERROR;
+        return false;
+    }
+
+    connection.protocol = (Protocol) header.protocol;
+    connection.wSize = header.wSize;
+    connection.pktSizeBytes = header.pktSize;
+    connection.sqnBits = header.sqnBits;
+    connection.sqnRange = (1ULL << connection.sqnBits);
+    if (connection.protocol != GBN && connection.pktBuffer.size() < connection.wSize) connection.pktBuffer.allocate(connection.wSize, false);
+
+    return true;
+}
+
+// Sets up for receiving the file a SYN describes: resuming a partial copy, sending a delta against an existing one or
+// deduplicating against the chunk store, as the client asked and we're able to. The SYN-ACK being built says which.
+// Returns false if the file can't be written where the client named
+bool ConnectionController::acceptFile(Connection &connection, Packet &syn, PacketBuilder &synAck) {
+    connection.filename = string(syn.payload, strnlen(syn.payload, syn.header.pktSize));
+    if (!safeRelativePath(connection.filename)) {
+        print("File name %s isn't within the save directory, Closing connection\n", connection.filename.c_str());
+        connection.status = ERROR;
+        return false;
+    }
+
+    // A batch is received beside the directory it unpacks into
+    connection.batch = syn.header.flags.batch == 1;
+    if (connection.batch) connection.filename += BATCH_SUFFIX;
+    connection.fileSize = syn.handshake.fileSize;
+
+    // A stream is written as it arrives, with no copy on disk to resume or patch
+    if (!onDisk()) return true;
+
+    // A file of a directory tree may be the first to reach its subdirectory
+    unordered_set<string> made;
+    if (!makeParents(appState->filePath + connection.filename, made)) {
+        connection.status = ERROR;
+        return false;
+    }
+
+    // Keep track of what's been received so the transfer can be resumed if the connection dies
+    if (!connection.receivedChunks && syn.handshake.transferId != 0) {
+        connection.receivedChunks = make_shared<ReceiveBitmap>();
+        connection.resuming = connection.receivedChunks->open(appState->filePath + connection.filename, syn.handshake.transferId,
+                                                              syn.handshake.fileSize, syn.handshake.mtime, connection.pktSizeBytes);
+        if (connection.resuming) {
+            print("Resuming transfer: %lu of %lu chunks already received\n", connection.receivedChunks->count(), connection.receivedChunks->chunks());
+        }
+    }
+
+    // Send the client signatures of our existing copy if it wants to send a delta against it
+    if (syn.header.flags.delta == 1 && !connection.resuming && connection.basis == NULL) {
+        connection.basis = std::fopen((appState->filePath + connection.filename).c_str(), "rb");
+        if (connection.basis != NULL) {
+            connection.signatures = blockSignatures(connection.basis, connection.pktSizeBytes);
+            print("Delta transfer against %lu blocks of the existing copy\n", connection.signatures.size());
+
+            // The new copy is rebuilt beside the existing one, which stays intact until it's swapped in
+            if (connection.receivedChunks) {
+                connection.receivedChunks->finish();
+                connection.receivedChunks.reset();
+            }
+        }
+    }
+    if (connection.basis != NULL) synAck.enableDeltaBit();
+
+    // Let the client skip chunks our store already holds if it asked to and the file isn't otherwise being patched. The
+    // store stays open for the rest of the session once it's been opened
+    if (syn.header.flags.dedup == 1 && !appState->connectionSettings.storePath.empty() && !connection.resuming &&
+            connection.basis == NULL) {
+        if (!connection.store) {
+            shared_ptr<ChunkStore> store = make_shared<ChunkStore>();
+            if (store->open(appState->connectionSettings.storePath)) connection.store = store;
+        }
+
+        if (connection.store) {
+            print("Dedup transfer against %lu stored chunks\n", connection.store->size());
+            synAck.enableDedupBit();
+
+            // Chunks vary in size, so the file can't be tracked for resuming in fixed size pieces
+            if (connection.receivedChunks) {
+                connection.receivedChunks->finish();
+                connection.receivedChunks.reset();
+            }
+        }
+    }
+
+    return true;
+}
+
+// Replaces a SYN-ACK's payload with the ranges of chunks the resumed transfer is still missing, followed by the
+// signatures of our existing copy for a delta transfer
+void ConnectionController::attachSynAckPayload(Connection &connection, Packet &synAck) {
+    vector<ChunkRange> missing;
+    if (connection.resuming) missing = connection.receivedChunks->missing();
+
+    delete[] synAck.payload;
+    synAck.payload = NULL;
+    synAck.handshake.missingRanges = missing.size();
+    synAck.handshake.signatures = connection.signatures.size();
+    synAck.header.rawSize = missing.size() * sizeof(ChunkRange) + connection.signatures.size() * sizeof(BlockSignature);
+    synAck.initPayload();
+    if (synAck.payload != NULL) {
+        memcpy(synAck.payload, missing.data(), missing.size() * sizeof(ChunkRange));
+        memcpy(synAck.payload + missing.size() * sizeof(ChunkRange), connection.signatures.data(), connection.signatures.size() * sizeof(BlockSignature));
+    }
+
+    synAck.header.chksum = 0;
+    synAck.header.chksum = PacketBuilder::generateChksum(&synAck);
+}
+
+// Writes the chunks of a manifest packet our store already holds; the client sends the data of the rest
+void ConnectionController::copyFromStore(Connection &connection, Packet &pkt) {
+    if (!connection.store) {
+        print("Unable to assemble packet %lu without a chunk store, Closing connection\n", pkt.sqn);
+        connection.status = ERROR;
+        return;
+    }
+
+    ManifestEntry entry{};
+    vector<char> chunk;
+    for (size_t i = 0; i < pkt.header.pktSize / sizeof(ManifestEntry); i++) {
+        memcpy(&entry, pkt.payload + i * sizeof(ManifestEntry), sizeof(ManifestEntry));
+        if (!connection.store->has(entry.hash)) continue;
+
+        if (!connection.store->get(entry.hash, chunk)) {
+            print("Unable to read the chunk at offset %lu from the chunk store, Closing connection\n", entry.offset);
+            connection.status = ERROR;
+            return;
+        }
+
+        if ((uint64_t) ftello(connection.file) != entry.offset) fseeko(connection.file, (off_t) entry.offset, SEEK_SET);
+        if (fwrite(chunk.data(), sizeof(char), chunk.size(), connection.file) != chunk.size()) {
+            print("Unable to write the chunk at offset %lu to the file (Error #: %d), Closing connection\n", entry.offset, errno);
+            connection.status = ERROR;
+            return;
+        }
+    }
+}
+
+// Replaces the payload of a manifest packet's ACK with a bit per chunk, set for each one our store doesn't hold. A chunk
+// held now is still held when the manifest is written, as the store is only ever added to
+void ConnectionController::attachNeededChunks(Connection &connection, Packet &manifest, Packet &ack) {
+    size_t entries = manifest.header.pktSize / sizeof(ManifestEntry);
+    vector<char> needBits((entries + 7) / 8, 0);
+
+    ManifestEntry entry{};
+    for (size_t i = 0; i < entries; i++) {
+        memcpy(&entry, manifest.payload + i * sizeof(ManifestEntry), sizeof(ManifestEntry));
+        if (!connection.store->has(entry.hash)) needBits[i / 8] |= (char) (1 << (i % 8));
+    }
+
+    delete[] ack.payload;
+    ack.payload = NULL;
+    ack.header.flags.manifest = 1;
+    ack.header.pktSize = needBits.size();
+    ack.initPayload();
+    if (ack.payload != NULL) memcpy(ack.payload, needBits.data(), needBits.size());
+
+    ack.header.chksum = 0;
+    ack.header.chksum = PacketBuilder::generateChksum(&ack);
+}
+
+// Queues the chunks the server answered a manifest's ACK with
+void ConnectionController::resolveManifest(Connection &connection, Packet &ackPkt) {
+    if (!connection.dedup || ackPkt.header.flags.manifest != 1 || ackPkt.payload == NULL) return;
+
+    connection.dedup->resolve(ackPkt.sqn, ackPkt.payload, ackPkt.header.pktSize);
+    delete[] ackPkt.payload;
+    ackPkt.payload = NULL;
+}
+
+// Size on the wire of the next new packet to go out. Packets vary in length once compressed or resized, so the wait for
+// the pacer is judged on the packet itself
+unsigned int ConnectionController::nextFrameBytes(Connection &connection) {
+    PacketInfo &next = connection.pktBuffer[connection.lastFrame.lastFrameSent + 1];
+    if (next.pkt.sqn != connection.lastFrame.lastFrameSent + 1) return sizeof(Packet::Header) + connection.pktSizeBytes;
+
+    return sizeof(Packet::Header) + next.pkt.header.pktSize;
+}
+
+// Whether the pacer and rate caps allow this packet to go out now
+bool ConnectionController::pacedSendAllowed(Connection &connection, PacketInfo &pktInfo) {
+    return connection.pacer.delay(sizeof(Packet::Header) + pktInfo.pkt.header.pktSize).count() == 0;
+}
+
+// Waits up to maxWait for a packet to arrive, returning false if none did
+bool ConnectionController::waitForPacket(Connection &connection, chrono::microseconds maxWait) {
+    return connection.transport->wait(maxWait);
+}
+
+void ConnectionController::addToPktBuffer(Connection &connection, Packet pkt) {
+    connection.pktBuffer.allocateSlots();
+    auto pktInfo = new PacketInfo();
+    pktInfo->pkt = pkt;
+
+    delete[] connection.pktBuffer[pkt.sqn].pkt.payload;
+    connection.pktBuffer[pkt.sqn] = *pktInfo;
+    delete pktInfo;
+}
+
+void ConnectionController::handshake(Connection &connection, bool isPing) {
+    bool timeout = false;
+    bool badPkt = false;
+
+    if (appState->role == CLIENT) {
+        // Client
+        // Create SYN packet and wait for SYN/ACK
+        bool fastStart = !isPing && earlyData();
+        PacketBuilder pktBuilder;
+        pktBuilder.setSrcAddr(connection.srcAddr);
+        pktBuilder.setDestAddr(connection.destAddr);
+        pktBuilder.setSqnBits(connection.sqnBits);
+        pktBuilder.setWSize(connection.wSize);
+        pktBuilder.setPktSize(connection.pktSizeBytes);
+        pktBuilder.setProtocol(connection.protocol);
+
+        if (isPing) {
+            pktBuilder.setSqn(0);
+            pktBuilder.enablePingBit();
+            pktBuilder.emptyPayload();
+        } else {
+            if (fastStart) pktBuilder.enableFastBit();
+            pktBuilder.setSqn(connection.lastFrame.lastFrameSent);
+            describeFile(connection, pktBuilder);
+        }
+
+        Packet pkt = pktBuilder.buildPacket(), ackPkt{};
+
+        PacketInfo pktInfo{};
+        pktInfo.pkt = pkt;
+
+        if (isPing) {
+            bool pingTimeout = true;
+            for (int i = 0; i < PING_ATTEMPTS; i++) {
+                ackPkt = sendAndRec(connection,pktInfo, timeout, badPkt);
+
+                // Need to check if we get at least 1 valid connection, otherwise the results aren't valid
+                if (!timeout) pingTimeout = false;
+            }
+
+            // We're done pinging so close the connection
+            if (pingTimeout) {
+                connection.status = ERROR;
+            } else {
+                connection.status = CLOSED;
+            }
+
+            connection.transport->close();
+        } else if (fastStart) {
+            // The first window follows straight behind the SYN; the SYN-ACK is picked up by the send loop
+            connection.synSent = Clock::now();
+            connection.synPending = true;
+            sendPacket(connection, pktInfo);
+
+            connection.schedule = ChunkSchedule(chunkCount(connection.fileSize, connection.pktSizeBytes));
+            if (connection.fecData > 0) connection.fecEncoder = FecEncoder(connection.fecData, connection.fecParity, connection.pktSizeBytes);
+            connection.pacer = Pacer(appState->connectionSettings.pacing, appState->connectionSettings.rateLimit, connection.pktSizeBytes);
+            connection.sizer = packetSizer(connection);
+        } else {
+            connection.synSent = Clock::now();
+            connection.synPending = true;
+            ackPkt = sendAndRec(connection,pktInfo, timeout, badPkt);
+        }
+
+        if (connection.status != OPEN && !isPing) {
+            char convertedIP[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &connection.destAddr.sin_addr, convertedIP, INET_ADDRSTRLEN);
+            print("Unable to establish handshake with %s, Closing connection\n", convertedIP);
+            discardBatches(connection);
+            return;
+        }
+
+        if (!isPing && !fastStart) acceptSynAck(connection, ackPkt);
+    } else {
+        // Server
+        // Wait for SYN packet and respond with SYN/ACK
+        // recAndAck takes care of responding to ping packets, so returned packet is first data packet
+        Packet pkt = recAndAck(connection, timeout, badPkt);
+
+        // Connection was a ping and now it's done so close the connection
+        if (pkt.header.flags.ping == 1 && pkt.header.flags.fin == 1) {
+            connection.transport->close();
+            return;
+        }
+
+        // The SYN was refused
+        if (connection.status == ERROR) {
+            connection.transport->close();
+            return;
+        }
+
+        openOutput(connection);
+        if (pkt.header.flags.fin == 1) connection.finalSqn = pkt.sqn;
+
+        if (pkt.sqn == connection.lastRec.lastFrameRec + 1) {
+            // Create file with first data packet received before moving to transfer phase
+            connection.lastRec.lastFrameRec = pkt.sqn;
+            writePayload(connection, pkt);
+        } else if (!timeout && pkt.header.flags.ack != 1 && connection.status == OPEN) {
+            // First packet to arrive was out-of-order (SR); buffer it until the gap is filled
+            addToPktBuffer(connection, pkt);
+            connection.pktBuffer.set(pkt.sqn);
+        }
+        releaseHeldAck(connection);
+    }
+
+    // Both
+    // If not Ping, transition to transfer phase
+    if (connection.status == OPEN || connection.status == COMPLETE) {
+        if (connection.status == OPEN) printWindow(connection);
         transferFile(connection);
     }
 }
 
+// Opens the file the client's SYN named for writing (server only)
+void ConnectionController::openOutput(Connection &connection) {
+    connection.filename = appState->filePath + connection.filename;
+
+    if (!onDisk()) {
+        connection.file = appState->streams.openSink(connection.filename);
+        return;
+    }
+
+    // Write into the partial file left by the earlier attempt rather than truncate it
+    string path = connection.basis != NULL ? connection.filename + DELTA_SUFFIX : connection.filename;
+    bool truncate = connection.basis != NULL || !connection.resuming;
+    if (appState->connectionSettings.ioMode == IO_DIRECT) {
+        connection.direct = DirectWriter::open(path, truncate);
+        if (connection.direct) connection.file = connection.direct->stream();
+        else print("Unable to open %s with O_DIRECT, writing it through the page cache\n", path.c_str());
+    }
+    if (!connection.direct) connection.file = std::fopen(path.c_str(), truncate ? "wb+" : "rb+");
+
+    // Reserve the whole file up front, as packets placed out of order would otherwise leave it to be allocated piecemeal.
+    // Its size still grows only as it's written, so a transfer cut short leaves no zeros past what arrived
+    if (connection.file != NULL && connection.fileSize > 0) {
+        fallocate(connection.direct ? connection.direct->descriptor() : fileno(connection.file), FALLOC_FL_KEEP_SIZE, 0,
+                  (off_t) connection.fileSize);
+    }
+}
+
+// Pushes what's been written to the file out of our buffers, so the resume bitmap never gets ahead of it (server only)
+void ConnectionController::flushOutput(Connection &connection) {
+    fflush(connection.file);
+    if (connection.direct) connection.direct->flush();
+}
+
+// Makes everything written to the file so far durable, returning false if it couldn't be (server only)
+bool ConnectionController::syncOutput(Connection &connection) {
+    if (!onDisk() || connection.file == NULL) return true;
+
+    auto start = Clock::steadyNow();
+    bool flushed = fflush(connection.file) == 0 && (!connection.direct || connection.direct->flush());
+    int fd = connection.direct ? connection.direct->descriptor() : fileno(connection.file);
+    if (!flushed || fdatasync(fd) != 0) {
+        fprintf(stderr, "Unable to sync %s to disk\nError #: %d\n", connection.filename.c_str(), errno);
+        return false;
+    }
+
+    connection.synced = true;
+    print("Synced %s to disk in %lu ms\n", connection.filename.c_str(),
+          (uint64_t) chrono::duration_cast<chrono::milliseconds>(Clock::steadyNow() - start).count());
+    return true;
+}
+
+// Sends the ACK held back until its packet was written. Should that packet have completed the file, the file is made
+// durable first, so the client never sees a file finished that a crash could still lose (server only)
+void ConnectionController::releaseHeldAck(Connection &connection) {
+    if (!connection.ackHeld) return;
+    connection.ackHeld = false;
+
+    bool complete = connection.finalSqn != 0 && connection.heldAck.pkt.sqn <= connection.finalSqn &&
+                    connection.lastRec.lastFrameRec >= connection.finalSqn;
+    if (complete && connection.digestPending && !matchesClientDigest(connection)) {
+        connection.status = ERROR;
+        return;
+    }
+    if (complete && !connection.synced && !syncOutput(connection)) {
+        connection.status = ERROR;
+        return;
+    }
+
+    sendPacket(connection, connection.heldAck);
+}
+
+// Reads back a file assembled from the chunk store and the client's chunks, and checks it's the file the client has
+// (server only)
+bool ConnectionController::matchesClientDigest(Connection &connection) {
+    connection.digestPending = false;
+    if (!onDisk() || connection.file == NULL) return true;
+
+    flushOutput(connection);
+    ChunkHash hash{};
+    uint64_t size = 0;
+    if (!fileHash(connection.filename, hash, size)) {
+        print("Unable to read %s back to check it (Error #: %d), Closing connection\n", connection.filename.c_str(), errno);
+        return false;
+    }
+    if (size != connection.clientDigest.size || hash != connection.clientDigest.hash) {
+        print("%s doesn't match the client's copy (%lu of %lu bytes), Closing connection\n", connection.filename.c_str(), size,
+              connection.clientDigest.size);
+        return false;
+    }
+
+    return true;
+}
+
+// Adopts the parameters the server settled on in its SYN-ACK and sets up the transfer around what it carries. A fast-start
+// SYN-ACK arrives after data has already gone out, so only the chunks not yet read are rescheduled. Only the handshake's
+// SYN-ACK settles the connection's parameters; those of later files just set up their file
+void ConnectionController::acceptSynAck(Connection &connection, Packet &ackPkt) {
+    if (!connection.synPending || ackPkt.header.fileId != connection.fileId) {
+        delete[] ackPkt.payload;
+        return;
+    }
+
+    // The handshake's counts account for the whole payload
+    uint64_t payloadSize = (uint64_t) ackPkt.handshake.missingRanges * sizeof(ChunkRange) + (uint64_t) ackPkt.handshake.signatures * sizeof(BlockSignature);
+    if (payloadSize != ackPkt.header.payloadSize()) {
+        delete[] ackPkt.payload;
+        return;
+    }
+
+    bool early = earlyData();
+    bool handshake = ackPkt.header.fileId == 0;
+    connection.synPending = false;
+
+    // The SYN exchange stands in for the ping test
+    if (handshake && appState->connectionSettings.fastStart && appState->connectionSettings.pingCalculatedTimeout) {
+        chrono::microseconds rtt = chrono::duration_cast<chrono::microseconds>(Clock::now() - connection.synSent);
+        connection.timeoutInterval = timeoutFromRtt(rtt);
+
+        connection.transport->setReceiveTimeout(connection.timeoutInterval);
+        print("Handshake-based interval (ms): %lu\n", (unsigned long) chrono::duration_cast<chrono::milliseconds>(connection.timeoutInterval).count());
+    }
+
+    if (handshake) {
+        if (ackPkt.header.wSize != connection.wSize) {
+            if(ackPkt.header.wSize > connection.pktBuffer.size()) {
+                connection.pktBuffer.allocate(ackPkt.header.wSize);
+            }
+            connection.wSize = ackPkt.header.wSize;
+            connection.congestion.setMaxWindow(connection.wSize);
+        }
+        if (ackPkt.header.protocol != connection.protocol) connection.protocol = (Protocol) ackPkt.header.protocol;
+        if (ackPkt.header.pktSize != connection.pktSizeBytes) connection.pktSizeBytes = ackPkt.header.pktSize;
+        if (ackPkt.header.sqnBits != connection.sqnBits) {
+            connection.sqnBits = ackPkt.header.sqnBits;
+            connection.sqnRange = (1ULL << connection.sqnBits);
+        }
+        connection.lastRec.lastAckRec = ackPkt.sqn;
+        connection.fecData = ackPkt.header.fecData;
+        connection.fecParity = ackPkt.header.fecParity;
+        if (connection.fecData > 0 && !connection.fecEncoder.enabled()) {
+            connection.fecEncoder = FecEncoder(connection.fecData, connection.fecParity, connection.pktSizeBytes);
+        }
+    }
+
+    // Only send what the server is missing if it's resuming an earlier attempt
+    uint64_t chunks = chunkCount(connection.fileSize, connection.pktSizeBytes);
+    uint64_t sent = connection.schedule.taken();
+    bool finished = early && connection.finalSqn > ackPkt.sqn;
+    if (ackPkt.handshake.missingRanges > 0 && ackPkt.payload != NULL && !finished) {
+        vector<ChunkRange> missing;
+        for (unsigned int i = 0; i < ackPkt.handshake.missingRanges; i++) {
+            ChunkRange range{};
+            memcpy(&range, ackPkt.payload + i * sizeof(ChunkRange), sizeof(ChunkRange));
+
+            // Chunks already sent ahead of the SYN-ACK aren't sent again
+            if (range.first + range.count <= sent) continue;
+            if (range.first < sent) {
+                range.count -= sent - range.first;
+                range.first = sent;
+            }
+            missing.push_back(range);
+        }
+
+        // The last chunk carries the FIN, so it's sent even if the server has it
+        if (missing.empty()) missing.push_back({chunks - 1, 1});
+        connection.schedule = ChunkSchedule(missing, chunks);
+        print("Resuming transfer: %lu of %lu chunks left to send\n", connection.schedule.size(), chunks);
+    }
+    if (connection.schedule.empty() && !early) connection.schedule = ChunkSchedule(chunks);
+
+    // The server sends signatures of its copy if it has one to send a delta against
+    if (ackPkt.header.flags.delta == 1 && ackPkt.payload != NULL) {
+        vector<BlockSignature> signatures(ackPkt.handshake.signatures);
+        memcpy(signatures.data(), ackPkt.payload + ackPkt.handshake.missingRanges * sizeof(ChunkRange), signatures.size() * sizeof(BlockSignature));
+        connection.delta = make_shared<DeltaEncoder>(connection.file, connection.pktSizeBytes, signatures);
+    }
+
+    // The server only agrees to dedup if it keeps a chunk store
+    if (ackPkt.header.flags.dedup == 1 && !connection.delta) {
+        connection.dedup = make_shared<DedupSender>(connection.file, connection.pktSizeBytes);
+    }
+
+    connection.compression = (CompressionCodec) ackPkt.header.compression;
+    if (connection.compression == DEFLATE && !connection.delta && !connection.dedup && !connection.schedule.empty()) {
+        connection.compressor = make_shared<CompressionPipeline>(connection.file, connection.pktSizeBytes, connection.schedule, appState->connectionSettings.compressionThreads);
+    }
+    if (handshake && !early) {
+        connection.pacer = Pacer(appState->connectionSettings.pacing, appState->connectionSettings.rateLimit, connection.pktSizeBytes);
+        connection.sizer = packetSizer(connection);
+    }
+    delete [] ackPkt.payload;
+}
+
+// Sizes data packets for the negotiated packet size and the segment size TCP settled on for the path
+PacketSizer ConnectionController::packetSizer(Connection &connection) {
+    int mss = 0;
+    socklen_t mssLen = sizeof(mss);
+    if (getsockopt(connection.sockfd, IPPROTO_TCP, TCP_MAXSEG, &mss, &mssLen) < 0) mss = 0;
+
+    if (appState->connectionSettings.adaptivePktSize && appState->verbose) print("Path MSS: %d bytes\n", mss);
+    return PacketSizer(appState->connectionSettings.adaptivePktSize, connection.pktSizeBytes, mss > 0 ? mss : 0);
+}
+
+// Whether a file's data may follow its SYN without waiting on the SYN-ACK. Deltas and dedup need what the SYN-ACK carries
+// before the first packet can be built
+bool ConnectionController::earlyData() {
+    return appState->connectionSettings.fastStart && !appState->connectionSettings.delta && !appState->connectionSettings.dedup;
+}
+
+// The files to send, in order. Directories are walked: their small files and subdirectories are packed into a batch
+// that goes first, so the tree exists on the server before its larger files arrive on their own (client only)
+vector<OutgoingFile> ConnectionController::outgoingFiles() {
+    vector<OutgoingFile> files;
+
+    for (string path : appState->filePaths) {
+        struct stat pathStat{};
+        if (stat(path.c_str(), &pathStat) != 0 || !S_ISDIR(pathStat.st_mode)) {
+            files.push_back({path, InputHelper::getFileName(&path), false});
+            continue;
+        }
+
+        vector<TreeEntry> entries = walkTree(path), small;
+        vector<OutgoingFile> large;
+        for (TreeEntry &entry : entries) {
+            if (S_ISREG(entry.mode) && entry.size > BATCH_MAX_FILE_SIZE) large.push_back({entry.path, entry.name, false});
+            else small.push_back(entry);
+        }
+
+        const char *tmpDir = getenv("TMPDIR");
+        string batchPath = string(tmpDir != NULL ? tmpDir : "/tmp") + "/sliding_window-XXXXXX";
+        int batchFd = mkstemp(&batchPath[0]);
+        FILE *batch = batchFd < 0 ? NULL : fdopen(batchFd, "wb");
+        if (batch == NULL) {
+            fprintf(stderr, "Unable to create a batch for %s; sending its files one at a time\nError #: %d\n", path.c_str(), errno);
+            if (batchFd >= 0) close(batchFd);
+            for (TreeEntry &entry : small) {
+                if (S_ISREG(entry.mode)) large.push_back({entry.path, entry.name, false});
+            }
+        } else {
+            size_t packed = packBatch(small, batch);
+            fclose(batch);
+            files.push_back({batchPath, entries.front().name, true});
+            print("Directory %s: %lu files and directories batched, %lu files sent on their own\n", path.c_str(), packed, large.size());
+        }
+
+        files.insert(files.end(), large.begin(), large.end());
+    }
+
+    return files;
+}
+
+// Opens the next file to send and notes the size and modification time that let the server tell whether a partial copy
+// it holds is of this same file (client only)
+void ConnectionController::openFile(Connection &connection, const OutgoingFile &file) {
+    connection.filename = file.path;
+    connection.remoteName = file.name;
+    connection.batch = file.batch;
+    connection.fileSize = 0;
+    connection.fileMtime = 0;
+    connection.transferId = 0;
+    connection.schedule = ChunkSchedule();
+    connection.chunkLeft = 0;
+
+    // A stream has no modification time to tell its copies apart by, so its transfer can't be resumed
+    if (!file.batch && !onDisk()) {
+        connection.file = appState->streams.openSource(file.path, connection.fileSize);
+        return;
+    }
+
+    connection.file = std::fopen(file.path.c_str(), "rb");
+    struct stat fileStat{};
+    if (connection.file != NULL && fstat(fileno(connection.file), &fileStat) == 0) {
+        connection.fileSize = fileStat.st_size;
+        connection.fileMtime = (int64_t) fileStat.st_mtim.tv_sec * 1000000000 + fileStat.st_mtim.tv_nsec;
+
+        // A batch is packed afresh each run, so there's never a partial copy of it worth resuming
+        if (!file.batch) connection.transferId = transferId(file.name, connection.fileSize, connection.fileMtime);
+    }
+}
+
+// Sets the SYN fields describing the file being sent and what the client would like to do with it. The path the server
+// writes it to is the payload
+void ConnectionController::describeFile(Connection &connection, PacketBuilder &pktBuilder) {
+    const string &name = connection.remoteName;
+
+    pktBuilder.enableSynBit();
+    pktBuilder.setFileId(connection.fileId);
+    pktBuilder.setFec(connection.fecData, connection.fecParity);
+    pktBuilder.setCompression(connection.compression);
+    pktBuilder.setTransfer(connection.transferId, connection.fileSize, connection.fileMtime);
+    if (appState->connectionSettings.delta) pktBuilder.enableDeltaBit();
+    if (appState->connectionSettings.dedup) pktBuilder.enableDedupBit();
+    if (connection.batch) pktBuilder.enableBatchBit();
+    pktBuilder.setPayload(name.c_str(), name.length());
+}
+
 chrono::microseconds ConnectionController::generatePingBasedTimeout() {
     // If we're generating a timeout for a localhost connection, just set to 1 second to avoid excessively small timeouts
     if (appState->role == CLIENT && appState->ipAddresses[0].compare("127.0.0.1") ==0) {
-        if (appState->verbose) printf("Detected localhost ping-based timeout test; configuring to 1 second timeout\n");
+        if (appState->verbose) print("Detected localhost ping-based timeout test; configuring to 1 second timeout\n");
         return chrono::seconds(1);
     }
 
     chrono::microseconds avgTimeout = chrono::microseconds (0); // ms
-    int scalar = appState->connectionSettings.timeoutScale * 100; // Issues happen when multiplying chrono units with floats, so make int first then divide by 10
 
     Connection connection = createConnection(appState->ipAddresses[0], true);
     handleConnection(connection, true);
 
     if (connection.status == CLOSED) {
-        avgTimeout = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now() - connection.timeConnectionStarted);
+        avgTimeout = chrono::duration_cast<chrono::microseconds>(Clock::now() - connection.timeConnectionStarted);
         avgTimeout /= PING_ATTEMPTS;
-        avgTimeout = chrono::duration_cast<chrono::microseconds>((avgTimeout * scalar) / 100);
     } else {
-        printf("Unable to establish contact with Server; Aborting connection\n");
-        avgTimeout = chrono::microseconds (0);
+        print("Unable to establish contact with Server; Aborting connection\n");
+        return chrono::microseconds (0);
     }
 
+    return timeoutFromRtt(avgTimeout);
+}
+
+// Scales a round trip time up to a timeout interval
+chrono::microseconds ConnectionController::timeoutFromRtt(chrono::microseconds rtt) {
+    int scalar = appState->connectionSettings.timeoutScale * 100; // Issues happen when multiplying chrono units with floats, so make int first then divide by 10
+    chrono::microseconds timeout = chrono::duration_cast<chrono::microseconds>((rtt * scalar) / 100);
+
     // Add a bit of a buffer if average ping is extremely quick
-    if (chrono::duration_cast<chrono::milliseconds>(avgTimeout).count() < 100) {
-        avgTimeout += chrono::milliseconds(100);
+    if (chrono::duration_cast<chrono::milliseconds>(timeout).count() < 100) {
+        timeout += chrono::milliseconds(100);
     }
 
-    return avgTimeout;
+    return timeout;
 }
 
 string ConnectionController::getLocalAddress() {
@@ -894,46 +2413,68 @@ string ConnectionController::getLocalAddress() {
     return ipAddress;
 }
 
-timeval ConnectionController::toTimeval(chrono::microseconds value) {
-    chrono::seconds const seconds = chrono::duration_cast<chrono::seconds>(value);
-    timeval tv{};
-
-    tv.tv_sec = seconds.count();
-    tv.tv_usec = chrono::duration_cast<chrono::microseconds>(value - seconds).count();
-
-    return tv;
-}
-
 // Determines if something should happen to a packet due to a given probability
 bool ConnectionController::packetBadLuck(float prob) {
     return (rand() % 100) < ((int) (prob * 100));
 }
 
+// Whether this end's data is a file on disk, rather than a stream the embedding application supplied
+bool ConnectionController::onDisk() {
+    return appState->role == CLIENT ? !appState->streams.openSource : !appState->streams.openSink;
+}
+
+// Reports progress to the console, unless the embedding application silenced it
+void ConnectionController::print(const char *format, ...) {
+    if (appState->console == NULL) return;
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(appState->console, format, args);
+    va_end(args);
+}
+
+// Traces the window every time round the send and receive loops, and prints it when verbose
 void ConnectionController::printWindow(Connection &connection) {
-    printf("Current window = [");
+    if (appState->role == CLIENT) {
+        TRACE(TRACE_LEVEL_WINDOW, TRACE_WINDOW, connection.lastRec.lastAckRec + 1, connection.lastFrame.lastFrameSent - connection.lastRec.lastAckRec, connection.fileId);
+    } else {
+        TRACE(TRACE_LEVEL_WINDOW, TRACE_WINDOW, connection.lastRec.lastFrameRec + 1, connection.metrics->windowOccupancy.value(), connection.fileId);
+    }
+    if (!appState->verbose) return;
+
+    print("Current window = [");
 
     if (appState->role == CLIENT) {
-        for (unsigned int i = connection.lastRec.lastAckRec + 1; i <= (connection.wSize + connection.lastRec.lastAckRec); i++) {
-            if (!(connection.pktBuffer[i % connection.wSize].pkt.header.sqn > connection.lastRec.lastAckRec)) break;
+        for (uint64_t i = connection.lastRec.lastAckRec + 1; i <= (connection.wSize + connection.lastRec.lastAckRec); i++) {
+            if (!(connection.pktBuffer[i].pkt.sqn > connection.lastRec.lastAckRec)) break;
+            if (i - connection.lastRec.lastAckRec > PRINT_WINDOW_MAX) {
+                print("...");
+                break;
+            }
 
-            if (i <= (connection.wSize + connection.lastRec.lastAckRec) - 1 && (connection.pktBuffer[i % connection.wSize].pkt.header.sqn < connection.pktBuffer[(i + 1) % connection.wSize].pkt.header.sqn)) {
-                printf("%u, ", connection.pktBuffer[i % connection.wSize].pkt.header.sqn % connection.sqnRange);
+            if (i <= (connection.wSize + connection.lastRec.lastAckRec) - 1 && (connection.pktBuffer[i].pkt.sqn < connection.pktBuffer[i + 1].pkt.sqn)) {
+                print("%u, ", connection.pktBuffer[i].pkt.header.sqn);
             } else {
-                printf("%u", connection.pktBuffer[i % connection.wSize].pkt.header.sqn % connection.sqnRange);
+                print("%u", connection.pktBuffer[i].pkt.header.sqn);
             }
         }
     } else {
-        for (unsigned int i = connection.lastRec.lastFrameRec + 1; i <= (connection.wSize + connection.lastRec.lastFrameRec); i++) {
+        for (uint64_t i = connection.lastRec.lastFrameRec + 1; i <= (connection.wSize + connection.lastRec.lastFrameRec); i++) {
+            if (i - connection.lastRec.lastFrameRec > PRINT_WINDOW_MAX) {
+                print("...");
+                break;
+            }
+
             if (i < (connection.wSize + connection.lastRec.lastFrameRec) - 1 && i != connection.finalSqn) {
-                printf("%u, ", i % connection.sqnRange);
+                print("%lu, ", i % connection.sqnRange);
             }  else {
-                printf("%u", i % connection.sqnRange);
+                print("%lu", i % connection.sqnRange);
                 if (i == connection.finalSqn) break;
             }
         }
     }
 
-    printf("]\n");
+    print("]\n");
 }
 
 // Invoke local md5sum to get digital signature of provided filePath
@@ -962,17 +2503,17 @@ string ConnectionController::md5(const string& data) {
 }
 
 void ConnectionController::printPacket(Packet &pkt) {
-    printf("DEBUG: Packet SQN: %u (%u)\n", pkt.header.sqn, pkt.header.sqn % appState->connectionSettings.sqnRange);
-    printf("DEBUG: Packet PKT Size: %u\n", pkt.header.pktSize);
-    printf("DEBUG: Packet Checksum: %i\n", pkt.header.chksum);
-    printf("DEBUG: Packet Flags: ");
-    if (pkt.header.flags.ack == 1) printf("ACK ");
-    if (pkt.header.flags.syn == 1) printf("SYN ");
-    if (pkt.header.flags.fin == 1) printf("FIN ");
-    if (pkt.header.flags.ping == 1) printf("PING ");
-    printf("\n");
-//    if (pkt.header.pktSize != 0 && !(pkt.header.flags.syn == 1 && pkt.header.flags.ack == 1) && pkt.header.flags.ping != 1) printf("DEBUG: Packet Payload: %s\n", pkt.payload);
-    printf("-----\n");
+    print("DEBUG: Packet SQN: %u (%lu)\n", pkt.header.sqn, pkt.sqn);
+    print("DEBUG: Packet PKT Size: %u\n", pkt.header.pktSize);
+    print("DEBUG: Packet Checksum: %i\n", pkt.header.chksum);
+    print("DEBUG: Packet Flags: ");
+    if (pkt.header.flags.ack == 1) print("ACK ");
+    if (pkt.header.flags.syn == 1) print("SYN ");
+    if (pkt.header.flags.fin == 1) print("FIN ");
+    if (pkt.header.flags.ping == 1) print("PING ");
+    print("\n");
+//    if (pkt.header.pktSize != 0 && !(pkt.header.flags.syn == 1 && pkt.header.flags.ack == 1) && pkt.header.flags.ping != 1) print("DEBUG: Packet Payload: %s\n", pkt.payload);
+    print("-----\n");
 }
 
 //void ConnectionController::setupWorkers(int numWorkers) {
@@ -12,26 +12,77 @@
 #include "ApplicationState.h"
 #include "Connection.h"
 #include "ConnectionSettings.h"
+#include "Metrics.h"
+#include "PacketBuilder.h"
 
 #define KB 1024
 
 using namespace std;
 
 class ConnectionController {
+    friend class HotPathBench; // bench.cpp times the window bookkeeping directly
+
 //    vector<thread> connectionWorkers;
     queue<Connection> pendingConnections; // Store connections yet to be handled
     ApplicationState *appState;
+    MetricsRegistry metrics; // Live metrics of every connection
+    unique_ptr<MetricsExporter> metricsExporter; // Publishes them while connections run (--stats, --metrics-socket)
 
-    Connection createConnection(const string& ipAddress, bool isPing = false);
-    Connection createConnection(int sockfd, sockaddr_in clientAddr, sockaddr_in &serverAddr);
+    void startMetrics();
+    void updateQueueGauges(Connection &connection);
+    Connection createConnection(const string& ipAddress, bool isPing = false, const shared_ptr<Transport> &transport = nullptr);
+    Connection createConnection(int sockfd, sockaddr_in clientAddr, sockaddr_in &serverAddr, const shared_ptr<Transport> &transport = nullptr);
     void addToPktBuffer(Connection &connection, Packet pkt);
+    chrono::microseconds rttSample(PacketInfo &pktInfo);
+    chrono::microseconds timeoutFromRtt(chrono::microseconds rtt);
+    bool isAcked(Connection &connection, uint64_t sqn);
+    uint64_t unwrapSqn(Connection &connection, unsigned int wireSqn, uint64_t reference);
+    void fitSqnRange(Connection &connection);
+    vector<OutgoingFile> outgoingFiles();
+    void openFile(Connection &connection, const OutgoingFile &file);
+    void describeFile(Connection &connection, PacketBuilder &pktBuilder);
+    bool earlyData();
+    PacketSizer packetSizer(Connection &connection);
+    bool acceptFile(Connection &connection, Packet &syn, PacketBuilder &synAck);
+    void openOutput(Connection &connection);
+    void flushOutput(Connection &connection);
+    bool syncOutput(Connection &connection);
+    void releaseHeldAck(Connection &connection);
+    void nextFile(Connection &connection, Packet &syn);
+    void finishFile(Connection &connection, bool complete);
+    void unpackBatch(Connection &connection);
+    void discardBatches(Connection &connection);
+    bool placeable(Connection &connection, Packet &pkt);
+    void writePayload(Connection &connection, Packet &pkt, bool place = false);
+    void copyFromBasis(Connection &connection, Packet &pkt);
+    void attachSynAckPayload(Connection &connection, Packet &synAck);
+    void acceptSynAck(Connection &connection, Packet &ackPkt);
+    bool adoptClientParameters(Connection &connection, Packet &syn);
+    void copyFromStore(Connection &connection, Packet &pkt);
+    bool matchesClientDigest(Connection &connection);
+    void attachNeededChunks(Connection &connection, Packet &manifest, Packet &ack);
+    void resolveManifest(Connection &connection, Packet &ackPkt);
+    unsigned int nextFrameBytes(Connection &connection);
+    bool pacedSendAllowed(Connection &connection, PacketInfo &pktInfo);
+    bool waitForPacket(Connection &connection, chrono::microseconds maxWait);
+    PacketBuilder dataPacketBuilder(Connection &connection, unsigned int pktSize);
+    PacketBuilder parityPacketBuilder(Connection &connection);
+    bool fillWindow(Connection &connection, PacketBuilder &pktBuilder, PacketBuilder &parityBuilder, char *fileBuffer);
+    void queueParity(Connection &connection, PacketBuilder &parityBuilder);
+    void sendParity(Connection &connection);
+    void decodeFec(Connection &connection, Packet &pkt);
+    bool nextRebuiltPacket(Connection &connection, Packet &pkt);
+    void sendGoBackN(Connection &connection);
+    void receiveGoBackN(Connection &connection);
     void sendPacket(Connection &connection, PacketInfo &pktInfo);
     void sendPacket(Connection &connection, Packet &pkt);
     Packet recPacket(Connection &connection, bool &timeout, bool &badPkt);
+    bool openPacket(Connection &connection, Packet &pkt);
     Packet sendAndRec(Connection &connection, PacketInfo &pktInfo, bool &timeout, bool &badPkt);
     Packet recAndAck(Connection &connection, bool &timeout, bool &badPkt);
-    timeval toTimeval(chrono::microseconds value);
     bool packetBadLuck(float prob);
+    bool onDisk();
+    void print(const char *format, ...) __attribute__((format(printf, 2, 3)));
 
 public:
     ConnectionController(ApplicationState &appState);
@@ -55,6 +106,13 @@ public:
     // Checks pending connections processes them
     void processConnections();
 
+    // Runs one connection, as the client or the server, over a transport that's already connected, such as the simulator's
+    void runConnection(const shared_ptr<Transport> &transport);
+
+    const MetricsRegistry &metricsRegistry() const {
+        return metrics;
+    }
+
     void printWindow(Connection &connection);
     void printPacket(Packet &pkt);
     string getLocalAddress();
@@ -7,14 +7,36 @@
 
 #include <sys/time.h>
 #include <chrono>
+#include <cstdint>
+#include <string>
 #include <vector>
 
+#define MAX_WINDOW_SIZE (1 << 20)
+#define MAX_PKT_SIZE_KB 64
+#define INITIAL_TIMEOUT_SECONDS 1 // Used until a fast-start handshake has measured the RTT (RFC 6298's initial RTO)
+
 using namespace std;
 
 enum Protocol {
     NO_PROTO, SR, GBN
 };
 
+enum CongestionAlgorithm {
+    NO_CC, RENO, CUBIC
+};
+
+enum CompressionCodec {
+    NO_COMPRESSION, DEFLATE
+};
+
+enum CipherSuite : unsigned char {
+    NO_CIPHER, AES_256_GCM, CHACHA20_POLY1305
+};
+
+enum IoMode {
+    IO_BUFFERED, IO_DIRECT, IO_SYNC // through the page cache; O_DIRECT; through the page cache and fdatasync'd once complete
+};
+
 
 struct ConnectionSettings {
     Protocol protocol = NO_PROTO;
@@ -24,12 +46,32 @@ struct ConnectionSettings {
     unsigned int port = 0;
     chrono::microseconds timeoutInterval = chrono::microseconds (0); // Used to calculate TTL for server
     const float timeoutScale = 5;
-    unsigned short wSize = 0;
-    unsigned int sqnRange = 0;
+    unsigned int wSize = 0;
+    CongestionAlgorithm congestionAlgorithm = CUBIC;
+    bool pacing = true;
+    float rateLimit = 0; // Mbps per connection; 0 means unlimited
+    float processRateLimit = 0; // Mbps across all connections; 0 means unlimited
+    unsigned char fecData = 0; // Data packets per FEC block; 0 disables FEC
+    unsigned char fecParity = 0; // Parity packets sent per FEC block
+    CompressionCodec compression = NO_COMPRESSION;
+    unsigned int compressionThreads = 0; // 0 sizes the worker pool from the number of cores
+    bool delta = false; // Only send what differs from the server's existing copy of the file
+    bool dedup = false; // Only send chunks of the file the server's chunk store doesn't already hold
+    IoMode ioMode = IO_BUFFERED; // How the server writes received files. Direct ones are fdatasync'd once complete as well
+    bool ackDurable = false; // The server ACKs packets once written, and the one completing a file once the file is on disk
+    vector<unsigned char> psk; // Pre-shared key packets are encrypted under; empty sends them in the clear under a CRC
+    CipherSuite cipher = NO_CIPHER; // Suite the client seals packets with; the server follows the client's choice
+    string storePath; // Directory of the server's chunk store; empty disables dedup
+    string statsPath; // File the live metrics are rewritten to every second; empty disables it
+    string metricsSocket; // Unix socket serving the live metrics in Prometheus' text format; empty disables it
+    uint64_t sqnRange = 0; // 2^sqnBits; sequence numbers on the wire are taken modulo this
     unsigned char sqnBits = 0;
     float damageProb = -1; // Negative value signals user hasn't confirmed value yet
     float lostProb = -1;
     bool pingCalculatedTimeout = false;
+    bool fastStart = false; // Measure the RTT from the SYN exchange and send the first window without waiting for the SYN-ACK
+    bool tcpFastOpen = false; // Carry the first bytes in the TCP SYN
+    bool adaptivePktSize = false; // Send smaller packets while losses are frequent, up to pktSize while the link is clean
     vector<int> damagedPackets{};
     vector<int> lostPackets{};
 };
@@ -0,0 +1,248 @@
+//
+// Created on 10/19/26.
+//
+
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <openssl/evp.h>
+
+#include "Dedup.h"
+
+// Random 64 bit value per byte value, mixed into the gear hash as each byte is taken in
+static const array<uint64_t, 256> gearTable = [] {
+    array<uint64_t, 256> table{};
+    uint64_t state = 0x5357444544555031ULL;
+
+    // splitmix64, so every build chunks files identically
+    for (uint64_t &value : table) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        value = z ^ (z >> 31);
+    }
+
+    return table;
+}();
+
+ChunkHash chunkHash(const char *data, size_t len) {
+    ChunkHash hash;
+    EVP_Digest(data, len, hash.data(), NULL, EVP_sha256(), NULL);
+
+    return hash;
+}
+
+bool fileHash(const string &path, ChunkHash &hash, uint64_t &size) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == NULL) return false;
+
+    EVP_MD_CTX *digest = EVP_MD_CTX_new();
+    EVP_DigestInit_ex(digest, EVP_sha256(), NULL);
+    vector<char> buffer(1 << 20);
+    size = 0;
+    for (size_t bytesRead; (bytesRead = fread(buffer.data(), sizeof(char), buffer.size(), file)) > 0;) {
+        EVP_DigestUpdate(digest, buffer.data(), bytesRead);
+        size += bytesRead;
+    }
+    bool read = ferror(file) == 0;
+    EVP_DigestFinal_ex(digest, hash.data(), NULL);
+    EVP_MD_CTX_free(digest);
+    fclose(file);
+
+    return read;
+}
+
+Chunker::Chunker(FILE *file, unsigned int maxSize) {
+    this->file = file;
+    this->maxSize = maxSize;
+    this->minSize = max(maxSize / 16, 1u);
+    buffer.resize(4 * (size_t) maxSize);
+
+    // Boundaries are tested on the high bits of the hash, which depend on the last 64 bytes; the low bits only see a few
+    unsigned int bits = 0;
+    while ((2u << bits) <= maxSize / 4) bits++;
+    mask = bits == 0 ? 0 : ((1ULL << bits) - 1) << (64 - bits);
+
+    digest = EVP_MD_CTX_new();
+    EVP_DigestInit_ex(digest, EVP_sha256(), NULL);
+}
+
+Chunker::~Chunker() {
+    EVP_MD_CTX_free(digest);
+}
+
+bool Chunker::next(ManifestEntry &entry, vector<char> &data) {
+    // Keep at least a whole maximum sized chunk buffered
+    if (!eof && bufferLen - bufferPos < maxSize) {
+        memmove(buffer.data(), buffer.data() + bufferPos, bufferLen - bufferPos);
+        bufferLen -= bufferPos;
+        bufferPos = 0;
+
+        // The sender reads the chunks the server lacks from the same file in between
+        if ((uint64_t) ftello(file) != readOffset) fseeko(file, (off_t) readOffset, SEEK_SET);
+        while (!eof && bufferLen < buffer.size()) {
+            size_t bytesRead = fread(buffer.data() + bufferLen, sizeof(char), buffer.size() - bufferLen, file);
+            EVP_DigestUpdate(digest, buffer.data() + bufferLen, bytesRead);
+            bufferLen += bytesRead;
+            readOffset += bytesRead;
+            if (bytesRead == 0) {
+                eof = true;
+                EVP_DigestFinal_ex(digest, fileDigest.data(), NULL);
+            }
+        }
+    }
+
+    size_t available = min(bufferLen - bufferPos, (size_t) maxSize);
+    if (available == 0) return false;
+
+    const unsigned char *bytes = (const unsigned char *) buffer.data() + bufferPos;
+    size_t len = available;
+    uint64_t hash = 0;
+    for (size_t i = 0; i < available; i++) {
+        hash = (hash << 1) + gearTable[bytes[i]];
+        if (i + 1 >= minSize && (hash & mask) == 0) {
+            len = i + 1;
+            break;
+        }
+    }
+
+    data.assign(buffer.data() + bufferPos, buffer.data() + bufferPos + len);
+    entry.hash = chunkHash(data.data(), len);
+    entry.offset = offset;
+    entry.length = len;
+    entry.reserved = 0;
+
+    bufferPos += len;
+    offset += len;
+
+    return true;
+}
+
+ChunkStore::~ChunkStore() {
+    if (pack != NULL) fclose(pack);
+    if (index != NULL) fclose(index);
+}
+
+bool ChunkStore::open(const string &directory) {
+    mkdir(directory.c_str(), 0755);
+
+    // Append mode; reads can still seek anywhere
+    pack = fopen((directory + "/" + DEDUP_PACK_FILE).c_str(), "a+b");
+    index = fopen((directory + "/" + DEDUP_INDEX_FILE).c_str(), "a+b");
+    if (pack == NULL || index == NULL) {
+        fprintf(stderr, "Unable to open the chunk store in %s\n", directory.c_str());
+        return false;
+    }
+
+    fseeko(pack, 0, SEEK_END);
+    packSize = ftello(pack);
+
+    // Records for data that never made it into the pack are dropped
+    IndexRecord record{};
+    fseeko(index, 0, SEEK_SET);
+    while (fread(&record, sizeof(record), 1, index) == 1) {
+        if (record.offset + record.length <= packSize) chunks[record.hash] = record;
+    }
+
+    return true;
+}
+
+void ChunkStore::put(const ChunkHash &hash, const char *data, size_t len) {
+    if (pack == NULL || has(hash)) return;
+
+    IndexRecord record{hash, packSize, (uint32_t) len, 0};
+    if (fwrite(data, sizeof(char), len, pack) != len) return;
+    fflush(pack);
+    packSize += len;
+
+    fwrite(&record, sizeof(record), 1, index);
+    fflush(index);
+    chunks[hash] = record;
+}
+
+bool ChunkStore::get(const ChunkHash &hash, vector<char> &data) {
+    auto chunk = chunks.find(hash);
+    if (chunk == chunks.end()) return false;
+
+    data.resize(chunk->second.length);
+    fseeko(pack, (off_t) chunk->second.offset, SEEK_SET);
+    if (fread(data.data(), sizeof(char), data.size(), pack) != data.size()) return false;
+
+    return chunkHash(data.data(), data.size()) == hash;
+}
+
+DedupSender::DedupSender(FILE *file, unsigned int pktSizeBytes) : chunker(file, pktSizeBytes) {
+    this->file = file;
+    this->entriesPerManifest = max(pktSizeBytes / (unsigned int) sizeof(ManifestEntry), 1u);
+}
+
+DedupOp DedupSender::next(uint64_t sqn, vector<char> &payload, uint64_t &offset) {
+    // Chunks the server asked for go first so it can finish assembling what it's already been offered
+    if (!needed.empty()) {
+        ManifestEntry entry = needed.front();
+        needed.pop_front();
+
+        payload.resize(entry.length);
+        fseeko(file, (off_t) entry.offset, SEEK_SET);
+        payload.resize(fread(payload.data(), sizeof(char), entry.length, file));
+        offset = entry.offset;
+
+        sentChunks++;
+        sentBytes += payload.size();
+        return DEDUP_CHUNK;
+    }
+
+    if (!chunked && unresolved.size() < DEDUP_MAX_MANIFESTS) {
+        vector<ManifestEntry> entries;
+        ManifestEntry entry{};
+        vector<char> data;
+
+        while (entries.size() < entriesPerManifest) {
+            if (!chunker.next(entry, data)) {
+                chunked = true;
+                break;
+            }
+
+            entries.push_back(entry);
+            offeredBytes += entry.length;
+        }
+
+        if (!entries.empty()) {
+            payload.assign((const char *) entries.data(), (const char *) (entries.data() + entries.size()));
+            offset = entries.front().offset;
+            offeredChunks += entries.size();
+            unresolved[sqn] = move(entries);
+            return DEDUP_MANIFEST;
+        }
+    }
+
+    // Everything has been offered and every missing chunk sent
+    if (chunked && unresolved.empty()) {
+        DedupDigest digest{chunker.hash(), chunker.size()};
+        payload.assign((char *) &digest, (char *) &digest + sizeof(digest));
+        offset = 0;
+        return DEDUP_FIN;
+    }
+
+    return DEDUP_WAIT;
+}
+
+void DedupSender::resolve(uint64_t sqn, const char *needBits, size_t len) {
+    auto manifest = unresolved.find(sqn);
+    if (manifest == unresolved.end()) return;
+
+    vector<ManifestEntry> &entries = manifest->second;
+    for (size_t i = 0; i < entries.size(); i++) {
+        // Missing bits mean the answer was cut short; send the chunk to be safe
+        if (i / 8 >= len || (needBits[i / 8] & (1 << (i % 8)))) needed.push_back(entries[i]);
+    }
+
+    unresolved.erase(manifest);
+}
+
+void DedupSender::acked(uint64_t sqn) {
+    while (!unresolved.empty() && unresolved.begin()->first <= sqn) {
+        for (ManifestEntry &entry : unresolved.begin()->second) needed.push_back(entry);
+        unresolved.erase(unresolved.begin());
+    }
+}
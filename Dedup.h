@@ -0,0 +1,169 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_DEDUP_H
+#define SLIDING_WINDOW_DEDUP_H
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define CHUNK_HASH_SIZE 32 // SHA-256
+#define DEDUP_PACK_FILE "chunks.pack" // chunk data, appended to as new chunks arrive
+#define DEDUP_INDEX_FILE "chunks.idx" // one IndexRecord per chunk in the pack
+#define DEDUP_MAX_MANIFESTS 4 // manifests awaiting the server's answer before the client stops chunking ahead
+
+using namespace std;
+
+typedef array<uint8_t, CHUNK_HASH_SIZE> ChunkHash;
+typedef struct evp_md_ctx_st EVP_MD_CTX;
+
+struct ChunkHashHasher {
+    size_t operator()(const ChunkHash &hash) const {
+        size_t value;
+        memcpy(&value, hash.data(), sizeof(value));
+        return value;
+    }
+};
+
+ChunkHash chunkHash(const char *data, size_t len);
+
+// SHA-256 of the whole file at path, and its size, returning false if it can't be read
+bool fileHash(const string &path, ChunkHash &hash, uint64_t &size);
+
+// One chunk of the client's file as offered in a manifest packet
+struct ManifestEntry {
+    ChunkHash hash;
+    uint64_t offset;
+    uint32_t length;
+    uint32_t reserved;
+};
+
+/* Content-defined chunking with a gear hash: a boundary falls wherever the hash of the last few dozen bytes has its
+ * top bits clear, so an insert or delete only changes the chunks around it and the rest of the file still dedups.
+ */
+class Chunker {
+    FILE *file;
+    unsigned int minSize, maxSize;
+    uint64_t mask;
+    vector<char> buffer;
+    size_t bufferLen = 0, bufferPos = 0;
+    uint64_t offset = 0;
+    uint64_t readOffset = 0; // where the next read starts; whoever shares the file may have moved its position since
+    bool eof = false;
+    EVP_MD_CTX *digest = NULL; // of everything read so far
+    ChunkHash fileDigest{};
+
+public:
+    // Chunks average a quarter of maxSize and never exceed it, so each fits in one packet
+    Chunker(FILE *file, unsigned int maxSize);
+    ~Chunker();
+
+    Chunker(const Chunker &) = delete;
+    Chunker &operator=(const Chunker &) = delete;
+
+    // Next chunk of the file, returning false once there are none left
+    bool next(ManifestEntry &entry, vector<char> &data);
+
+    // SHA-256 and size of the whole file, once next() has returned false
+    const ChunkHash &hash() const {
+        return fileDigest;
+    }
+
+    uint64_t size() const {
+        return readOffset;
+    }
+};
+
+/* The server's content-addressed chunk store: an append-only pack of chunk data and an index of where each chunk's
+ * hash lives in it. The index is loaded into memory when the store is opened and appended to after the chunk it
+ * records, so a crash part way through an insert leaves at worst an unreferenced tail on the pack.
+ */
+class ChunkStore {
+    struct IndexRecord {
+        ChunkHash hash;
+        uint64_t offset;
+        uint32_t length;
+        uint32_t reserved;
+    };
+
+    FILE *pack = NULL;
+    FILE *index = NULL;
+    uint64_t packSize = 0;
+    unordered_map<ChunkHash, IndexRecord, ChunkHashHasher> chunks;
+
+public:
+    ChunkStore() = default;
+    ~ChunkStore();
+
+    ChunkStore(const ChunkStore &) = delete;
+    ChunkStore &operator=(const ChunkStore &) = delete;
+
+    bool open(const string &directory);
+
+    bool has(const ChunkHash &hash) const {
+        return chunks.count(hash) != 0;
+    }
+
+    // Adds a chunk unless it's already stored
+    void put(const ChunkHash &hash, const char *data, size_t len);
+
+    // Reads a stored chunk, returning false if it isn't held or doesn't match its hash
+    bool get(const ChunkHash &hash, vector<char> &data);
+
+    size_t size() const {
+        return chunks.size();
+    }
+};
+
+// What the client's send loop should put in the next packet of a dedup transfer
+// Payload of a dedup transfer's FIN
+struct DedupDigest {
+    ChunkHash hash;
+    uint64_t size;
+} __attribute__((packed));
+
+enum DedupOp {
+    DEDUP_WAIT, DEDUP_MANIFEST, DEDUP_CHUNK, DEDUP_FIN
+};
+
+/* Client side of a dedup transfer. Chunks the file into manifest packets of chunk hashes, and sends the data of the
+ * chunks the server answers that it lacks. Only a few manifests run ahead of the server's answers. The FIN carries the
+ * file's SHA-256 and size, for the server to check the file it assembles against.
+ */
+class DedupSender {
+    Chunker chunker;
+    FILE *file;
+    unsigned int entriesPerManifest;
+    map<uint64_t, vector<ManifestEntry>> unresolved; // manifests sent, by sequence number, awaiting an answer
+    deque<ManifestEntry> needed;
+    bool chunked = false;
+
+public:
+    uint64_t offeredChunks = 0, offeredBytes = 0;
+    uint64_t sentChunks = 0, sentBytes = 0;
+
+    DedupSender(FILE *file, unsigned int pktSizeBytes);
+
+    DedupSender(const DedupSender &) = delete;
+    DedupSender &operator=(const DedupSender &) = delete;
+
+    // Fills payload and offset for the packet with sequence number sqn
+    DedupOp next(uint64_t sqn, vector<char> &payload, uint64_t &offset);
+
+    // The server's answer to the manifest sqn: a bit per entry, set if it needs that chunk
+    void resolve(uint64_t sqn, const char *needBits, size_t len);
+
+    // Manifests up to sqn ACK'd without an answer (GBN's cumulative ACKs) have every chunk sent
+    void acked(uint64_t sqn);
+};
+
+
+#endif //SLIDING_WINDOW_DEDUP_H
@@ -0,0 +1,188 @@
+//
+// Created on 10/19/26.
+//
+
+#include <string.h>
+#include <algorithm>
+
+#include "boost/uuid/detail/md5.hpp"
+#include "Delta.h"
+
+static void strongChecksum(const char *data, size_t len, uint32_t *out) {
+    boost::uuids::detail::md5 hash;
+    boost::uuids::detail::md5::digest_type digest;
+
+    hash.process_bytes(data, len);
+    hash.get_digest(digest);
+    memcpy(out, digest, sizeof(digest));
+}
+
+void RollingChecksum::reset(const char *data, size_t len) {
+    a = 0;
+    b = 0;
+    this->len = len;
+
+    for (size_t i = 0; i < len; i++) {
+        a += (unsigned char) data[i];
+        b += (len - i) * (unsigned char) data[i];
+    }
+
+    a &= 0xffff;
+    b &= 0xffff;
+}
+
+vector<BlockSignature> blockSignatures(FILE *file, unsigned int blockSize) {
+    vector<BlockSignature> signatures;
+    vector<char> block(blockSize);
+    RollingChecksum checksum;
+
+    fseeko(file, 0, SEEK_SET);
+    while (fread(block.data(), sizeof(char), blockSize, file) == blockSize) {
+        BlockSignature signature{};
+        checksum.reset(block.data(), blockSize);
+        signature.weak = checksum.value();
+        strongChecksum(block.data(), blockSize, signature.strong);
+        signatures.push_back(signature);
+    }
+
+    return signatures;
+}
+
+DeltaEncoder::DeltaEncoder(FILE *file, unsigned int blockSize, const vector<BlockSignature> &signatures) {
+    this->file = file;
+    this->blockSize = blockSize;
+    this->signatures = signatures;
+    buffer.resize(4 * (size_t) blockSize);
+
+    for (uint64_t i = 0; i < signatures.size(); i++) {
+        blocks[signatures[i].weak].push_back(i);
+    }
+
+    fseeko(file, 0, SEEK_SET);
+}
+
+// Keeps a window and the byte after it in the buffer, dropping what has already been sent to make room
+void DeltaEncoder::fill() {
+    if (eof || bufferLen - pos > blockSize) return;
+
+    if (literalStart > 0) {
+        memmove(buffer.data(), buffer.data() + literalStart, bufferLen - literalStart);
+        bufferStart += literalStart;
+        bufferLen -= literalStart;
+        pos -= literalStart;
+        literalStart = 0;
+    }
+
+    while (!eof && bufferLen < buffer.size()) {
+        size_t bytesRead = fread(buffer.data() + bufferLen, sizeof(char), buffer.size() - bufferLen, file);
+        bufferLen += bytesRead;
+        if (bytesRead == 0) eof = true;
+    }
+}
+
+// Whether the window matches block
+bool DeltaEncoder::match(uint64_t block) {
+    if (!checksumValid) {
+        checksum.reset(&buffer[pos], blockSize);
+        checksumValid = true;
+    }
+    if (signatures[block].weak != checksum.value()) return false;
+
+    uint32_t strong[4];
+    strongChecksum(&buffer[pos], blockSize, strong);
+
+    return memcmp(strong, signatures[block].strong, sizeof(strong)) == 0;
+}
+
+bool DeltaEncoder::findMatch(uint64_t &block) {
+    if (!checksumValid) {
+        checksum.reset(&buffer[pos], blockSize);
+        checksumValid = true;
+    }
+
+    if (nextBlock < signatures.size() && match(nextBlock)) {
+        block = nextBlock;
+        return true;
+    }
+
+    auto candidates = blocks.find(checksum.value());
+    if (candidates == blocks.end()) return false;
+
+    uint32_t strong[4];
+    strongChecksum(&buffer[pos], blockSize, strong);
+    for (uint64_t candidate : candidates->second) {
+        if (memcmp(strong, signatures[candidate].strong, sizeof(strong)) == 0) {
+            block = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+DeltaOp &DeltaEncoder::literal(size_t len) {
+    op.copy = false;
+    op.offset = bufferStart + literalStart;
+    op.length = len;
+    op.literal.assign(buffer.data() + literalStart, buffer.data() + literalStart + len);
+
+    literalStart += len;
+    if (pos < literalStart) {
+        pos = literalStart;
+        checksumValid = false;
+    }
+
+    literalBytes += len;
+    op.last = finished();
+    return op;
+}
+
+bool DeltaEncoder::finished() {
+    fill();
+    return eof && literalStart == bufferLen;
+}
+
+DeltaOp &DeltaEncoder::next() {
+    while (true) {
+        fill();
+
+        // A full block of unmatched bytes goes out on its own
+        if (pos - literalStart >= blockSize) return literal(blockSize);
+
+        // Less than a block left so nothing more can match
+        if (bufferLen - pos < blockSize) return literal(min((size_t) blockSize, bufferLen - literalStart));
+
+        uint64_t block;
+        if (findMatch(block)) {
+            // Send what came before the match first; it's found again on the next call
+            if (pos > literalStart) return literal(pos - literalStart);
+
+            // Extend the copy over the following blocks for as long as the file keeps matching in order
+            op.copy = true;
+            op.offset = bufferStart + pos;
+            op.source = block * blockSize;
+            op.length = 0;
+            op.literal.clear();
+            do {
+                op.length += blockSize;
+                pos += blockSize;
+                literalStart = pos;
+                checksumValid = false;
+                nextBlock = ++block;
+                fill();
+            } while (op.length < DELTA_MAX_RUN * blockSize && bufferLen - pos >= blockSize && block < signatures.size() && match(block));
+
+            matchedBytes += op.length;
+            op.last = finished();
+            return op;
+        }
+
+        // No match here; slide the window along a byte
+        if (pos + blockSize < bufferLen) {
+            checksum.roll(buffer[pos], buffer[pos + blockSize]);
+        } else {
+            checksumValid = false;
+        }
+        pos++;
+    }
+}
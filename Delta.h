@@ -0,0 +1,97 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_DELTA_H
+#define SLIDING_WINDOW_DELTA_H
+
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+#define DELTA_SUFFIX ".delta" // appended to the output file's path for the copy being rebuilt
+#define DELTA_MAX_RUN 1024 // matching blocks a single copy packet can cover
+
+using namespace std;
+
+// Weak (rolling) and strong (MD5) checksums of one block of the server's existing copy, as sent in a SYN-ACK
+struct BlockSignature {
+    uint32_t weak;
+    uint32_t strong[4];
+};
+
+// rsync's rolling checksum: two 16 bit sums that can be slid along the file a byte at a time
+class RollingChecksum {
+    uint32_t a = 0, b = 0;
+    size_t len = 0;
+
+public:
+    void reset(const char *data, size_t len);
+
+    // Slides the window one byte, dropping out and taking in in
+    void roll(unsigned char out, unsigned char in) {
+        a = (a - out + in) & 0xffff;
+        b = (b - len * out + a) & 0xffff;
+    }
+
+    uint32_t value() const {
+        return a | (b << 16);
+    }
+};
+
+// Signatures of every full block of file; a short last block is always sent as literal data
+vector<BlockSignature> blockSignatures(FILE *file, unsigned int blockSize);
+
+// A piece of the new file: either literal bytes or a run of blocks the server already has
+struct DeltaOp {
+    bool copy = false;
+    uint64_t offset = 0; // where it goes in the new file
+    uint64_t source = 0; // where the run starts in the server's copy - Only used if copy is enabled
+    unsigned int length = 0; // bytes of the new file this covers
+    vector<char> literal; // Only used if copy is disabled
+    bool last = false; // nothing of the file is left after this
+};
+
+/* Client side of a delta transfer. Slides the rolling checksum along the file looking for blocks the server already
+ * holds, confirming each weak match with the strong checksum, and turns the file into a series of copies of those blocks
+ * and literal runs of at most a block in between. The file is read in a single pass.
+ */
+class DeltaEncoder {
+    FILE *file;
+    unsigned int blockSize;
+    vector<BlockSignature> signatures;
+    unordered_map<uint32_t, vector<uint64_t>> blocks; // weak checksum to the blocks that have it
+
+    vector<char> buffer;
+    size_t bufferLen = 0;
+    uint64_t bufferStart = 0; // file offset of buffer[0]
+    size_t pos = 0; // start of the window being checked
+    size_t literalStart = 0; // start of the literal bytes not yet sent
+    bool eof = false;
+    RollingChecksum checksum;
+    bool checksumValid = false;
+    uint64_t nextBlock = UINT64_MAX; // block following the last match; checked first since unchanged files match in order
+    DeltaOp op;
+
+    void fill();
+    bool match(uint64_t block);
+    bool findMatch(uint64_t &block);
+    DeltaOp &literal(size_t len);
+    bool finished();
+
+public:
+    uint64_t matchedBytes = 0;
+    uint64_t literalBytes = 0;
+
+    DeltaEncoder(FILE *file, unsigned int blockSize, const vector<BlockSignature> &signatures);
+
+    DeltaEncoder(const DeltaEncoder &) = delete;
+    DeltaEncoder &operator=(const DeltaEncoder &) = delete;
+
+    // Next piece of the file to send
+    DeltaOp &next();
+};
+
+
+#endif //SLIDING_WINDOW_DELTA_H
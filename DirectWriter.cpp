@@ -0,0 +1,212 @@
+//
+// Created on 10/19/26.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include "DirectWriter.h"
+
+static ssize_t writeDirect(void *cookie, const char *bytes, size_t size) {
+    return ((DirectWriter *) cookie)->write(bytes, size);
+}
+
+static int seekDirect(void *cookie, off64_t *offset, int whence) {
+    *offset = (off64_t) ((DirectWriter *) cookie)->seek(*offset, whence);
+    return 0;
+}
+
+static int closeDirect(void *cookie) {
+    return ((DirectWriter *) cookie)->close();
+}
+
+shared_ptr<DirectWriter> DirectWriter::open(const string &path, bool truncate) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_DIRECT | (truncate ? O_TRUNC : 0), 0644);
+    if (fd < 0) return nullptr;
+
+    struct stat fileStat{};
+    fstat(fd, &fileStat);
+
+    shared_ptr<DirectWriter> writer(new DirectWriter());
+    writer->fd = fd;
+    writer->end = writer->diskEnd = (uint64_t) fileStat.st_size;
+    for (int i = 0; i <= DIRECT_QUEUE_DEPTH; i++) {
+        void *buffer = NULL;
+        if (posix_memalign(&buffer, DIRECT_ALIGNMENT, i < DIRECT_QUEUE_DEPTH ? DIRECT_BUFFER_BYTES : DIRECT_ALIGNMENT) != 0) return nullptr;
+        writer->buffers.push_back((char *) buffer);
+    }
+    writer->block = writer->buffers.back();
+    writer->idle.assign(writer->buffers.begin(), writer->buffers.end() - 1);
+    writer->writer = thread(&DirectWriter::run, writer.get());
+
+    return writer;
+}
+
+DirectWriter::~DirectWriter() {
+    close();
+    for (char *buffer : buffers) free(buffer);
+}
+
+FILE *DirectWriter::stream() {
+    FILE *file = fopencookie(this, "w", cookie_io_functions_t{NULL, writeDirect, seekDirect, closeDirect});
+
+    // Writes are copied straight into the aligned buffers rather than through stdio's as well
+    if (file != NULL) setvbuf(file, NULL, _IONBF, 0);
+    return file;
+}
+
+void DirectWriter::run() {
+    unique_lock<mutex> lock(queueLock);
+
+    while (true) {
+        queueChanged.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) return;
+
+        Write next = pending.front();
+        lock.unlock();
+        ssize_t written = pwrite(fd, next.buffer, next.size, (off_t) next.offset);
+        lock.lock();
+
+        if (written != (ssize_t) next.size && error == 0) error = written < 0 ? errno : EIO;
+        pending.pop();
+        idle.push_back(next.buffer);
+        queueChanged.notify_all();
+    }
+}
+
+void DirectWriter::fail(int errorNumber) {
+    lock_guard<mutex> lock(queueLock);
+    if (error == 0) error = errorNumber;
+}
+
+char *DirectWriter::takeBuffer() {
+    unique_lock<mutex> lock(queueLock);
+    queueChanged.wait(lock, [this] { return !idle.empty(); });
+
+    char *buffer = idle.back();
+    idle.pop_back();
+    return buffer;
+}
+
+// Waits until the writer thread has written every buffer handed to it
+void DirectWriter::drain() {
+    unique_lock<mutex> lock(queueLock);
+    queueChanged.wait(lock, [this] { return pending.empty(); });
+}
+
+// Reads the block at offset as it is on disk; past the end of the file it reads as zeros
+bool DirectWriter::readBlock(char *into, uint64_t offset) {
+    drain();
+
+    ssize_t bytesRead = pread(fd, into, DIRECT_ALIGNMENT, (off_t) offset);
+    if (bytesRead < 0) {
+        fail(errno);
+        return false;
+    }
+
+    memset(into + bytesRead, 0, DIRECT_ALIGNMENT - bytesRead);
+    return true;
+}
+
+// Starts filling a buffer at the write position, from the start of the block it falls in
+void DirectWriter::startBuffer() {
+    current = takeBuffer();
+    currentStart = position & ~((uint64_t) DIRECT_ALIGNMENT - 1);
+    currentLen = position - currentStart;
+    if (currentLen > 0) readBlock(current, currentStart);
+}
+
+// Hands the buffer being filled to the writer thread, padding its last block out with what's already on disk
+void DirectWriter::submitCurrent() {
+    if (current == NULL) return;
+
+    size_t size = (currentLen + DIRECT_ALIGNMENT - 1) & ~((size_t) DIRECT_ALIGNMENT - 1);
+    memset(current + currentLen, 0, size - currentLen);
+    if (size != currentLen && currentStart + currentLen < end) {
+        uint64_t lastBlock = currentStart + size - DIRECT_ALIGNMENT;
+        if (readBlock(block, lastBlock)) {
+            size_t kept = currentStart + currentLen - lastBlock;
+            memcpy(current + currentLen, block + kept, DIRECT_ALIGNMENT - kept);
+        }
+    }
+
+    lock_guard<mutex> lock(queueLock);
+    if (size > 0) {
+        pending.push({current, currentStart, size});
+        diskEnd = max(diskEnd, currentStart + size);
+    } else {
+        idle.push_back(current);
+    }
+    current = NULL;
+    queueChanged.notify_all();
+}
+
+ssize_t DirectWriter::write(const char *bytes, size_t size) {
+    if (current != NULL && position != currentStart + currentLen) submitCurrent();
+
+    for (size_t left = size; left > 0;) {
+        if (current == NULL) startBuffer();
+
+        size_t len = min(left, (size_t) DIRECT_BUFFER_BYTES - currentLen);
+        memcpy(current + currentLen, bytes, len);
+        currentLen += len;
+        position += len;
+        bytes += len;
+        left -= len;
+        end = max(end, position);
+
+        if (currentLen == DIRECT_BUFFER_BYTES) submitCurrent();
+    }
+
+    lock_guard<mutex> lock(queueLock);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return (ssize_t) size;
+}
+
+uint64_t DirectWriter::seek(int64_t offset, int whence) {
+    if (whence == SEEK_SET) position = (uint64_t) offset;
+    else if (whence == SEEK_CUR) position += offset;
+    else position = end + offset;
+
+    return position;
+}
+
+bool DirectWriter::flush() {
+    if (fd < 0) return false;
+
+    submitCurrent();
+    drain();
+
+    // Cut off the padding of the last block
+    if (diskEnd > end) {
+        if (ftruncate(fd, (off_t) end) != 0) fail(errno);
+        diskEnd = end;
+    }
+
+    lock_guard<mutex> lock(queueLock);
+    return error == 0;
+}
+
+int DirectWriter::close() {
+    if (fd < 0) return 0;
+    bool flushed = flush();
+
+    {
+        lock_guard<mutex> lock(queueLock);
+        stopping = true;
+        queueChanged.notify_all();
+    }
+    if (writer.joinable()) writer.join();
+
+    int closed = ::close(fd);
+    fd = -1;
+    return flushed && closed == 0 ? 0 : EOF;
+}
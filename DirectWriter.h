@@ -0,0 +1,89 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_DIRECTWRITER_H
+#define SLIDING_WINDOW_DIRECTWRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define DIRECT_ALIGNMENT 4096 // O_DIRECT transfers start, end and sit in memory on multiples of this
+#define DIRECT_BUFFER_BYTES (1 << 20) // written to the disk at a time
+#define DIRECT_QUEUE_DEPTH 8 // buffers being filled or written at once
+
+using namespace std;
+
+/* Writes a file with O_DIRECT, so a large ingest doesn't push everything else out of the page cache. Writes are copied
+ * into aligned buffers, and full buffers are written by a thread of the writer's own while the next one fills, so the
+ * disk is kept busy without holding up the receive loop. A write that doesn't follow on from the last starts a new
+ * buffer, so it's meant for files written mostly front to back.
+ */
+class DirectWriter {
+    struct Write {
+        char *buffer;
+        uint64_t offset;
+        size_t size;
+    };
+
+    int fd = -1;
+    vector<char *> buffers; // every buffer, to free
+    vector<char *> idle; // buffers free to be filled
+    queue<Write> pending; // buffers waiting on or being written by the writer thread
+    mutex queueLock;
+    condition_variable queueChanged;
+    thread writer;
+    bool stopping = false;
+    int error = 0; // errno of the first write that failed
+
+    char *current = NULL; // buffer being filled, holding the file from currentStart
+    uint64_t currentStart = 0;
+    size_t currentLen = 0;
+    char *block = NULL; // a partial block's existing bytes are read into this
+    uint64_t position = 0; // where the next write goes
+    uint64_t end = 0; // size of the file once everything is written
+    uint64_t diskEnd = 0; // size of the file on disk, which may be padded out to a whole block
+
+    DirectWriter() = default;
+
+    void run();
+    void fail(int errorNumber);
+    char *takeBuffer();
+    void startBuffer();
+    void submitCurrent();
+    void drain();
+    bool readBlock(char *into, uint64_t offset);
+
+public:
+    // Opens path with O_DIRECT, returning nullptr if it can't be or its filesystem doesn't allow O_DIRECT
+    static shared_ptr<DirectWriter> open(const string &path, bool truncate);
+
+    ~DirectWriter();
+
+    DirectWriter(const DirectWriter &) = delete;
+    DirectWriter &operator=(const DirectWriter &) = delete;
+
+    // Unbuffered stdio stream whose writes and seeks come here. Closing it closes the writer
+    FILE *stream();
+
+    // Puts everything written so far on the disk, the last partial block included, returning false if any write failed
+    bool flush();
+
+    int descriptor() const {
+        return fd;
+    }
+
+    ssize_t write(const char *bytes, size_t size);
+    uint64_t seek(int64_t offset, int whence);
+    int close();
+};
+
+
+#endif //SLIDING_WINDOW_DIRECTWRITER_H
@@ -0,0 +1,238 @@
+//
+// Created on 10/19/26.
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <memory>
+
+#include "DirectoryTree.h"
+#include "WorkerPool.h"
+
+#define TREE_READ_AHEAD 4 // files per worker read ahead of (or waiting to be written behind) the batch
+
+bool safeRelativePath(const string &name) {
+    if (name.empty() || name[0] == '/' || name.find('\0') != string::npos) return false;
+
+    size_t start = 0;
+    while (start <= name.size()) {
+        size_t end = name.find('/', start);
+        if (end == string::npos) end = name.size();
+
+        string component = name.substr(start, end - start);
+        if (component.empty() || component == "." || component == "..") return false;
+
+        start = end + 1;
+    }
+
+    return true;
+}
+
+bool makeParents(const string &path, unordered_set<string> &made) {
+    for (size_t slash = path.find('/', 1); slash != string::npos; slash = path.find('/', slash + 1)) {
+        string directory = path.substr(0, slash);
+        if (made.count(directory) != 0) continue;
+
+        if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Unable to create the directory %s\nError #: %d\n", directory.c_str(), errno);
+            return false;
+        }
+        made.insert(directory);
+    }
+
+    return true;
+}
+
+// Regular files and directories directly inside a directory; anything else (links, devices, ...) is skipped
+static vector<TreeEntry> listDirectory(const string &path, const string &name) {
+    vector<TreeEntry> entries;
+    DIR *dir = opendir(path.c_str());
+    if (dir == NULL) {
+        fprintf(stderr, "Unable to read the directory %s; leaving it out\n", path.c_str());
+        return entries;
+    }
+
+    struct dirent *dirEntry;
+    while ((dirEntry = readdir(dir)) != NULL) {
+        string entryName = dirEntry->d_name;
+        if (entryName == "." || entryName == "..") continue;
+
+        struct stat entryStat{};
+        string entryPath = path + "/" + entryName;
+        if (lstat(entryPath.c_str(), &entryStat) != 0) continue;
+        if (!S_ISREG(entryStat.st_mode) && !S_ISDIR(entryStat.st_mode)) continue;
+
+        entries.push_back({entryPath, name + "/" + entryName, (uint32_t) entryStat.st_mode,
+                           S_ISREG(entryStat.st_mode) ? (uint64_t) entryStat.st_size : 0});
+    }
+
+    closedir(dir);
+    return entries;
+}
+
+vector<TreeEntry> walkTree(const string &root) {
+    vector<TreeEntry> entries;
+    struct stat rootStat{};
+    if (stat(root.c_str(), &rootStat) != 0 || !S_ISDIR(rootStat.st_mode)) return entries;
+
+    // The tree is recreated under its own name, so "." or a trailing slash still names it
+    char resolved[PATH_MAX];
+    string rootName = realpath(root.c_str(), resolved) != NULL ? resolved : root;
+    rootName = rootName.substr(rootName.find_last_of('/') + 1);
+    if (rootName.empty()) rootName = "root";
+
+    entries.push_back({root, rootName, (uint32_t) rootStat.st_mode, 0});
+
+    WorkerPool pool(TREE_WORKERS);
+    vector<TreeEntry> level{entries.front()};
+    while (!level.empty()) {
+        vector<future<vector<TreeEntry>>> listings;
+        for (TreeEntry &dir : level) {
+            string path = dir.path, name = dir.name;
+            auto task = make_shared<packaged_task<vector<TreeEntry>()>>([path, name] { return listDirectory(path, name); });
+            listings.push_back(task->get_future());
+            pool.submit([task] { (*task)(); });
+        }
+
+        level.clear();
+        for (auto &listing : listings) {
+            for (TreeEntry &entry : listing.get()) {
+                if (S_ISDIR(entry.mode)) level.push_back(entry);
+                entries.push_back(entry);
+            }
+        }
+    }
+
+    sort(entries.begin(), entries.end(), [](const TreeEntry &a, const TreeEntry &b) { return a.name < b.name; });
+    return entries;
+}
+
+// Whole contents of a file, or NULL if it can't be read
+static shared_ptr<vector<char>> readWhole(const string &path, uint64_t size) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == NULL) return NULL;
+
+    auto data = make_shared<vector<char>>(size);
+    data->resize(fread(data->data(), sizeof(char), data->size(), file));
+    fclose(file);
+
+    return data;
+}
+
+size_t packBatch(const vector<TreeEntry> &entries, FILE *batch) {
+    WorkerPool pool(TREE_WORKERS);
+    deque<pair<const TreeEntry *, future<shared_ptr<vector<char>>>>> pending;
+    size_t next = 0, packed = 0;
+
+    while (next < entries.size() || !pending.empty()) {
+        while (next < entries.size() && pending.size() < TREE_WORKERS * TREE_READ_AHEAD) {
+            const TreeEntry &entry = entries[next++];
+            string path = entry.path;
+            uint64_t size = entry.size;
+            bool directory = S_ISDIR(entry.mode);
+
+            auto task = make_shared<packaged_task<shared_ptr<vector<char>>()>>([path, size, directory] {
+                return directory ? make_shared<vector<char>>() : readWhole(path, size);
+            });
+            pending.emplace_back(&entry, task->get_future());
+            pool.submit([task] { (*task)(); });
+        }
+
+        const TreeEntry &entry = *pending.front().first;
+        shared_ptr<vector<char>> data = pending.front().second.get();
+        pending.pop_front();
+
+        if (!data) {
+            fprintf(stderr, "Unable to read %s; leaving it out\n", entry.path.c_str());
+            continue;
+        }
+
+        BatchRecord record{entry.mode, (uint32_t) entry.name.size(), data->size()};
+        fwrite(&record, sizeof(record), 1, batch);
+        fwrite(entry.name.data(), sizeof(char), entry.name.size(), batch);
+        fwrite(data->data(), sizeof(char), data->size(), batch);
+        packed++;
+    }
+
+    fflush(batch);
+    return packed;
+}
+
+BatchUnpacker::BatchUnpacker(const string &root) {
+    this->root = root;
+}
+
+bool BatchUnpacker::unpack(FILE *batch) {
+    atomic<bool> failed(false);
+    BatchRecord record{};
+    deque<future<void>> pending;
+
+    fseeko(batch, 0, SEEK_SET);
+    {
+        WorkerPool pool(TREE_WORKERS);
+
+        while (!failed && fread(&record, sizeof(record), 1, batch) == 1) {
+            string name(record.nameLength, '\0');
+            if (record.nameLength == 0 || record.nameLength > PATH_MAX || record.size > BATCH_MAX_FILE_SIZE ||
+                    fread(&name[0], sizeof(char), name.size(), batch) != name.size() || !safeRelativePath(name)) {
+                fprintf(stderr, "Malformed batch entry after %lu files\n", files);
+                failed = true;
+                break;
+            }
+
+            // Directories are created as they're reached, so they always exist before the files in them are written
+            string path = root + name;
+            if (S_ISDIR(record.mode)) {
+                if (!makeParents(path + "/", made)) failed = true;
+                directories++;
+                continue;
+            }
+
+            auto data = make_shared<vector<char>>(record.size);
+            if (!S_ISREG(record.mode) || fread(data->data(), sizeof(char), data->size(), batch) != data->size()) {
+                fprintf(stderr, "Malformed batch entry %s\n", name.c_str());
+                failed = true;
+                break;
+            }
+            if (!makeParents(path, made)) {
+                failed = true;
+                break;
+            }
+
+            // Bound how much of the batch waits in memory to be written
+            while (pending.size() >= TREE_WORKERS * TREE_READ_AHEAD) {
+                pending.front().get();
+                pending.pop_front();
+            }
+
+            mode_t mode = record.mode & 0777;
+            auto task = make_shared<packaged_task<void()>>([path, data, mode, &failed] {
+                FILE *file = fopen(path.c_str(), "wb");
+                if (file == NULL || fwrite(data->data(), sizeof(char), data->size(), file) != data->size()) {
+                    fprintf(stderr, "Unable to write %s\n", path.c_str());
+                    failed = true;
+                }
+                if (file != NULL) {
+                    fchmod(fileno(file), mode);
+                    fclose(file);
+                }
+            });
+            pending.push_back(task->get_future());
+            pool.submit([task] { (*task)(); });
+
+            files++;
+            bytes += record.size;
+        }
+
+        // The pool finishes what's queued before it's destroyed
+    }
+
+    return !failed;
+}
@@ -0,0 +1,74 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_DIRECTORYTREE_H
+#define SLIDING_WINDOW_DIRECTORYTREE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#define BATCH_SUFFIX ".batch" // appended to the output path for a batch as it's received, before it's unpacked
+#define BATCH_MAX_FILE_SIZE (1 << 20) // files up to this size are packed into a batch rather than sent on their own
+#define TREE_WORKERS 8 // threads reading directories and small files, and writing them back out on the server
+
+using namespace std;
+
+// A file the client sends, and the path the server writes it to within its save directory
+struct OutgoingFile {
+    string path;
+    string name;
+    bool batch; // a batch of small files and directories packed back to back, unpacked by the server
+};
+
+// A regular file or directory found walking a tree
+struct TreeEntry {
+    string path; // where it's read from
+    string name; // relative to the directory the tree was walked from, starting with that directory's own name
+    uint32_t mode;
+    uint64_t size;
+};
+
+// Each entry in a batch: this header, then the entry's name and then its data
+struct BatchRecord {
+    uint32_t mode;
+    uint32_t nameLength;
+    uint64_t size;
+};
+
+// Whether name stays inside the directory it's relative to: not absolute, and no empty, "." or ".." components
+bool safeRelativePath(const string &name);
+
+// Creates each directory leading up to the last component of path, returning false if one couldn't be made
+bool makeParents(const string &path, unordered_set<string> &made);
+
+// Lists every regular file and directory under root, sorted by name so directories come before what's in them. Each
+// level of the tree is read on a worker pool, a directory per job
+vector<TreeEntry> walkTree(const string &root);
+
+/* Packs entries back to back into batch, reading the files ahead on a worker pool. Returns the number of entries
+ * packed; files that can't be read are left out.
+ */
+size_t packBatch(const vector<TreeEntry> &entries, FILE *batch);
+
+/* Server side of a batch. Unpacks each entry beneath the save directory, creating directories as it goes and handing the
+ * files to a worker pool to be written.
+ */
+class BatchUnpacker {
+    string root;
+    unordered_set<string> made; // directories already created
+
+public:
+    uint64_t files = 0, directories = 0, bytes = 0;
+
+    explicit BatchUnpacker(const string &root);
+
+    // Returns false if the batch is malformed or an entry couldn't be written
+    bool unpack(FILE *batch);
+};
+
+
+#endif //SLIDING_WINDOW_DIRECTORYTREE_H
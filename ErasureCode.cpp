@@ -0,0 +1,120 @@
+//
+// Created on 10/19/26.
+//
+
+#include <string.h>
+
+#include "ErasureCode.h"
+#include "GaloisField.h"
+
+ErasureCode::ErasureCode(unsigned int dataShards, unsigned int parityShards) {
+    this->dataShards = dataShards;
+    this->parityShards = parityShards;
+    matrix.resize(parityShards * dataShards);
+
+    // Cauchy matrix 1 / (x_j + y_i) with x_j = dataShards + j and y_i = i, which are all distinct elements
+    for (unsigned int j = 0; j < parityShards; j++) {
+        for (unsigned int i = 0; i < dataShards; i++) {
+            matrix[j * dataShards + i] = GaloisField::inv((uint8_t) ((dataShards + j) ^ i));
+        }
+    }
+
+    // Scale each column by the inverse of its first row so parity 0 is the XOR of the data
+    for (unsigned int i = 0; i < dataShards; i++) {
+        uint8_t scale = GaloisField::inv(matrix[i]);
+
+        for (unsigned int j = 0; j < parityShards; j++) {
+            matrix[j * dataShards + i] = GaloisField::mul(matrix[j * dataShards + i], scale);
+        }
+    }
+}
+
+void ErasureCode::encode(const uint8_t *shard, unsigned int dataIndex, uint8_t *const *parity, size_t len) const {
+    for (unsigned int j = 0; j < parityShards; j++) {
+        GaloisField::mulAddRegion(parity[j], shard, coefficient(j, dataIndex), len);
+    }
+}
+
+bool ErasureCode::reconstruct(uint8_t *const *shards, const vector<bool> &present, size_t len) const {
+    vector<unsigned int> missing;
+    vector<unsigned int> rows;
+
+    for (unsigned int i = 0; i < dataShards; i++) {
+        if (!present[i]) missing.push_back(i);
+    }
+
+    if (missing.empty()) return true;
+
+    // Lowest parity rows first so a single loss with parity 0 present stays XOR only
+    for (unsigned int j = 0; j < parityShards && rows.size() < missing.size(); j++) {
+        if (present[dataShards + j]) rows.push_back(j);
+    }
+
+    if (rows.size() < missing.size()) return false;
+
+    unsigned int erasures = missing.size();
+
+    // Take the contribution of the data shards we do have out of each parity shard, leaving sum(C[j][m] * missing m)
+    vector<uint8_t> syndromes(erasures * len);
+    for (unsigned int r = 0; r < erasures; r++) {
+        uint8_t *syndrome = &syndromes[r * len];
+        memcpy(syndrome, shards[dataShards + rows[r]], len);
+
+        for (unsigned int i = 0; i < dataShards; i++) {
+            if (present[i]) GaloisField::mulAddRegion(syndrome, shards[i], coefficient(rows[r], i), len);
+        }
+    }
+
+    // Invert the coefficients of the missing shards with Gauss-Jordan elimination
+    vector<uint8_t> a(erasures * erasures);
+    vector<uint8_t> inverse(erasures * erasures, 0);
+
+    for (unsigned int r = 0; r < erasures; r++) {
+        for (unsigned int c = 0; c < erasures; c++) {
+            a[r * erasures + c] = coefficient(rows[r], missing[c]);
+        }
+
+        inverse[r * erasures + r] = 1;
+    }
+
+    for (unsigned int col = 0; col < erasures; col++) {
+        unsigned int pivot = col;
+        while (pivot < erasures && a[pivot * erasures + col] == 0) pivot++;
+        if (pivot == erasures) return false; // can't happen for a Cauchy matrix
+
+        if (pivot != col) {
+            for (unsigned int c = 0; c < erasures; c++) {
+                swap(a[pivot * erasures + c], a[col * erasures + c]);
+                swap(inverse[pivot * erasures + c], inverse[col * erasures + c]);
+            }
+        }
+
+        uint8_t scale = GaloisField::inv(a[col * erasures + col]);
+        for (unsigned int c = 0; c < erasures; c++) {
+            a[col * erasures + c] = GaloisField::mul(a[col * erasures + c], scale);
+            inverse[col * erasures + c] = GaloisField::mul(inverse[col * erasures + c], scale);
+        }
+
+        for (unsigned int r = 0; r < erasures; r++) {
+            uint8_t factor = a[r * erasures + col];
+            if (r == col || factor == 0) continue;
+
+            for (unsigned int c = 0; c < erasures; c++) {
+                a[r * erasures + c] ^= GaloisField::mul(factor, a[col * erasures + c]);
+                inverse[r * erasures + c] ^= GaloisField::mul(factor, inverse[col * erasures + c]);
+            }
+        }
+    }
+
+    // missing c = sum(inverse[c][r] * syndrome r)
+    for (unsigned int c = 0; c < erasures; c++) {
+        uint8_t *shard = shards[missing[c]];
+        memset(shard, 0, len);
+
+        for (unsigned int r = 0; r < erasures; r++) {
+            GaloisField::mulAddRegion(shard, &syndromes[r * len], inverse[c * erasures + r], len);
+        }
+    }
+
+    return true;
+}
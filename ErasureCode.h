@@ -0,0 +1,54 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_ERASURECODE_H
+#define SLIDING_WINDOW_ERASURECODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define MAX_FEC_SHARDS 255 // data + parity shards per block; each needs its own element of GF(256)
+
+using namespace std;
+
+/* Systematic Reed-Solomon erasure code over GF(256): N data shards are sent as-is along with K parity shards, and any N
+ * of the N + K rebuild the data.
+ *
+ * Parity j is sum(C[j][i] * data i) for a Cauchy matrix C, every square submatrix of which is invertible. Each column is
+ * scaled so the first parity row is all ones; that keeps the code MDS and makes parity 0 a plain XOR of the data, so the
+ * common single loss is repaired with XORs alone.
+ */
+class ErasureCode {
+    unsigned int dataShards = 0;
+    unsigned int parityShards = 0;
+    vector<uint8_t> matrix; // parityShards x dataShards coefficients
+
+public:
+    ErasureCode() = default;
+    ErasureCode(unsigned int dataShards, unsigned int parityShards);
+
+    unsigned int data() const {
+        return dataShards;
+    }
+
+    unsigned int parity() const {
+        return parityShards;
+    }
+
+    uint8_t coefficient(unsigned int parityIndex, unsigned int dataIndex) const {
+        return matrix[parityIndex * dataShards + dataIndex];
+    }
+
+    // Folds data shard dataIndex into each of the parity shards
+    void encode(const uint8_t *shard, unsigned int dataIndex, uint8_t *const *parity, size_t len) const;
+
+    /* Rebuilds missing data shards in place. shards holds the data shards followed by the parity shards and present
+     * marks which of them hold valid contents. Returns false if too few shards are present to rebuild the data.
+     */
+    bool reconstruct(uint8_t *const *shards, const vector<bool> &present, size_t len) const;
+};
+
+
+#endif //SLIDING_WINDOW_ERASURECODE_H
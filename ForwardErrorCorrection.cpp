@@ -0,0 +1,198 @@
+//
+// Created on 10/19/26.
+//
+
+#include <string.h>
+#include <algorithm>
+
+#include "ForwardErrorCorrection.h"
+
+// Lays out a data packet as a shard: pktSize, FIN/compressed/copy/manifest/SYN flags, offset, rawSize and fileId, then the
+// payload zero padded to the full packet size
+static void toShard(Packet &pkt, uint8_t *shard, size_t shardSize) {
+    uint32_t pktSize = pkt.header.pktSize;
+    uint32_t flags = (pkt.header.flags.fin ? FEC_SHARD_FIN : 0) | (pkt.header.flags.compressed ? FEC_SHARD_COMPRESSED : 0) |
+            (pkt.header.flags.copy ? FEC_SHARD_COPY : 0) | (pkt.header.flags.manifest ? FEC_SHARD_MANIFEST : 0) |
+            (pkt.header.flags.syn ? FEC_SHARD_SYN : 0);
+    uint64_t offset = pkt.header.offset;
+    uint32_t rawSize = pkt.header.rawSize;
+    uint32_t fileId = pkt.header.fileId;
+
+    memset(shard, 0, shardSize);
+    memcpy(shard, &pktSize, sizeof(pktSize));
+    memcpy(shard + 4, &flags, sizeof(flags));
+    memcpy(shard + 8, &offset, sizeof(offset));
+    memcpy(shard + 16, &rawSize, sizeof(rawSize));
+    memcpy(shard + 20, &fileId, sizeof(fileId));
+    if (pktSize > 0) memcpy(shard + FEC_SHARD_HEADER, pkt.payload, min((size_t) pktSize, shardSize - FEC_SHARD_HEADER));
+}
+
+FecEncoder::FecEncoder(unsigned int dataShards, unsigned int parityShards, unsigned int pktSizeBytes) {
+    code = ErasureCode(dataShards, parityShards);
+    shardSize = FEC_SHARD_HEADER + pktSizeBytes;
+    shard.resize(shardSize);
+    parity.resize(parityShards * shardSize);
+
+    for (unsigned int j = 0; j < parityShards; j++) {
+        this->parityShards.push_back(&parity[j * shardSize]);
+    }
+}
+
+bool FecEncoder::add(Packet &pkt, bool last) {
+    // Blocks line up with the sequence numbers so the receiver can tell which block a packet belongs to
+    unsigned int index = (pkt.sqn - 1) % code.data();
+
+    if (index == 0) {
+        blockStart = pkt.sqn;
+        memset(parity.data(), 0, parity.size());
+    }
+
+    toShard(pkt, shard.data(), shardSize);
+    code.encode(shard.data(), index, parityShards.data(), shardSize);
+    count = index + 1;
+
+    return count == code.data() || last;
+}
+
+FecDecoder::FecDecoder(unsigned int dataShards, unsigned int parityShards, unsigned int pktSizeBytes) {
+    code = ErasureCode(dataShards, parityShards);
+    shardSize = FEC_SHARD_HEADER + pktSizeBytes;
+}
+
+FecDecoder::Block &FecDecoder::block(uint64_t blockStart) {
+    auto it = blocks.find(blockStart);
+
+    if (it == blocks.end()) {
+        Block &newBlock = blocks[blockStart];
+        newBlock.shards.assign((code.data() + code.parity()) * shardSize, 0);
+        newBlock.present.assign(code.data() + code.parity(), false);
+        newBlock.dataCount = code.data();
+
+        return newBlock;
+    }
+
+    return it->second;
+}
+
+void FecDecoder::addData(Packet &pkt, vector<Packet> &recovered) {
+    if (pkt.sqn == 0) return;
+
+    uint64_t blockStart = ((pkt.sqn - 1) / code.data()) * code.data() + 1;
+    unsigned int index = pkt.sqn - blockStart;
+    Block &dataBlock = block(blockStart);
+
+    if (dataBlock.complete || dataBlock.present[index]) return;
+
+    toShard(pkt, &dataBlock.shards[index * shardSize], shardSize);
+    dataBlock.present[index] = true;
+    recover(blockStart, dataBlock, recovered);
+}
+
+void FecDecoder::addParity(Packet &pkt, vector<Packet> &recovered) {
+    // Parity carries the sequence number of the first data packet of its block
+    if (pkt.sqn == 0 || (pkt.sqn - 1) % code.data() != 0) return;
+    if (pkt.header.fecIndex >= code.parity() || pkt.header.pktSize != shardSize) return;
+
+    Block &parityBlock = block(pkt.sqn);
+    unsigned int index = code.data() + pkt.header.fecIndex;
+
+    if (parityBlock.complete || parityBlock.present[index]) return;
+
+    memcpy(&parityBlock.shards[index * shardSize], pkt.payload, shardSize);
+    parityBlock.present[index] = true;
+
+    // The block holding the last packet may be short; the data shards past its end were encoded as zeros
+    if (pkt.header.fecData > 0 && pkt.header.fecData < code.data()) {
+        parityBlock.dataCount = pkt.header.fecData;
+        for (unsigned int i = parityBlock.dataCount; i < code.data(); i++) parityBlock.present[i] = true;
+    }
+
+    recover(pkt.sqn, parityBlock, recovered);
+}
+
+void FecDecoder::recover(uint64_t blockStart, Block &block, vector<Packet> &recovered) {
+    vector<unsigned int> missing;
+    unsigned int parityPresent = 0;
+
+    for (unsigned int i = 0; i < code.data(); i++) {
+        if (!block.present[i]) missing.push_back(i);
+    }
+
+    for (unsigned int j = 0; j < code.parity(); j++) {
+        if (block.present[code.data() + j]) parityPresent++;
+    }
+
+    if (missing.empty()) {
+        block.complete = true;
+        return;
+    }
+
+    if (parityPresent < missing.size()) return;
+
+    vector<uint8_t*> shards;
+    for (unsigned int i = 0; i < code.data() + code.parity(); i++) {
+        shards.push_back(&block.shards[i * shardSize]);
+    }
+
+    if (!code.reconstruct(shards.data(), block.present, shardSize)) return;
+
+    for (unsigned int i : missing) {
+        block.present[i] = true;
+        if (!isSyn(shards[i])) recovered.push_back(toPacket(blockStart + i, shards[i]));
+    }
+
+    block.complete = true;
+}
+
+bool FecDecoder::isSyn(const uint8_t *shard) {
+    uint32_t flags;
+    memcpy(&flags, shard + 4, sizeof(flags));
+
+    return (flags & FEC_SHARD_SYN) != 0;
+}
+
+Packet FecDecoder::toPacket(uint64_t sqn, const uint8_t *shard) {
+    Packet pkt;
+    uint32_t pktSize, flags, rawSize, fileId;
+    uint64_t offset;
+
+    memcpy(&pktSize, shard, sizeof(pktSize));
+    memcpy(&flags, shard + 4, sizeof(flags));
+    memcpy(&offset, shard + 8, sizeof(offset));
+    memcpy(&rawSize, shard + 16, sizeof(rawSize));
+    memcpy(&fileId, shard + 20, sizeof(fileId));
+
+    pkt.sqn = sqn;
+    pkt.header.pktSize = min((size_t) pktSize, shardSize - FEC_SHARD_HEADER);
+    pkt.header.offset = offset;
+    pkt.header.rawSize = rawSize;
+    pkt.header.fileId = fileId;
+    pkt.header.flags.fin = ((flags & FEC_SHARD_FIN) ? 1 : 0);
+    pkt.header.flags.compressed = ((flags & FEC_SHARD_COMPRESSED) ? 1 : 0);
+    pkt.header.flags.copy = ((flags & FEC_SHARD_COPY) ? 1 : 0);
+    pkt.header.flags.manifest = ((flags & FEC_SHARD_MANIFEST) ? 1 : 0);
+    pkt.initPayload();
+    if (pkt.header.pktSize > 0) memcpy(pkt.payload, shard + FEC_SHARD_HEADER, pkt.header.pktSize);
+
+    return pkt;
+}
+
+bool FecDecoder::take(uint64_t sqn, Packet &pkt) {
+    if (sqn == 0) return false;
+
+    uint64_t blockStart = ((sqn - 1) / code.data()) * code.data() + 1;
+    unsigned int index = sqn - blockStart;
+    auto it = blocks.find(blockStart);
+
+    if (it == blocks.end() || index >= it->second.dataCount || !it->second.present[index]) return false;
+    if (isSyn(&it->second.shards[index * shardSize])) return false;
+
+    pkt = toPacket(sqn, &it->second.shards[index * shardSize]);
+    return true;
+}
+
+void FecDecoder::release(uint64_t base) {
+    while (!blocks.empty() && blocks.begin()->first + code.data() <= base) {
+        blocks.erase(blocks.begin());
+    }
+}
@@ -0,0 +1,121 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_FORWARDERRORCORRECTION_H
+#define SLIDING_WINDOW_FORWARDERRORCORRECTION_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "ErasureCode.h"
+#include "Packet.h"
+#include "PacketInfo.h"
+
+// Each shard is the data packet's pktSize, flags, file offset, rawSize and fileId followed by its payload padded to the
+// packet size
+#define FEC_SHARD_HEADER 24
+#define FEC_SHARD_FIN 1
+#define FEC_SHARD_COMPRESSED 2
+#define FEC_SHARD_COPY 4
+#define FEC_SHARD_MANIFEST 8
+#define FEC_SHARD_SYN 16 // a sequenced SYN; covered by parity to keep blocks aligned but never rebuilt, as its handshake doesn't fit
+
+using namespace std;
+
+// Parity packet held back until the last data packet of its block has been sent
+struct FecParity {
+    uint64_t blockEnd;
+    PacketInfo pktInfo;
+};
+
+/* Sender side of forward error correction. Data packets are grouped into blocks of N by sequence number (1..N, N+1..2N,
+ * ...) and each is folded into the block's K parity shards as it is read from the file. A block is complete once it
+ * holds N packets or the last packet of the file.
+ */
+class FecEncoder {
+    ErasureCode code;
+    size_t shardSize = 0;
+    vector<uint8_t> shard; // scratch space for the packet being added
+    vector<uint8_t> parity; // K shards back to back
+    vector<uint8_t*> parityShards;
+    unsigned int count = 0; // data packets in the current block
+    uint64_t blockStart = 0;
+
+public:
+    FecEncoder() = default;
+    FecEncoder(unsigned int dataShards, unsigned int parityShards, unsigned int pktSizeBytes);
+
+    bool enabled() const {
+        return code.data() != 0;
+    }
+
+    // Folds a data packet into its block's parity. Returns true once the block is complete and its parity can be sent
+    bool add(Packet &pkt, bool last);
+
+    const uint8_t *parityShard(unsigned int index) const {
+        return parityShards[index];
+    }
+
+    size_t size() const {
+        return shardSize;
+    }
+
+    uint64_t start() const {
+        return blockStart;
+    }
+
+    unsigned int blockSize() const {
+        return count;
+    }
+
+    unsigned int parityCount() const {
+        return code.parity();
+    }
+};
+
+/* Receiver side of forward error correction. Keeps a copy of every data and parity shard of the blocks still in the
+ * window, and rebuilds the data packets of a block that went missing as soon as enough of its shards have arrived.
+ */
+class FecDecoder {
+    struct Block {
+        vector<uint8_t> shards; // N data shards followed by K parity shards
+        vector<bool> present;
+        unsigned int dataCount; // N, or fewer for the block holding the last packet once its parity says so
+        bool complete = false; // every data shard is present
+    };
+
+    ErasureCode code;
+    size_t shardSize = 0;
+    map<uint64_t, Block> blocks; // keyed by the sequence number of the first data packet of the block
+
+    Block &block(uint64_t blockStart);
+    void recover(uint64_t blockStart, Block &block, vector<Packet> &recovered);
+    bool isSyn(const uint8_t *shard);
+    Packet toPacket(uint64_t sqn, const uint8_t *shard);
+
+public:
+    FecDecoder() = default;
+    FecDecoder(unsigned int dataShards, unsigned int parityShards, unsigned int pktSizeBytes);
+
+    bool enabled() const {
+        return code.data() != 0;
+    }
+
+    // Stores a data packet, appending any packets of its block that can now be rebuilt to recovered
+    void addData(Packet &pkt, vector<Packet> &recovered);
+
+    // Stores a parity packet, appending any packets of its block that can now be rebuilt to recovered
+    void addParity(Packet &pkt, vector<Packet> &recovered);
+
+    // Rebuilds a data packet from its stored shard, if held
+    bool take(uint64_t sqn, Packet &pkt);
+
+    // Drops the blocks that end before base
+    void release(uint64_t base);
+};
+
+
+#endif //SLIDING_WINDOW_FORWARDERRORCORRECTION_H
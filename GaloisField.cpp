@@ -0,0 +1,200 @@
+//
+// Created on 10/19/26.
+//
+
+#include <string.h>
+
+#include "GaloisField.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GF_X86
+#endif
+
+#define GF_POLYNOMIAL 0x11D
+
+enum Kernel {SCALAR, SSSE3, AVX2};
+
+struct Tables {
+    uint8_t exp[512]; // doubled so exp[log a + log b] never needs reducing mod 255
+    uint8_t log[256];
+
+    Tables() {
+        unsigned int x = 1;
+
+        for (int i = 0; i < 255; i++) {
+            exp[i] = x;
+            log[x] = i;
+
+            x <<= 1;
+            if (x & 0x100) x ^= GF_POLYNOMIAL;
+        }
+
+        for (int i = 255; i < 512; i++) exp[i] = exp[i - 255];
+        log[0] = 0;
+    }
+};
+
+static const Tables tables;
+
+static Kernel detectKernel() {
+#ifdef GF_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return AVX2;
+    if (__builtin_cpu_supports("ssse3")) return SSSE3;
+#endif
+    return SCALAR;
+}
+
+static const Kernel activeKernel = detectKernel();
+
+// Products of c with every low nibble and every high nibble; c * x = low[x & 0xF] ^ high[x >> 4]
+static void nibbleTables(uint8_t c, uint8_t *low, uint8_t *high) {
+    for (uint8_t i = 0; i < 16; i++) {
+        low[i] = GaloisField::mul(c, i);
+        high[i] = GaloisField::mul(c, i << 4);
+    }
+}
+
+#ifdef GF_X86
+// Each kernel returns the number of bytes it processed; the tail is left to the scalar loop
+__attribute__((target("ssse3")))
+static size_t mulAddSsse3(uint8_t *dst, const uint8_t *src, const uint8_t *low, const uint8_t *high, size_t len) {
+    __m128i lowTable = _mm_loadu_si128((const __m128i *) low);
+    __m128i highTable = _mm_loadu_si128((const __m128i *) high);
+    __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i *) (src + i));
+        __m128i lowProduct = _mm_shuffle_epi8(lowTable, _mm_and_si128(in, mask));
+        __m128i highProduct = _mm_shuffle_epi8(highTable, _mm_and_si128(_mm_srli_epi64(in, 4), mask));
+        __m128i out = _mm_loadu_si128((const __m128i *) (dst + i));
+
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_xor_si128(out, _mm_xor_si128(lowProduct, highProduct)));
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t mulAddAvx2(uint8_t *dst, const uint8_t *src, const uint8_t *low, const uint8_t *high, size_t len) {
+    __m256i lowTable = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) low));
+    __m256i highTable = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) high));
+    __m256i mask = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i *) (src + i));
+        __m256i lowProduct = _mm256_shuffle_epi8(lowTable, _mm256_and_si256(in, mask));
+        __m256i highProduct = _mm256_shuffle_epi8(highTable, _mm256_and_si256(_mm256_srli_epi64(in, 4), mask));
+        __m256i out = _mm256_loadu_si256((const __m256i *) (dst + i));
+
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_xor_si256(out, _mm256_xor_si256(lowProduct, highProduct)));
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t xorAvx2(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i out = _mm256_loadu_si256((const __m256i *) (dst + i));
+        __m256i in = _mm256_loadu_si256((const __m256i *) (src + i));
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_xor_si256(out, in));
+    }
+
+    return i;
+}
+
+__attribute__((target("sse2")))
+static size_t xorSse2(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i out = _mm_loadu_si128((const __m128i *) (dst + i));
+        __m128i in = _mm_loadu_si128((const __m128i *) (src + i));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_xor_si128(out, in));
+    }
+
+    return i;
+}
+#endif
+
+uint8_t GaloisField::mul(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) return 0;
+
+    return tables.exp[tables.log[a] + tables.log[b]];
+}
+
+uint8_t GaloisField::div(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) return 0; // division by zero is undefined; callers never divide by zero
+
+    return tables.exp[tables.log[a] + 255 - tables.log[b]];
+}
+
+uint8_t GaloisField::inv(uint8_t a) {
+    return div(1, a);
+}
+
+void GaloisField::mulAddRegion(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len) {
+    if (c == 0) return;
+    if (c == 1) {
+        xorRegion(dst, src, len);
+        return;
+    }
+
+    uint8_t low[16], high[16];
+    nibbleTables(c, low, high);
+    size_t i = 0;
+
+#ifdef GF_X86
+    if (activeKernel == AVX2) {
+        i = mulAddAvx2(dst, src, low, high, len);
+    } else if (activeKernel == SSSE3) {
+        i = mulAddSsse3(dst, src, low, high, len);
+    }
+#endif
+
+    for (; i < len; i++) {
+        dst[i] ^= low[src[i] & 0x0F] ^ high[src[i] >> 4];
+    }
+}
+
+void GaloisField::xorRegion(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+
+#ifdef GF_X86
+    if (activeKernel == AVX2) {
+        i = xorAvx2(dst, src, len);
+    } else {
+        i = xorSse2(dst, src, len);
+    }
+#endif
+
+    // Eight bytes at a time, then the remainder
+    for (; i + 8 <= len; i += 8) {
+        uint64_t out, in;
+        memcpy(&out, dst + i, 8);
+        memcpy(&in, src + i, 8);
+        out ^= in;
+        memcpy(dst + i, &out, 8);
+    }
+
+    for (; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+const char *GaloisField::kernel() {
+    switch (activeKernel) {
+        case AVX2:
+            return "avx2";
+        case SSSE3:
+            return "ssse3";
+        default:
+            return "scalar";
+    }
+}
@@ -0,0 +1,36 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_GALOISFIELD_H
+#define SLIDING_WINDOW_GALOISFIELD_H
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/* Arithmetic over GF(2^8) (polynomial 0x11D) for the Reed-Solomon erasure code.
+ *
+ * Single elements use log/exp tables. Whole buffers are multiplied with the split nibble table method: the products of a
+ * constant with every low and every high nibble are two 16 entry tables, which SSSE3/AVX2 look up 16/32 bytes at a time
+ * with PSHUFB. The widest kernel the CPU supports is picked on first use.
+ */
+class GaloisField {
+public:
+    static uint8_t mul(uint8_t a, uint8_t b);
+    static uint8_t div(uint8_t a, uint8_t b);
+    static uint8_t inv(uint8_t a);
+
+    // dst ^= c * src over len bytes
+    static void mulAddRegion(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len);
+
+    // dst ^= src over len bytes
+    static void xorRegion(uint8_t *dst, const uint8_t *src, size_t len);
+
+    // Name of the kernel in use ("avx2", "ssse3" or "scalar")
+    static const char *kernel();
+};
+
+
+#endif //SLIDING_WINDOW_GALOISFIELD_H
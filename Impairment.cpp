@@ -0,0 +1,96 @@
+//
+// Created on 10/19/26.
+//
+
+#include <algorithm>
+
+#include "Impairment.h"
+
+void ImpairmentModel::apply(vector<char> frame, int64_t arrival, FrameQueue &frames) {
+    double transition = uniform(random), loss = uniform(random), damage = uniform(random);
+    double duplicate = uniform(random), reorder = uniform(random), jitter = uniform(random);
+    uint64_t bit = random();
+    bool impair = impairable(frame);
+    stats.frames++;
+
+    if (impair) {
+        // The chance of losing this frame comes from the state it arrives in; the state then moves on
+        bool lost = loss < (bad ? impairments.badLoss : impairments.goodLoss);
+        if (bad && transition < impairments.badToGood) {
+            bad = false;
+        } else if (!bad && transition < impairments.goodToBad) {
+            bad = true;
+            stats.bursts++;
+        }
+
+        if (lost) {
+            stats.lost++;
+            return;
+        }
+    }
+
+    // Serialise the frame onto the bottleneck, unless its queue is already full
+    int64_t departure = arrival;
+    if (impairments.rateMbps > 0) {
+        double bytesPerUs = impairments.rateMbps / 8;
+        double queued = linkFree > arrival ? (linkFree - arrival) * bytesPerUs : 0;
+        if (queued + frame.size() > impairments.queueBytes) {
+            stats.queueDrops++;
+            return;
+        }
+
+        departure = max(arrival, linkFree) + (int64_t) (frame.size() / bytesPerUs);
+        linkFree = departure;
+    }
+
+    int64_t release = departure + max((int64_t) 0, (int64_t) ((impairments.delayMs + (2 * jitter - 1) * impairments.jitterMs) * 1e3));
+    if (impair && reorder < impairments.reorder) {
+        release = max(release, lastRelease) + (int64_t) (impairments.reorderGapMs * 1e3);
+        stats.reordered++;
+    } else {
+        release = max(release, lastRelease);
+        lastRelease = release;
+    }
+
+    if (impair && damage < impairments.damage) {
+        auto *header = reinterpret_cast<Packet::Header *>(frame.data());
+        bool covered = header->pktSize != 0 && header->flags.ping != 1 && header->flags.syn != 1 && header->flags.ack != 1;
+        if (covered) {
+            frame[sizeof(Packet::Header) + (bit >> 3) % header->pktSize] ^= (char) (1 << (bit & 7));
+        } else {
+            header->chksum = ~header->chksum;
+        }
+        stats.damaged++;
+    }
+
+    if (impair && duplicate < impairments.duplicate) {
+        frames.push({release, order++, frame});
+        stats.duplicated++;
+    }
+    frames.push({release, order++, move(frame)});
+}
+
+void ImpairmentModel::splitFrames(vector<char> &stream, const function<void(vector<char>)> &take) {
+    size_t offset = 0;
+    while (stream.size() - offset >= sizeof(Packet::Header)) {
+        auto *header = reinterpret_cast<const Packet::Header *>(stream.data() + offset);
+        size_t size = sizeof(Packet::Header) + header->handshakeSize() + header->payloadSize();
+        if (stream.size() - offset < size) break;
+
+        // The usual case, a stream holding exactly one frame, hands the frame over without copying it
+        if (offset == 0 && size == stream.size()) {
+            take(move(stream));
+            stream.clear();
+            return;
+        }
+
+        take(vector<char>(stream.begin() + offset, stream.begin() + offset + size));
+        offset += size;
+    }
+    stream.erase(stream.begin(), stream.begin() + offset);
+}
+
+bool ImpairmentModel::impairable(const vector<char> &frame) {
+    auto *header = reinterpret_cast<const Packet::Header *>(frame.data());
+    return header->flags.syn != 1 && header->flags.ping != 1;
+}
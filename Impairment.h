@@ -0,0 +1,85 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_IMPAIRMENT_H
+#define SLIDING_WINDOW_IMPAIRMENT_H
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "Packet.h"
+
+#define IMPAIR_QUEUE_BYTES (64 << 10) // bottleneck queue, when the bandwidth is capped
+#define IMPAIR_REORDER_GAP_MS 10 // how far behind a reordered frame is held
+
+using namespace std;
+
+/* What happens to the frames going one way. Every probability is per frame, and only data packets and ACKs are impaired;
+ * the handshake and pings go through untouched, as the sender's own simulated errors spare them.
+ */
+struct Impairments {
+    double goodLoss = 0; // loss in the Gilbert-Elliott good state; alone, it's independent loss
+    double badLoss = 1; // loss in the bad state
+    double goodToBad = 0; // chance of a burst starting after each frame
+    double badToGood = 1; // chance of a burst ending after each frame; its mean length is 1 / this
+    double damage = 0; // a bit of the payload (or the checksum, if the payload isn't covered by it) is flipped
+    double duplicate = 0;
+    double reorder = 0; // held back reorderGapMs more than its delay, so frames after it overtake it
+    double reorderGapMs = IMPAIR_REORDER_GAP_MS;
+    double delayMs = 0;
+    double jitterMs = 0; // delay varies uniformly by up to this either way, without reordering frames
+    double rateMbps = 0; // bottleneck bandwidth; 0 is uncapped
+    uint64_t queueBytes = IMPAIR_QUEUE_BYTES; // frames arriving to a queue this full are dropped
+};
+
+struct DirectionStats {
+    uint64_t frames = 0, lost = 0, bursts = 0, damaged = 0, duplicated = 0, reordered = 0, queueDrops = 0;
+};
+
+// A packet on the wire: its header and payload, due to be delivered at release
+struct Frame {
+    int64_t release; // in us
+    uint64_t order; // frames released at the same time go in the order they arrived
+    vector<char> bytes;
+
+    bool operator>(const Frame &other) const {
+        return release != other.release ? release > other.release : order > other.order;
+    }
+};
+
+typedef priority_queue<Frame, vector<Frame>, greater<Frame>> FrameQueue;
+
+/* Applies one direction's impairments to the frames it's given, deciding each frame's fate and release time. Every
+ * frame draws the same random numbers whatever befalls it, so a seed replays the same losses, damage and reordering for
+ * the same sequence of frames even when the timing differs between runs.
+ */
+class ImpairmentModel {
+    const Impairments &impairments;
+    mt19937_64 random;
+    uniform_real_distribution<double> uniform{0, 1};
+    bool bad = false; // Gilbert-Elliott state
+    int64_t linkFree = 0; // when the bottleneck finishes sending what's queued
+    int64_t lastRelease = 0; // frames that aren't reordered never overtake each other
+    uint64_t order = 0;
+
+public:
+    DirectionStats stats;
+
+    ImpairmentModel(const Impairments &impairments, seed_seq &seed) : impairments(impairments), random(seed) {}
+
+    // Queues a frame that arrived at the given time (in us), unless it's lost or dropped
+    void apply(vector<char> frame, int64_t arrival, FrameQueue &frames);
+
+    // Splits every whole frame off the front of a byte stream, passing each to take
+    static void splitFrames(vector<char> &stream, const function<void(vector<char>)> &take);
+
+    // Whether a frame is subject to impairment; only data packets and ACKs are
+    static bool impairable(const vector<char> &frame);
+};
+
+
+#endif //SLIDING_WINDOW_IMPAIRMENT_H
@@ -4,10 +4,13 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <stdarg.h>
 #include <string.h>
+#include <thread>
 
 #include "boost/asio.hpp"
 #include "ConnectionController.h"
+#include "ErasureCode.h"
 #include "InputHelper.h"
 
 using namespace std;
@@ -49,16 +52,21 @@ void InputHelper::parseArgs(int argc, char **argv, ApplicationState *appState) {
             }
 
             // Set file to be sent (client) or path which to save files to (server)
+            // Clients may give several files, which are all sent over the one connection
             if (strcmp(argv[i], "--fp") == 0 || strcmp(argv[i], "fp") == 0 || strcmp(argv[i], "--file") == 0 || strcmp(argv[i], "file") == 0) {
-                appState->filePath = argv[i + 1];
+                string path = argv[i + 1];
 
-                if (stat(appState->filePath.c_str(), &appState->fileStats) != 0) {
+                if (stat(path.c_str(), &appState->fileStats) != 0) {
                     fprintf(stderr, "Invalid file path provided: Unable to access file path.\n");
                     exit(-1);
-                } else {
-                    if (appState->role == CLIENT) {
+                } else if (appState->role != SERVER) {
+                    if (appState->filePaths.empty()) {
+                        appState->filePath = path;
                         appState->fileName = getFileName(&appState->filePath);
                     }
+                    appState->filePaths.push_back(path);
+                } else {
+                    appState->filePath = path;
                 }
             }
 
@@ -121,15 +129,40 @@ void InputHelper::parseArgs(int argc, char **argv, ApplicationState *appState) {
                 appState->connectionSettings.pingCalculatedTimeout = true;
             }
 
+            // Skip the ping test and the wait for the SYN-ACK before sending data
+            if (strcmp(argv[i], "--fast") == 0 || strcmp(argv[i], "fast") == 0) {
+                appState->connectionSettings.fastStart = true;
+            }
+
+            // Shrink packets while losses are frequent and grow them back while the link is clean
+            if (strcmp(argv[i], "--adaptive") == 0 || strcmp(argv[i], "adaptive") == 0) {
+                appState->connectionSettings.adaptivePktSize = true;
+            }
+
+            // Take the default for every setting not given on the command line rather than prompting for it
+            if (strcmp(argv[i], "--no-prompt") == 0 || strcmp(argv[i], "no-prompt") == 0) {
+                appState->interactive = false;
+            }
+
+            // Exit once the first connection is over rather than waiting for another (server)
+            if (strcmp(argv[i], "--once") == 0 || strcmp(argv[i], "once") == 0) {
+                appState->serveOnce = true;
+            }
+
+            // Use TCP Fast Open
+            if (strcmp(argv[i], "--tfo") == 0 || strcmp(argv[i], "tfo") == 0) {
+                appState->connectionSettings.tcpFastOpen = true;
+            }
+
             // Set sliding window size
             if (strcmp(argv[i], "--wsize") == 0 || strcmp(argv[i], "wsize") == 0) {
                 try {
                     tmp = stoi(argv[i + 1]);
 
-                    if (tmp > 0 && tmp < 513) {
+                    if (tmp > 0 && tmp <= MAX_WINDOW_SIZE) {
                         appState->connectionSettings.wSize = tmp;
                     } else {
-                        fprintf(stderr, "Invalid window size provided: Value must be between 0 and 65.\n");
+                        fprintf(stderr, "Invalid window size provided: Value must be from 1 to %d.\n", MAX_WINDOW_SIZE);
                         exit(-1);
                     }
                 } catch (invalid_argument &e) {
@@ -138,17 +171,231 @@ void InputHelper::parseArgs(int argc, char **argv, ApplicationState *appState) {
                 }
             }
 
+            // Congestion control algorithm
+            if (strcmp(argv[i], "--cc") == 0 || strcmp(argv[i], "cc") == 0) {
+                string algorithm = (i + 1 < argc) ? argv[i + 1] : "";
+
+                if (algorithm == "cubic") {
+                    appState->connectionSettings.congestionAlgorithm = CUBIC;
+                } else if (algorithm == "reno") {
+                    appState->connectionSettings.congestionAlgorithm = RENO;
+                } else if (algorithm == "none") {
+                    appState->connectionSettings.congestionAlgorithm = NO_CC;
+                } else {
+                    fprintf(stderr, "Invalid congestion control provided: Value must be cubic, reno or none.\n");
+                    exit(-1);
+                }
+            }
+
+            // Disable packet pacing
+            if (strcmp(argv[i], "--nopace") == 0 || strcmp(argv[i], "nopace") == 0) {
+                appState->connectionSettings.pacing = false;
+            }
+
+            // Rate cap (Mbps) per connection
+            if (strcmp(argv[i], "--rate") == 0 || strcmp(argv[i], "rate") == 0) {
+                try {
+                    float tmp_f = stof(argv[i + 1]);
+
+                    if (tmp_f > 0) {
+                        appState->connectionSettings.rateLimit = tmp_f;
+                    } else {
+                        fprintf(stderr, "Invalid rate provided: Value must be positive.\n");
+                        exit(-1);
+                    }
+                } catch (invalid_argument &e) {
+                    fprintf(stderr, "Invalid rate provided: Error parsing value.\n");
+                    exit(-1);
+                }
+            }
+
+            // Rate cap (Mbps) across all connections
+            if (strcmp(argv[i], "--prate") == 0 || strcmp(argv[i], "prate") == 0) {
+                try {
+                    float tmp_f = stof(argv[i + 1]);
+
+                    if (tmp_f > 0) {
+                        appState->connectionSettings.processRateLimit = tmp_f;
+                    } else {
+                        fprintf(stderr, "Invalid process rate provided: Value must be positive.\n");
+                        exit(-1);
+                    }
+                } catch (invalid_argument &e) {
+                    fprintf(stderr, "Invalid process rate provided: Error parsing value.\n");
+                    exit(-1);
+                }
+            }
+
+            // Forward error correction: N data packets and K parity packets per block
+            if (strcmp(argv[i], "--fec") == 0 || strcmp(argv[i], "fec") == 0) {
+                string shape = (i + 1 < argc) ? argv[i + 1] : "";
+                size_t comma = shape.find(',');
+
+                try {
+                    if (comma == string::npos) throw invalid_argument("missing ,");
+
+                    int dataPkts = stoi(shape.substr(0, comma));
+                    int parityPkts = stoi(shape.substr(comma + 1));
+
+                    if (dataPkts > 0 && parityPkts > 0 && dataPkts + parityPkts <= MAX_FEC_SHARDS) {
+                        appState->connectionSettings.fecData = dataPkts;
+                        appState->connectionSettings.fecParity = parityPkts;
+                    } else {
+                        fprintf(stderr, "Invalid FEC block provided: Values must be positive with at most %d packets per block.\n", MAX_FEC_SHARDS);
+                        exit(-1);
+                    }
+                } catch (invalid_argument &e) {
+                    fprintf(stderr, "Invalid FEC block provided: Expected <data packets>,<parity packets>.\n");
+                    exit(-1);
+                }
+            }
+
+            // Compress payloads, by default on all but one core
+            if (strcmp(argv[i], "--compress") == 0 || strcmp(argv[i], "compress") == 0) {
+                appState->connectionSettings.compression = DEFLATE;
+
+                if (appState->connectionSettings.compressionThreads == 0) {
+                    unsigned int cores = thread::hardware_concurrency();
+                    appState->connectionSettings.compressionThreads = min(max(cores, 2u) - 1, 8u);
+                }
+            }
+
+            // Threads compressing payloads
+            if (strcmp(argv[i], "--cthreads") == 0 || strcmp(argv[i], "cthreads") == 0) {
+                try {
+                    tmp = stoi(argv[i + 1]);
+
+                    if (tmp > 0) {
+                        appState->connectionSettings.compressionThreads = tmp;
+                    } else {
+                        fprintf(stderr, "Invalid compression thread count provided: Value must be positive.\n");
+                        exit(-1);
+                    }
+                } catch (invalid_argument &e) {
+                    fprintf(stderr, "Invalid compression thread count provided: Error parsing value.\n");
+                    exit(-1);
+                }
+            }
+
+            // Only send what differs from the server's existing copy
+            if (strcmp(argv[i], "--delta") == 0 || strcmp(argv[i], "delta") == 0) {
+                appState->connectionSettings.delta = true;
+            }
+
+            // Only send chunks the server's chunk store doesn't already hold
+            if (strcmp(argv[i], "--dedup") == 0 || strcmp(argv[i], "dedup") == 0) {
+                appState->connectionSettings.dedup = true;
+            }
+
+            // Directory the server keeps received chunks in for later dedup transfers
+            if (strcmp(argv[i], "--store") == 0 || strcmp(argv[i], "store") == 0) {
+                if (i + 1 < argc) {
+                    appState->connectionSettings.storePath = argv[i + 1];
+                } else {
+                    fprintf(stderr, "Invalid chunk store provided: Expected a directory.\n");
+                    exit(-1);
+                }
+            }
+
+            // How the server writes received files
+            if (strcmp(argv[i], "--io") == 0 || strcmp(argv[i], "io") == 0) {
+                string mode = (i + 1 < argc) ? argv[i + 1] : "";
+
+                if (mode == "buffered") {
+                    appState->connectionSettings.ioMode = IO_BUFFERED;
+                } else if (mode == "direct") {
+                    appState->connectionSettings.ioMode = IO_DIRECT;
+                } else if (mode == "sync") {
+                    appState->connectionSettings.ioMode = IO_SYNC;
+                } else {
+                    fprintf(stderr, "Invalid I/O mode provided: Value must be buffered, direct or sync.\n");
+                    exit(-1);
+                }
+            }
+
+            // Hold each ACK until its packet is written, and the last of a file's until the file is on disk (server)
+            if (strcmp(argv[i], "--ack-durable") == 0 || strcmp(argv[i], "ack-durable") == 0) {
+                appState->connectionSettings.ackDurable = true;
+            }
+
+            // Encrypt and authenticate every packet under the key in this file. Both ends need the same one
+            if (strcmp(argv[i], "--psk") == 0 || strcmp(argv[i], "psk") == 0) {
+                if (i + 1 >= argc || !loadPsk(argv[i + 1], appState->connectionSettings.psk)) {
+                    fprintf(stderr, "Invalid pre-shared key provided: Expected a readable file of at least %d bytes.\n", CIPHER_MIN_PSK_BYTES);
+                    exit(-1);
+                }
+                if (appState->connectionSettings.cipher == NO_CIPHER) appState->connectionSettings.cipher = preferredCipher();
+            }
+
+            // Overrides the cipher chosen for this CPU (client)
+            if (strcmp(argv[i], "--cipher") == 0 || strcmp(argv[i], "cipher") == 0) {
+                string suite = (i + 1 < argc) ? argv[i + 1] : "";
+
+                if (suite == "aes-gcm") {
+                    appState->connectionSettings.cipher = AES_256_GCM;
+                } else if (suite == "chacha20") {
+                    appState->connectionSettings.cipher = CHACHA20_POLY1305;
+                } else {
+                    fprintf(stderr, "Invalid cipher provided: Value must be aes-gcm or chacha20.\n");
+                    exit(-1);
+                }
+            }
+
+            // Binary trace of the packets, for sliding_window_trace to decode
+            if (strcmp(argv[i], "--trace") == 0 || strcmp(argv[i], "trace") == 0) {
+                if (i + 1 < argc) {
+                    appState->tracePath = argv[i + 1];
+                } else {
+                    fprintf(stderr, "Invalid trace file provided: Expected a file path.\n");
+                    exit(-1);
+                }
+            }
+
+            // How much to trace
+            if (strcmp(argv[i], "--trace-level") == 0 || strcmp(argv[i], "trace-level") == 0) {
+                try {
+                    tmp = stoi(argv[i + 1]);
+
+                    if (tmp >= TRACE_LEVEL_OFF && tmp <= TRACE_LEVEL_WINDOW) {
+                        appState->traceLevel = tmp;
+                    } else {
+                        fprintf(stderr, "Invalid trace level provided: Value must be from %d to %d.\n", TRACE_LEVEL_OFF, TRACE_LEVEL_WINDOW);
+                        exit(-1);
+                    }
+                } catch (invalid_argument &e) {
+                    fprintf(stderr, "Invalid trace level provided: Error parsing value.\n");
+                    exit(-1);
+                }
+            }
+
+            // File the live metrics are rewritten to
+            if (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "stats") == 0) {
+                if (i + 1 < argc) {
+                    appState->connectionSettings.statsPath = argv[i + 1];
+                } else {
+                    fprintf(stderr, "Invalid stats file provided: Expected a file path.\n");
+                    exit(-1);
+                }
+            }
+
+            // Unix socket the live metrics are served on
+            if (strcmp(argv[i], "--metrics-socket") == 0 || strcmp(argv[i], "metrics-socket") == 0) {
+                if (i + 1 < argc) {
+                    appState->connectionSettings.metricsSocket = argv[i + 1];
+                } else {
+                    fprintf(stderr, "Invalid metrics socket provided: Expected a socket path.\n");
+                    exit(-1);
+                }
+            }
+
             // Range of sequence numbers
             if (strcmp(argv[i], "--sqn") == 0 || strcmp(argv[i], "sqn") == 0) {
                 try {
                     tmp = stoi(argv[i + 1]);
 
                     if (tmp > 0 && tmp < 33) {
-                        if (tmp == 32) {
-                            appState->connectionSettings.sqnRange = -1; // assigning an unsigned int to -1 results in it containing its maximum value
-                        } else {
-                            appState->connectionSettings.sqnRange = (1 << tmp);
-                        }
+                        appState->connectionSettings.sqnRange = (1ULL << tmp);
+                        appState->connectionSettings.sqnBits = tmp;
                     } else {
                         fprintf(stderr, "Invalid sequence range provided: Value must be between 0 and 33 bits.\n");
                         exit(-1);
@@ -257,14 +504,14 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
     unsigned int tmp = 0;
 
     if (appState->role == NO_ROLE) {
-        printf("Select role:\n");
-        printf("\t1 - Client (Default)\n");
-        printf("\t2 - Server\n");
-        printf(">> ");
+        prompt(appState, "Select role:\n");
+        prompt(appState, "\t1 - Client (Default)\n");
+        prompt(appState, "\t2 - Server\n");
+        prompt(appState, ">> ");
 
         while (appState->role == NO_ROLE) {
             try {
-                getline(cin, input);
+                readInput(appState, input);
                 if (input.empty()) {
                     appState->role = CLIENT;
                     break;
@@ -294,12 +541,12 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
 
         while (appState->ipAddresses.empty()) {
             if (appState->role == CLIENT) {
-                printf("Enter a comma-separated sequence of IP addresses to connect to (Default: 127.0.0.1): ");
+                prompt(appState, "Enter a comma-separated sequence of IP addresses to connect to (Default: 127.0.0.1): ");
             } else {
-                printf("Enter a comma-separated sequence of IP addresses to permit connections from (Default: Any): ");
+                prompt(appState, "Enter a comma-separated sequence of IP addresses to permit connections from (Default: Any): ");
             }
 
-            getline(cin, input);
+            readInput(appState, input);
             if (input.empty()) {
                 if (appState->role == CLIENT) appState->ipAddresses.emplace_back("127.0.0.1");
                 break;
@@ -313,11 +560,11 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
 
     input.clear();
     if (appState->connectionSettings.port == 0) {
-        printf("Enter Port to connect to (Default: 9000): ");
+        prompt(appState, "Enter Port to connect to (Default: 9000): ");
 
         while (appState->connectionSettings.port == 0) {
             try {
-                getline(cin, input);
+                readInput(appState, input);
                 if (input.empty()) {
                     appState->connectionSettings.port = 9000;
                     break;
@@ -334,11 +581,15 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
 
     input.clear();
     if (appState->filePath.empty()) {
-        if (appState->role == CLIENT) printf("Enter path of file to be sent: ");
-        else printf("Enter path which to save files to (Default: ./): ");
+        if (appState->role == CLIENT) prompt(appState, "Enter path of file or directory to be sent: ");
+        else prompt(appState, "Enter path which to save files to (Default: ./): ");
 
         while (appState->filePath.empty()) {
-            getline(cin, input);
+            if (!appState->interactive && appState->role == CLIENT) {
+                fprintf(stderr, "No file path provided: A client needs --file when not prompting.\n");
+                exit(-1);
+            }
+            readInput(appState, input);
 
             if (appState->role == SERVER && input.empty()) {
                 input = "./";
@@ -363,19 +614,20 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
 
             appState->filePath = input;
             appState->fileName = getFileName(&appState->filePath);
+            if (appState->role == CLIENT && !appState->filePath.empty()) appState->filePaths.push_back(appState->filePath);
         }
     }
 
     input.clear();
     if (appState->connectionSettings.protocol == NO_PROTO) {
-        printf("Select protocol:\n");
-        printf("\t1 - Selective Repeat (Default)\n");
-        printf("\t2 - Go-Back-N\n");
-        printf(">> ");
+        prompt(appState, "Select protocol:\n");
+        prompt(appState, "\t1 - Selective Repeat (Default)\n");
+        prompt(appState, "\t2 - Go-Back-N\n");
+        prompt(appState, ">> ");
 
         while (appState->connectionSettings.protocol == NO_PROTO) {
             try {
-                getline(cin, input);
+                readInput(appState, input);
 
                 if (input.empty()) {
                     appState->connectionSettings.protocol = SR;
@@ -402,11 +654,11 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
 
     input.clear();
     if (appState->connectionSettings.pktSize == 0) {
-        printf("Enter packet size in KB (Default: 32, Max: 64): ");
+        prompt(appState, "Enter packet size in KB (Default: 32, Max: 64): ");
 
         while (appState->connectionSettings.pktSize == 0) {
             try {
-                getline(cin, input);
+                readInput(appState, input);
                 if (input.empty()) {
                     appState->connectionSettings.pktSize = 32;
                     break;
@@ -428,13 +680,13 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
     input.clear();
     if (appState->connectionSettings.timeoutInterval.count() == 0) {
         if (appState->role == CLIENT) {
-            printf("Select timeout interval calculation: \n");
-            printf("\t1 - Ping calculated (Default)\n");
-            printf("\t2 - User specified\n");
-            printf(">> ");
+            prompt(appState, "Select timeout interval calculation: \n");
+            prompt(appState, "\t1 - Ping calculated (Default)\n");
+            prompt(appState, "\t2 - User specified\n");
+            prompt(appState, ">> ");
 
             while (appState->connectionSettings.timeoutInterval.count() == 0 && !appState->connectionSettings.pingCalculatedTimeout) {
-                getline(cin, input);
+                readInput(appState, input);
 
                 if (input.empty()) {
                     appState->connectionSettings.pingCalculatedTimeout = true;
@@ -447,10 +699,10 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
                     if (tmp == 1) {
                         appState->connectionSettings.pingCalculatedTimeout = true;
                     } else if (tmp == 2) {
-                        printf("Enter timeout interval (ms) (Default: 1000): ");
+                        prompt(appState, "Enter timeout interval (ms) (Default: 1000): ");
 
                         while (appState->connectionSettings.timeoutInterval.count() == 0) {
-                            getline(cin, input);
+                            readInput(appState, input);
 
                             if (input.empty()) {
                                 appState->connectionSettings.timeoutInterval = chrono::milliseconds(1000);
@@ -477,11 +729,11 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
                 }
             }
         } else {
-            printf("Enter connection TTL (ms) (Default: 5000): ");
+            prompt(appState, "Enter connection TTL (ms) (Default: 5000): ");
 
             while (appState->connectionSettings.timeoutInterval.count() == 0) {
                 try {
-                    getline(cin, input);
+                    readInput(appState, input);
                     if (input.empty()) {
                         appState->connectionSettings.timeoutInterval = chrono::seconds(5);
                         break;
@@ -503,11 +755,11 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
     }
 
     input.clear();
-    if (appState->connectionSettings.wSize == 0 && appState->connectionSettings.protocol != GBN) {
-        printf("Enter the window size (Default: 8, Max: 512): ");
+    if (appState->connectionSettings.wSize == 0) {
+        prompt(appState, "Enter the window size (Default: 8, Max: %d): ", MAX_WINDOW_SIZE);
 
         while (appState->connectionSettings.wSize == 0) {
-            getline(cin, input);
+            readInput(appState, input);
 
             if (input.empty()) {
                 appState->connectionSettings.wSize = 8;
@@ -517,29 +769,27 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
             try {
                 tmp = stoi(input);
 
-                if (tmp > 0 && tmp < 513) {
+                if (tmp > 0 && tmp <= MAX_WINDOW_SIZE) {
                     appState->connectionSettings.wSize = tmp;
                 } else {
-                    printf("Invalid value entered. Enter a value from 1 to 512\n");
+                    printf("Invalid value entered. Enter a value from 1 to %d\n", MAX_WINDOW_SIZE);
                 }
             } catch (invalid_argument &e) {
-                printf("Invalid value entered. Enter a value from 1 to 512\n");
+                printf("Invalid value entered. Enter a value from 1 to %d\n", MAX_WINDOW_SIZE);
             }
         }
-    } else if (appState->connectionSettings.protocol == GBN) {
-        appState->connectionSettings.wSize = 1;
     }
 
     input.clear();
     if (appState->connectionSettings.sqnRange == 0) {
-        printf("Enter the number of bits to be used for the sequence number (Default: 8, Max: 32): ");
+        prompt(appState, "Enter the number of bits to be used for the sequence number (Default: 8, Max: 32): ");
 
         while (appState->connectionSettings.sqnRange == 0) {
-            getline(cin, input);
+            readInput(appState, input);
 
             if (input.empty()) {
                 appState->connectionSettings.sqnBits = 8;
-                appState->connectionSettings.sqnRange = (1 << appState->connectionSettings.sqnBits);
+                appState->connectionSettings.sqnRange = (1ULL << appState->connectionSettings.sqnBits);
                 break;
             }
 
@@ -547,13 +797,7 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
                 tmp = stoi(input);
 
                 if (tmp > 0 && tmp < 33) {
-                    if (tmp == 32) {
-                        // assigning an unsigned int to -1 results in it containing its maximum value
-                        appState->connectionSettings.sqnRange = -1;
-                    } else {
-                        appState->connectionSettings.sqnRange = (1 << tmp);
-                    }
-
+                    appState->connectionSettings.sqnRange = (1ULL << tmp);
                     appState->connectionSettings.sqnBits = tmp;
                 } else {
                     printf("Invalid value entered. Enter a value between 0 and 33\n");
@@ -566,8 +810,15 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
 
     input.clear();
     while (true) {
-        printf("Enable damaged packets (y/n) (Default: n)? ");
-        getline(cin, input);
+        // Errors asked for on the command line are enabled without asking
+        if (!appState->interactive) {
+            ConnectionSettings &settings = appState->connectionSettings;
+            enableDamage = settings.damageProb != -1 || settings.lostProb != -1 || !settings.damagedPackets.empty() || !settings.lostPackets.empty();
+            break;
+        }
+
+        prompt(appState, "Enable damaged packets (y/n) (Default: n)? ");
+        readInput(appState, input);
 
         if (input.empty() || input.compare("n") == 0) {
             enableDamage = false;
@@ -582,9 +833,9 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
 
     if (enableDamage) {
         input.clear();
-        printf("Enter packet damage probability (Default: 0, MAX: 1): ");
+        prompt(appState, "Enter packet damage probability (Default: 0, MAX: 1): ");
         while (appState->connectionSettings.damageProb == -1) {
-            getline(cin, input);
+            readInput(appState, input);
 
             if (input.empty()) {
                 appState->connectionSettings.damageProb = 0;
@@ -604,9 +855,9 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
         }
 
         input.clear();
-        printf("Enter lost package probability (Default: 0, MAX: 1): ");
+        prompt(appState, "Enter lost package probability (Default: 0, MAX: 1): ");
         while (appState->connectionSettings.lostProb == -1) {
-            getline(cin, input);
+            readInput(appState, input);
 
             if (input.empty()) {
                 appState->connectionSettings.lostProb = 0;
@@ -626,9 +877,9 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
         }
 
         input.clear();
-        printf("Enter a comma-separated sequence of damaged packets (Default: None): ");
+        prompt(appState, "Enter a comma-separated sequence of damaged packets (Default: None): ");
         while (appState->connectionSettings.damagedPackets.empty()) {
-            getline(cin, input);
+            readInput(appState, input);
 
             if (input.empty()) {
                 break;
@@ -640,9 +891,9 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
         }
 
         input.clear();
-        printf("Enter a comma-separated sequence of lost packages (Default: None): ");
+        prompt(appState, "Enter a comma-separated sequence of lost packages (Default: None): ");
         while (appState->connectionSettings.lostPackets.empty()) {
-            getline(cin, input);
+            readInput(appState, input);
 
             if (input.empty()) {
                 break;
@@ -658,7 +909,10 @@ void InputHelper::promptForParameters(ApplicationState *appState) {
     }
 
     // TODO: Should be per-connection, not for all connections
-    if (appState->connectionSettings.pingCalculatedTimeout) {
+    if (appState->connectionSettings.pingCalculatedTimeout && appState->connectionSettings.fastStart) {
+        // The handshake times the SYN-ACK instead
+        appState->connectionSettings.timeoutInterval = chrono::seconds(INITIAL_TIMEOUT_SECONDS);
+    } else if (appState->connectionSettings.pingCalculatedTimeout) {
         chrono::microseconds timeout;
         ConnectionController connectionController(*appState);
         printf("Performing ping test. Please wait...\n");
@@ -742,6 +996,38 @@ int InputHelper::parseIPAddresses(string *seq, vector<string> *ipAddresses) {
     return 0;
 }
 
+uint64_t InputHelper::parseSize(const string &size) {
+    uint64_t bytes = stoull(size);
+    switch (size.back()) {
+        case 'G': case 'g': bytes <<= 10; // fallthrough
+        case 'M': case 'm': bytes <<= 10; // fallthrough
+        case 'K': case 'k': bytes <<= 10; // fallthrough
+        default: break;
+    }
+
+    return bytes;
+}
+
 string InputHelper::getFileName(string *filepath) {
     return filepath->substr(filepath->find_last_of('/') + 1, filepath->length());
 }
+
+// Asks for a setting; without prompting, nothing is printed as its default is taken without asking
+void InputHelper::prompt(ApplicationState *appState, const char *format, ...) {
+    if (!appState->interactive) return;
+
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+// Reads the answer to a prompt; without prompting, every answer is empty so the default is taken
+void InputHelper::readInput(ApplicationState *appState, string &input) {
+    if (!appState->interactive) {
+        input.clear();
+        return;
+    }
+
+    getline(cin, input);
+}
@@ -19,6 +19,13 @@ public:
     static int parseIPAddresses(string *seq, vector<string> *ipAddresses);
 
     static string getFileName(string *filepath);
+
+    // A size such as 512K, 4M or 1G, in bytes
+    static uint64_t parseSize(const string &size);
+
+    static void prompt(ApplicationState *appState, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    static void readInput(ApplicationState *appState, string &input);
 };
 
 
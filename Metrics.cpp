@@ -0,0 +1,387 @@
+//
+// Created on 10/19/26.
+//
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <cmath>
+#include <new>
+
+#include "Metrics.h"
+
+#define METRICS_READ_TIMEOUT_MS 100 // how long a socket client is given to send its request before it's answered anyway
+
+static atomic<unsigned int> nextShard(0);
+
+Counter::Counter() {
+    void *memory = NULL;
+    if (posix_memalign(&memory, alignof(Slot), sizeof(Slot) * METRICS_SHARDS) != 0) throw bad_alloc();
+
+    slots = (Slot *) memory;
+    for (int i = 0; i < METRICS_SHARDS; i++) new (&slots[i]) Slot();
+}
+
+Counter::~Counter() {
+    free(slots);
+}
+
+void Counter::add(uint64_t amount) {
+    // Threads take the slots in turn as they first add to a counter
+    static thread_local unsigned int shard = nextShard.fetch_add(1, memory_order_relaxed) % METRICS_SHARDS;
+    slots[shard].value.fetch_add(amount, memory_order_relaxed);
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (int i = 0; i < METRICS_SHARDS; i++) total += slots[i].value.load(memory_order_relaxed);
+
+    return total;
+}
+
+Histogram::Histogram() {
+    for (atomic<uint64_t> &bucket : buckets) bucket.store(0, memory_order_relaxed);
+}
+
+unsigned int Histogram::bucketOf(uint64_t value) {
+    if (value < (1u << HISTOGRAM_SUB_BITS)) return (unsigned int) value;
+
+    // The power of two picks the row and the bits below the leading one pick the bucket within it
+    unsigned int exponent = 63 - __builtin_clzll(value);
+    unsigned int sub = (unsigned int) (value >> (exponent - HISTOGRAM_SUB_BITS)) & ((1u << HISTOGRAM_SUB_BITS) - 1);
+
+    return ((exponent - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) + sub;
+}
+
+uint64_t Histogram::upperBound(unsigned int bucket) {
+    if (bucket < (1u << HISTOGRAM_SUB_BITS)) return bucket;
+
+    unsigned int exponent = (bucket >> HISTOGRAM_SUB_BITS) + HISTOGRAM_SUB_BITS - 1;
+    uint64_t sub = bucket & ((1u << HISTOGRAM_SUB_BITS) - 1);
+    uint64_t width = 1ULL << (exponent - HISTOGRAM_SUB_BITS);
+
+    return (1ULL << exponent) + sub * width + (width - 1);
+}
+
+void Histogram::record(uint64_t value) {
+    buckets[bucketOf(value)].fetch_add(1, memory_order_relaxed);
+    total.fetch_add(1, memory_order_relaxed);
+    sum.fetch_add(value, memory_order_relaxed);
+
+    uint64_t seen = largest.load(memory_order_relaxed);
+    while (value > seen && !largest.compare_exchange_weak(seen, value, memory_order_relaxed));
+}
+
+void Histogram::merge(const Histogram &other) {
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        uint64_t count = other.buckets[i].load(memory_order_relaxed);
+        if (count != 0) buckets[i].fetch_add(count, memory_order_relaxed);
+    }
+    total.fetch_add(other.count(), memory_order_relaxed);
+    sum.fetch_add(other.valueSum(), memory_order_relaxed);
+
+    uint64_t value = other.max(), seen = largest.load(memory_order_relaxed);
+    while (value > seen && !largest.compare_exchange_weak(seen, value, memory_order_relaxed));
+}
+
+uint64_t Histogram::quantile(double share) const {
+    uint64_t recorded = count();
+    if (recorded == 0) return 0;
+
+    uint64_t rank = std::max((uint64_t) 1, (uint64_t) ceil(share * recorded)), seen = 0;
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += buckets[i].load(memory_order_relaxed);
+        if (seen >= rank) return min(upperBound(i), max());
+    }
+
+    return max();
+}
+
+void ConnectionMetrics::merge(const ConnectionMetrics &other) {
+    pktsSent.add(other.pktsSent.value());
+    pktsReceived.add(other.pktsReceived.value());
+    retransmits.add(other.retransmits.value());
+    rtoFirings.add(other.rtoFirings.value());
+    damagedPkts.add(other.damagedPkts.value());
+    bytesSent.add(other.bytesSent.value());
+    bytesReceived.add(other.bytesReceived.value());
+    payloadBytes.add(other.payloadBytes.value());
+    resentPayloadBytes.add(other.resentPayloadBytes.value());
+    ackLatencyUs.merge(other.ackLatencyUs);
+}
+
+MetricsRegistry::MetricsRegistry() {
+    finished.label = "finished";
+}
+
+void MetricsRegistry::attach(const shared_ptr<ConnectionMetrics> &metrics, const string &label) {
+    lock_guard<mutex> guard(lock);
+    metrics->label = label;
+    metrics->opened = chrono::steady_clock::now();
+    live.push_back(metrics);
+    opened++;
+}
+
+void MetricsRegistry::detach(const shared_ptr<ConnectionMetrics> &metrics) {
+    lock_guard<mutex> guard(lock);
+    auto it = find(live.begin(), live.end(), metrics);
+    if (it == live.end()) return;
+
+    finished.merge(*metrics);
+    live.erase(it);
+}
+
+void MetricsRegistry::total(ConnectionMetrics &into) const {
+    lock_guard<mutex> guard(lock);
+    int64_t windowOccupancy = 0, timeoutQueueDepth = 0, parityQueueDepth = 0;
+
+    into.merge(finished);
+    for (const shared_ptr<ConnectionMetrics> &metrics : live) {
+        into.merge(*metrics);
+        windowOccupancy += metrics->windowOccupancy.value();
+        timeoutQueueDepth += metrics->timeoutQueueDepth.value();
+        parityQueueDepth += metrics->parityQueueDepth.value();
+    }
+
+    into.windowOccupancy.set(windowOccupancy);
+    into.timeoutQueueDepth.set(timeoutQueueDepth);
+    into.parityQueueDepth.set(parityQueueDepth);
+}
+
+string MetricsRegistry::statsText() const {
+    lock_guard<mutex> guard(lock);
+    string text;
+    char line[512];
+
+    snprintf(line, sizeof(line), "Connections opened: %lu, live: %lu\n", opened, live.size());
+    text += line;
+
+    vector<const ConnectionMetrics *> all;
+    for (const shared_ptr<ConnectionMetrics> &metrics : live) all.push_back(metrics.get());
+    all.push_back(&finished);
+
+    auto now = chrono::steady_clock::now();
+    for (const ConnectionMetrics *metrics : all) {
+        bool isLive = metrics != &finished;
+        uint64_t sent = metrics->pktsSent.value(), received = metrics->pktsReceived.value();
+        uint64_t packets = sent > 0 ? sent : received;
+        const Histogram &latency = metrics->ackLatencyUs;
+
+        if (isLive) {
+            snprintf(line, sizeof(line), "\n%s (open %.1f s)\n", metrics->label.c_str(), chrono::duration<double>(now - metrics->opened).count());
+        } else {
+            snprintf(line, sizeof(line), "\nFinished connections\n");
+        }
+        text += line;
+
+        snprintf(line, sizeof(line), "  Packets sent: %lu, received: %lu, retransmitted: %lu (%.2f%%), damaged: %lu, RTOs fired: %lu\n",
+                 sent, received, metrics->retransmits.value(), packets > 0 ? 100.0 * metrics->retransmits.value() / packets : 0.0,
+                 metrics->damagedPkts.value(), metrics->rtoFirings.value());
+        text += line;
+
+        snprintf(line, sizeof(line), "  Bytes sent: %lu, received: %lu, payload: %lu (resent: %lu)\n", metrics->bytesSent.value(),
+                 metrics->bytesReceived.value(), metrics->payloadBytes.value(), metrics->resentPayloadBytes.value());
+        text += line;
+
+        if (isLive) {
+            snprintf(line, sizeof(line), "  Window occupancy: %ld, timeout queue: %ld, parity queue: %ld\n", metrics->windowOccupancy.value(),
+                     metrics->timeoutQueueDepth.value(), metrics->parityQueueDepth.value());
+            text += line;
+        }
+
+        if (latency.count() > 0) {
+            snprintf(line, sizeof(line), "  ACK latency (us): count %lu, mean %lu, p50 %lu, p90 %lu, p99 %lu, p99.9 %lu, max %lu\n",
+                     latency.count(), latency.valueSum() / latency.count(), latency.quantile(0.5), latency.quantile(0.9),
+                     latency.quantile(0.99), latency.quantile(0.999), latency.max());
+            text += line;
+        }
+    }
+
+    return text;
+}
+
+string MetricsRegistry::prometheusText() const {
+    lock_guard<mutex> guard(lock);
+    string text;
+    char line[512];
+
+    vector<const ConnectionMetrics *> all;
+    for (const shared_ptr<ConnectionMetrics> &metrics : live) all.push_back(metrics.get());
+    all.push_back(&finished);
+
+    auto family = [&text](const char *name, const char *type, const char *help) {
+        text += string("# HELP ") + name + " " + help + "\n# TYPE " + name + " " + type + "\n";
+    };
+    auto counter = [&](const char *name, const char *help, const Counter ConnectionMetrics::*member) {
+        family(name, "counter", help);
+        for (const ConnectionMetrics *metrics : all) {
+            snprintf(line, sizeof(line), "%s{connection=\"%s\"} %lu\n", name, metrics->label.c_str(), (metrics->*member).value());
+            text += line;
+        }
+    };
+    auto gauge = [&](const char *name, const char *help, const Gauge ConnectionMetrics::*member) {
+        family(name, "gauge", help);
+        for (const ConnectionMetrics *metrics : all) {
+            if (metrics == &finished) continue;
+            snprintf(line, sizeof(line), "%s{connection=\"%s\"} %ld\n", name, metrics->label.c_str(), (metrics->*member).value());
+            text += line;
+        }
+    };
+
+    family("sliding_window_connections_opened_total", "counter", "Connections made or accepted since the process started.");
+    snprintf(line, sizeof(line), "sliding_window_connections_opened_total %lu\n", opened);
+    text += line;
+    family("sliding_window_connections_live", "gauge", "Connections currently open.");
+    snprintf(line, sizeof(line), "sliding_window_connections_live %lu\n", live.size());
+    text += line;
+
+    counter("sliding_window_packets_sent_total", "Data packets sent, resends included.", &ConnectionMetrics::pktsSent);
+    counter("sliding_window_packets_received_total", "Data packets received, resends and damaged ones included.", &ConnectionMetrics::pktsReceived);
+    counter("sliding_window_retransmits_total", "Data packets resent (client) or received again or damaged (server).", &ConnectionMetrics::retransmits);
+    counter("sliding_window_rto_firings_total", "Retransmission timeouts that went off.", &ConnectionMetrics::rtoFirings);
+    counter("sliding_window_damaged_packets_total", "Packets received that failed their checksum.", &ConnectionMetrics::damagedPkts);
+    counter("sliding_window_bytes_sent_total", "Bytes written to the socket, headers included.", &ConnectionMetrics::bytesSent);
+    counter("sliding_window_bytes_received_total", "Bytes read from the socket, headers included.", &ConnectionMetrics::bytesReceived);
+    counter("sliding_window_payload_bytes_total", "Payload of data packets sent (client) or received intact (server).", &ConnectionMetrics::payloadBytes);
+    counter("sliding_window_resent_payload_bytes_total", "Payload of data packets resent.", &ConnectionMetrics::resentPayloadBytes);
+    gauge("sliding_window_window_occupancy", "Packets sent and not yet ACK'd (client) or buffered out of order (server).", &ConnectionMetrics::windowOccupancy);
+    gauge("sliding_window_timeout_queue_depth", "Packets waiting to time out.", &ConnectionMetrics::timeoutQueueDepth);
+    gauge("sliding_window_parity_queue_depth", "FEC parity packets waiting on the last packet of their block.", &ConnectionMetrics::parityQueueDepth);
+
+    family("sliding_window_ack_latency_microseconds", "summary", "Time from a packet being sent to its ACK arriving.");
+    for (const ConnectionMetrics *metrics : all) {
+        const Histogram &latency = metrics->ackLatencyUs;
+        for (double share : {0.5, 0.9, 0.99, 0.999}) {
+            snprintf(line, sizeof(line), "sliding_window_ack_latency_microseconds{connection=\"%s\",quantile=\"%g\"} %lu\n",
+                     metrics->label.c_str(), share, latency.quantile(share));
+            text += line;
+        }
+        snprintf(line, sizeof(line), "sliding_window_ack_latency_microseconds_sum{connection=\"%s\"} %lu\n"
+                                     "sliding_window_ack_latency_microseconds_count{connection=\"%s\"} %lu\n",
+                 metrics->label.c_str(), latency.valueSum(), metrics->label.c_str(), latency.count());
+        text += line;
+    }
+
+    return text;
+}
+
+MetricsExporter::MetricsExporter(MetricsRegistry &registry, const string &statsPath, const string &socketPath)
+        : registry(registry), statsPath(statsPath), socketPath(socketPath) {
+    if (!socketPath.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            fprintf(stderr, "Metrics socket path is too long; not serving metrics\n");
+        } else {
+            strcpy(address.sun_path, socketPath.c_str());
+            unlink(socketPath.c_str()); // left behind by an earlier run
+
+            listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listenFd < 0 || bind(listenFd, (struct sockaddr *) &address, sizeof(address)) < 0 || listen(listenFd, 4) < 0) {
+                fprintf(stderr, "Unable to listen on the metrics socket %s; not serving metrics\nError #: %d\n", socketPath.c_str(), errno);
+                if (listenFd >= 0) close(listenFd);
+                listenFd = -1;
+            }
+        }
+    }
+
+    if (pipe(wakeFds) < 0) {
+        fprintf(stderr, "Unable to start exporting metrics\nError #: %d\n", errno);
+        return;
+    }
+
+    worker = thread(&MetricsExporter::run, this);
+}
+
+MetricsExporter::~MetricsExporter() {
+    if (worker.joinable()) {
+        char wake = 0;
+        if (write(wakeFds[1], &wake, 1) < 0) fprintf(stderr, "Unable to stop the metrics exporter\n");
+        worker.join();
+    }
+
+    if (wakeFds[0] >= 0) close(wakeFds[0]);
+    if (wakeFds[1] >= 0) close(wakeFds[1]);
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+
+    writeStats();
+}
+
+void MetricsExporter::run() {
+    auto nextWrite = chrono::steady_clock::now();
+
+    while (true) {
+        int timeoutMs = -1;
+        if (!statsPath.empty()) {
+            auto now = chrono::steady_clock::now();
+            if (now >= nextWrite) {
+                writeStats();
+                nextWrite = now + chrono::milliseconds(STATS_INTERVAL_MS);
+            }
+            timeoutMs = (int) chrono::duration_cast<chrono::milliseconds>(nextWrite - now).count();
+        }
+
+        pollfd fds[2] = {{wakeFds[0], POLLIN, 0}, {listenFd, POLLIN, 0}};
+        if (poll(fds, listenFd >= 0 ? 2 : 1, timeoutMs) < 0 && errno != EINTR) {
+            fprintf(stderr, "Metrics exporter stopped\nError #: %d\n", errno);
+            return;
+        }
+
+        if (fds[0].revents != 0) return;
+        if (listenFd >= 0 && (fds[1].revents & POLLIN) != 0) {
+            int clientFd = accept(listenFd, NULL, NULL);
+            if (clientFd >= 0) serve(clientFd);
+        }
+    }
+}
+
+void MetricsExporter::serve(int clientFd) {
+    // Plain text for anything that just connects and reads (socat, nc -U); an HTTP response for a scraper's GET
+    timeval readTimeout{0, METRICS_READ_TIMEOUT_MS * 1000};
+    setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &readTimeout, sizeof(readTimeout));
+
+    char request[1024];
+    ssize_t requestLength = recv(clientFd, request, sizeof(request), 0);
+    string body = registry.prometheusText(), response;
+    if (requestLength >= 3 && strncmp(request, "GET", 3) == 0) {
+        response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + to_string(body.size()) + "\r\n\r\n";
+    }
+    response += body;
+
+    for (size_t written = 0; written < response.size();) {
+        ssize_t sent = send(clientFd, response.data() + written, response.size() - written, MSG_NOSIGNAL);
+        if (sent <= 0) break;
+        written += sent;
+    }
+
+    close(clientFd);
+}
+
+void MetricsExporter::writeStats() {
+    if (statsPath.empty()) return;
+    lock_guard<mutex> guard(statsLock);
+
+    // Written beside the file and renamed over it, so readers never see it half written
+    string text = registry.statsText(), partPath = statsPath + ".part";
+    FILE *stats = fopen(partPath.c_str(), "w");
+    if (stats == NULL) {
+        fprintf(stderr, "Unable to write the stats file %s\nError #: %d\n", partPath.c_str(), errno);
+        return;
+    }
+
+    fwrite(text.data(), sizeof(char), text.size(), stats);
+    fclose(stats);
+    if (rename(partPath.c_str(), statsPath.c_str()) != 0) {
+        fprintf(stderr, "Unable to replace the stats file %s\nError #: %d\n", statsPath.c_str(), errno);
+    }
+}
@@ -0,0 +1,164 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_METRICS_H
+#define SLIDING_WINDOW_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define METRICS_SHARDS 16 // slots a counter is spread over so threads adding to it rarely share a cache line
+#define HISTOGRAM_SUB_BITS 4 // each power of two is split into 2^4 buckets, so values are kept to within 1/16
+#define HISTOGRAM_BUCKETS (64 << HISTOGRAM_SUB_BITS)
+#define STATS_INTERVAL_MS 1000 // how often the stats file is rewritten
+
+using namespace std;
+
+// Monotonic count. Each thread adds to a slot of its own, and reading sums the slots
+class Counter {
+    struct alignas(64) Slot {
+        atomic<uint64_t> value{0};
+    };
+
+    // Allocated apart from the counter, as nothing in C++11 aligns an over-aligned member of a heap object
+    Slot *slots;
+
+public:
+    Counter();
+    ~Counter();
+
+    Counter(const Counter &) = delete;
+    Counter &operator=(const Counter &) = delete;
+
+    void add(uint64_t amount = 1);
+    uint64_t value() const;
+};
+
+// Level of something that rises and falls, such as a queue's depth
+class Gauge {
+    atomic<int64_t> current{0};
+
+public:
+    void set(int64_t value) {
+        current.store(value, memory_order_relaxed);
+    }
+
+    int64_t value() const {
+        return current.load(memory_order_relaxed);
+    }
+};
+
+/* HDR-style histogram: values below 16 get a bucket each and every power of two above is split into 16 buckets, so any
+ * value from 0 to 2^64 is recorded in constant time and space and read back to within about 6%.
+ */
+class Histogram {
+    atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+    atomic<uint64_t> total{0};
+    atomic<uint64_t> sum{0};
+    atomic<uint64_t> largest{0};
+
+    static unsigned int bucketOf(uint64_t value);
+    static uint64_t upperBound(unsigned int bucket);
+
+public:
+    Histogram();
+
+    void record(uint64_t value);
+    void merge(const Histogram &other);
+
+    uint64_t count() const {
+        return total.load(memory_order_relaxed);
+    }
+
+    uint64_t valueSum() const {
+        return sum.load(memory_order_relaxed);
+    }
+
+    uint64_t max() const {
+        return largest.load(memory_order_relaxed);
+    }
+
+    // Smallest recorded value at or above the given share (0 to 1) of all of them; 0 if none were recorded
+    uint64_t quantile(double share) const;
+};
+
+// Everything measured about one connection. The thread running the connection writes it while the exporter reads it
+struct ConnectionMetrics {
+    string label; // the peer's address and port
+    chrono::time_point<chrono::steady_clock> opened = chrono::steady_clock::now();
+
+    Counter pktsSent; // data packets, resends included
+    Counter pktsReceived; // data packets, resends and damaged ones included
+    Counter retransmits; // data packets resent (client) / received again or damaged (server)
+    Counter rtoFirings; // retransmission timeouts that went off
+    Counter damagedPkts; // packets received that failed their checksum
+    Counter bytesSent; // everything written to the socket, headers included
+    Counter bytesReceived;
+    Counter payloadBytes; // payload of the data packets sent (client) / received intact (server), resends included
+    Counter resentPayloadBytes; // of which were resends
+    Gauge windowOccupancy; // packets sent and not yet ACK'd (client) / buffered out of order (server)
+    Gauge timeoutQueueDepth; // packets waiting to time out (client only)
+    Gauge parityQueueDepth; // FEC parity waiting on its block (client only)
+    Histogram ackLatencyUs; // from a packet being sent to its ACK arriving; resent packets aren't timed
+
+    void merge(const ConnectionMetrics &other);
+};
+
+// The metrics of every connection, live and finished. Only adding and removing connections takes the lock
+class MetricsRegistry {
+    mutable mutex lock;
+    vector<shared_ptr<ConnectionMetrics>> live;
+    ConnectionMetrics finished; // counters of connections since closed, folded together
+    uint64_t opened = 0;
+
+public:
+    MetricsRegistry();
+
+    void attach(const shared_ptr<ConnectionMetrics> &metrics, const string &label);
+    void detach(const shared_ptr<ConnectionMetrics> &metrics);
+
+    // Adds up every connection, live and finished, into the given metrics; gauges are summed over the live ones
+    void total(ConnectionMetrics &into) const;
+
+    // Human readable summary of each connection
+    string statsText() const;
+
+    // Prometheus text exposition format
+    string prometheusText() const;
+};
+
+/* Publishes a registry while connections run: rewrites a stats file every STATS_INTERVAL_MS and/or answers each
+ * connection to a Unix socket with the Prometheus text (as an HTTP response if it sent a GET), from a thread of its own.
+ */
+class MetricsExporter {
+    MetricsRegistry &registry;
+    string statsPath;
+    string socketPath;
+    int listenFd = -1;
+    int wakeFds[2] = {-1, -1}; // written to on shutdown to wake the thread from poll()
+    mutex statsLock; // the stats file is rewritten from the exporter's thread and by writeStats
+    thread worker;
+
+    void run();
+    void serve(int clientFd);
+
+public:
+    MetricsExporter(MetricsRegistry &registry, const string &statsPath, const string &socketPath);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter &) = delete;
+    MetricsExporter &operator=(const MetricsExporter &) = delete;
+
+    // Rewrite the stats file now
+    void writeStats();
+};
+
+
+#endif //SLIDING_WINDOW_METRICS_H
@@ -0,0 +1,103 @@
+//
+// Created on 10/19/26.
+//
+
+#include <algorithm>
+
+#include "Clock.h"
+#include "Pacer.h"
+
+#define PACING_GAIN 1.25
+#define SLOW_START_PACING_GAIN 2.0
+#define PACING_QUANTUM_US 100 // Waits shorter than this are let through as part of a small burst
+#define BURST_MS 10 // Token bucket depth in milliseconds of the configured rate
+#define MIN_BURST_PKTS 2
+
+TokenBucket Pacer::processBucket;
+mutex Pacer::processBucketLock;
+
+void TokenBucket::configure(double rate, double burst) {
+    this->rate = rate;
+    this->burst = burst;
+    this->tokens = burst;
+    this->lastRefill = Clock::steadyNow();
+}
+
+void TokenBucket::refill(chrono::time_point<chrono::steady_clock> now) {
+    if (rate <= 0) return;
+
+    tokens = min(burst, tokens + rate * chrono::duration<double>(now - lastRefill).count());
+    lastRefill = now;
+}
+
+chrono::microseconds TokenBucket::delay(unsigned int bytes, chrono::time_point<chrono::steady_clock> now) {
+    if (rate <= 0) return chrono::microseconds(0);
+
+    refill(now);
+    if (tokens >= bytes) return chrono::microseconds(0);
+
+    return chrono::microseconds((long) ((bytes - tokens) / rate * 1000000) + 1);
+}
+
+void TokenBucket::consume(unsigned int bytes) {
+    if (rate > 0) tokens -= bytes;
+}
+
+// Rates are given in Mbps; the bucket always holds at least a couple of packets so full-size packets can pass
+static double bucketDepth(double bytesPerSec, unsigned int pktSizeBytes) {
+    return max(bytesPerSec * BURST_MS / 1000, (double) MIN_BURST_PKTS * pktSizeBytes);
+}
+
+Pacer::Pacer(bool pacing, double rateMbps, unsigned int pktSizeBytes) {
+    this->pacing = pacing;
+    this->pktSizeBytes = pktSizeBytes;
+
+    if (rateMbps > 0) {
+        double bytesPerSec = rateMbps * 1000000 / 8;
+        connectionBucket.configure(bytesPerSec, bucketDepth(bytesPerSec, pktSizeBytes));
+    }
+}
+
+void Pacer::setProcessRate(double rateMbps, unsigned int pktSizeBytes) {
+    lock_guard<mutex> lock(processBucketLock);
+
+    if (rateMbps > 0) {
+        double bytesPerSec = rateMbps * 1000000 / 8;
+        processBucket.configure(bytesPerSec, bucketDepth(bytesPerSec, pktSizeBytes));
+    } else {
+        processBucket.configure(0, 0);
+    }
+}
+
+chrono::microseconds Pacer::delay(unsigned int bytes) {
+    auto now = Clock::steadyNow();
+    chrono::microseconds wait(0);
+
+    if (pacing && nextSend > now) {
+        wait = chrono::duration_cast<chrono::microseconds>(nextSend - now);
+        if (wait.count() < PACING_QUANTUM_US) wait = chrono::microseconds(0);
+    }
+
+    wait = max(wait, connectionBucket.delay(bytes, now));
+
+    lock_guard<mutex> lock(processBucketLock);
+    return max(wait, processBucket.delay(bytes, now));
+}
+
+void Pacer::onSend(unsigned int bytes, chrono::microseconds srtt, unsigned int window, bool slowStart) {
+    auto now = Clock::steadyNow();
+
+    if (pacing && srtt.count() > 0 && window > 0) {
+        double gain = slowStart ? SLOW_START_PACING_GAIN : PACING_GAIN;
+        double share = pktSizeBytes > 0 ? min(1.0, (double) bytes / pktSizeBytes) : 1.0;
+        auto interval = chrono::duration_cast<chrono::steady_clock::duration>(srtt * share / (window * gain));
+
+        // Don't let time spent idle turn into credit for a burst later on
+        nextSend = max(nextSend, now - chrono::microseconds(PACING_QUANTUM_US)) + interval;
+    }
+
+    connectionBucket.consume(bytes);
+
+    lock_guard<mutex> lock(processBucketLock);
+    processBucket.consume(bytes);
+}
@@ -0,0 +1,55 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_PACER_H
+#define SLIDING_WINDOW_PACER_H
+
+#include <chrono>
+#include <mutex>
+
+using namespace std;
+
+// Token bucket limiting the average send rate while permitting short bursts
+struct TokenBucket {
+    double rate = 0; // bytes per second; 0 means unlimited
+    double burst = 0; // bucket depth in bytes
+    double tokens = 0;
+    chrono::time_point<chrono::steady_clock> lastRefill{};
+
+    void configure(double rate, double burst);
+    void refill(chrono::time_point<chrono::steady_clock> now);
+    chrono::microseconds delay(unsigned int bytes, chrono::time_point<chrono::steady_clock> now);
+    void consume(unsigned int bytes);
+};
+
+/* Spreads the packets of a window evenly over the smoothed RTT rather than sending them back-to-back, and enforces the
+ * operator's rate caps for this connection (--rate) and for the whole process (--prate).
+ */
+class Pacer {
+    bool pacing = true;
+    unsigned int pktSizeBytes = 0;
+    chrono::time_point<chrono::steady_clock> nextSend{};
+    TokenBucket connectionBucket;
+
+    static TokenBucket processBucket;
+    static mutex processBucketLock;
+
+public:
+    Pacer() = default;
+    Pacer(bool pacing, double rateMbps, unsigned int pktSizeBytes);
+
+    // Cap shared by every connection in the process
+    static void setProcessRate(double rateMbps, unsigned int pktSizeBytes);
+
+    // Time remaining until a packet of the given size may be sent; zero if it may be sent now
+    chrono::microseconds delay(unsigned int bytes);
+
+    /* Record a packet being sent. The next packet is scheduled srtt / (window * gain) later, less in proportion for a
+     * packet smaller than a full one; a faster gain during slow start lets the window keep doubling every round trip.
+     */
+    void onSend(unsigned int bytes, chrono::microseconds srtt, unsigned int window, bool slowStart);
+};
+
+
+#endif //SLIDING_WINDOW_PACER_H
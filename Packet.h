@@ -5,42 +5,83 @@
 #ifndef SLIDING_WINDOW_PACKET_H
 #define SLIDING_WINDOW_PACKET_H
 
+#include <netinet/in.h>
+#include <cstdint>
+
 #include "boost/crc.hpp"
 
 using namespace std;
 
 struct Packet {
 
-    struct Header {
-        Header() {
-            this->flags = *new Flags{};
-        }
+    // Follows the header on the wire of SYN and ping packets only, so data packets and ACKs don't carry it. Checksummed
+    // or authenticated along with the header, and like it never encrypted
+    struct Handshake {
+        uint64_t transferId = 0; // Identifies the file being sent across connections - A non-zero ID asks to resume an interrupted transfer
+        uint64_t fileSize = 0; // Size of the file being sent
+        int64_t mtime = 0; // Modification time (ns) of the file being sent
+        unsigned int missingRanges = 0; // Number of ChunkRanges the server still needs - If ack is enabled, these start the payload
+        unsigned int signatures = 0; // Number of BlockSignatures of the server's existing copy - If ack and delta are enabled, these follow the missing ranges
+        unsigned char salt[16] = {}; // Sender's salt for the session keys - Only used if cipher is set
+    };
 
-        struct sockaddr_in srcAddr; // Packet source information (port, address)
-        struct sockaddr_in destAddr; // Packet destination information (port, address)
-        unsigned int sqn = 0; // Sequence number - If syn is enabled, the sequence number of the first data byte is this + 1. If ack is enabled, this is the ack number
+    struct Header {
+        struct sockaddr_in srcAddr{}; // Packet source information (port, address)
+        struct sockaddr_in destAddr{}; // Packet destination information (port, address)
+        unsigned int sqn = 0; // Sequence number (modulo 2^sqnBits) - If syn is enabled, the sequence number of the first data byte is this + 1. If ack is enabled, this is the ack number
         unsigned int sqnBits = 0; // Sequence range - If syn is enabled, this will be set to synchronize the sequence range
-        unsigned short wSize = 0; // Window size - If syn is enabled, this will be set to synchronize the window size
-        unsigned int pktSize = 0; // Size of payload (in bytes) - If sync is enabled, this will be used synchronized packet size
-        int chksum; // Packet checksum
+        unsigned int wSize = 0; // Window size - If syn is enabled, this will be set to synchronize the window size
+        unsigned int pktSize = 0; // Size of payload (in bytes) - If sync is enabled, this will be used synchronized packet size. If compressed is enabled, this is the compressed size
+        unsigned int rawSize = 0; // Size of the payload once decompressed - Only used if compressed is enabled. If copy is enabled, the number of bytes to copy. If syn and ack are enabled, the size of the payload
+        unsigned int fileId = 0; // Which of the session's files this is part of - If syn is enabled and this is non-zero, the SYN is sequenced like data and starts the next file
+        uint64_t offset = 0; // Byte offset of the payload within the file
+        unsigned char protocol = 0; // Sliding window protocol - If syn is enabled, this will be set to synchronize the protocol
+        unsigned char compression = 0; // Payload codec - If syn is enabled, this negotiates compression
+        unsigned char fecData = 0; // Data packets per FEC block - If syn is enabled, this negotiates FEC (0 is off). If fec is enabled, the number of data packets in this block
+        unsigned char fecParity = 0; // Parity packets per FEC block - If syn is enabled, this negotiates FEC
+        unsigned char fecIndex = 0; // Which of the block's parity packets this is - Only used if fec is enabled
+        int chksum = 0; // Packet checksum - Always 0 if cipher is set
+        unsigned char cipher = 0; // CipherSuite the packet is sealed with - 0 sends it in the clear under chksum
+        uint64_t nonce = 0; // Number of the send among those sealed in this direction; never repeats - Only used if cipher is set
+        unsigned char tag[16] = {}; // Authenticates the header and payload - Only used if cipher is set
 
         struct Flags {
             char ack = 0; // Indicates this is an ack packet
             char syn = 0; // Indicates to synchronize sequence numbers
             char fin = 0; // Indicates this is the last packet of the transfer
             char ping = 0; // Indicates this packet is for establishing ping-based timeout and has no viable payload
+            char compressed = 0; // Indicates the payload is compressed
+            char delta = 0; // Indicates the client wants to send a delta against the server's existing copy (syn), or that its signatures follow (syn and ack)
+            char copy = 0; // Indicates rawSize bytes are copied from the server's existing copy, at the offset within it the (8 byte) payload gives
+            char fec = 0; // Indicates this is a parity packet for the FEC block whose first data packet is sqn; never ACK'd
+            char dedup = 0; // Indicates the client wants to send chunks only if the server's chunk store lacks them (syn), or that the server agrees (syn and ack)
+            char fast = 0; // Indicates the client's data follows its SYN without waiting for the SYN-ACK, so the server adopts the client's parameters
+            char manifest = 0; // Indicates the payload is ManifestEntries of the file's chunks, or (ack) a bit per entry set for each chunk the server needs
+            char batch = 0; // Indicates the file is a batch of small files and directories the server unpacks once it's received (syn)
+            char early = 0; // Indicates the packet is sealed under the client's early key, before the server's salt was known
         } flags;
+
+        // Bytes of Handshake following the header on the wire
+        unsigned int handshakeSize() const {
+            return (flags.syn == 1 || flags.ping == 1) ? sizeof(Handshake) : 0;
+        }
+
+        // Bytes following the handshake on the wire. A SYN-ACK's pktSize is the negotiated packet size, so its payload,
+        // the (16 byte) ChunkRanges missing from a resumed transfer and the (20 byte) BlockSignatures for a delta
+        // transfer, is sized by rawSize
+        unsigned int payloadSize() const {
+            if (flags.syn == 1 && flags.ack == 1) return rawSize;
+            return pktSize;
+        }
     } header;
 
+    Handshake handshake;
     char *payload = NULL;
-
-    Packet() {
-        this->header = *new Header{};
-    }
+    uint64_t sqn = 0; // Full 64-bit sequence number the header's sqn was wrapped from; never sent
 
     void initPayload() {
-        if (this->header.pktSize != 0) {
-            this->payload = new char[this->header.pktSize];
+        if (this->header.payloadSize() != 0) {
+            this->payload = new char[this->header.payloadSize()];
         }
     }
 };
@@ -2,6 +2,7 @@
 // Created by csather on 3/21/21.
 //
 #include <vector>
+#include <zlib.h>
 
 #include "PacketBuilder.h"
 
@@ -10,10 +11,20 @@ void PacketBuilder::initPayload() {
 }
 
 
-void PacketBuilder::setSqn(unsigned int sqn) {
+void PacketBuilder::setSqn(uint64_t sqn) {
    this->sqn = sqn;
 }
 
+void PacketBuilder::setOffset(uint64_t offset) {
+    this->offset = offset;
+}
+
+void PacketBuilder::setTransfer(uint64_t transferId, uint64_t fileSize, int64_t mtime) {
+    this->transferId = transferId;
+    this->fileSize = fileSize;
+    this->mtime = mtime;
+}
+
 void PacketBuilder::setSrcAddr(struct sockaddr_in srcAddr) {
     this->srcAddr = srcAddr;
 }
@@ -22,7 +33,7 @@ void PacketBuilder::setDestAddr(struct sockaddr_in destAddr) {
     this->destAddr = destAddr;
 }
 
-void PacketBuilder::setWSize(unsigned short wSize) {
+void PacketBuilder::setWSize(unsigned int wSize) {
     this->wSize = wSize;
 }
 
@@ -30,6 +41,31 @@ void PacketBuilder::setSqnBits(unsigned char bits) {
     this->sqnbits = bits;
 }
 
+void PacketBuilder::setProtocol(unsigned char protocol) {
+    this->protocol = protocol;
+}
+
+void PacketBuilder::setCompression(unsigned char codec) {
+    this->compression = codec;
+}
+
+void PacketBuilder::setRawSize(unsigned int rawSize) {
+    this->rawSize = rawSize;
+}
+
+void PacketBuilder::setFileId(unsigned int fileId) {
+    this->fileId = fileId;
+}
+
+void PacketBuilder::setFec(unsigned char dataPkts, unsigned char parityPkts) {
+    this->fecData = dataPkts;
+    this->fecParity = parityPkts;
+}
+
+void PacketBuilder::setFecIndex(unsigned char index) {
+    this->fecIndex = index;
+}
+
 void PacketBuilder::enableAckBit() {
     this->ack = true;
 }
@@ -46,11 +82,51 @@ void PacketBuilder::enablePingBit() {
     this->ping = true;
 }
 
+void PacketBuilder::enableFecBit() {
+    this->fec = true;
+}
+
+void PacketBuilder::enableCompressedBit() {
+    this->compressed = true;
+}
+
+void PacketBuilder::enableDeltaBit() {
+    this->delta = true;
+}
+
+void PacketBuilder::enableCopyBit() {
+    this->copy = true;
+}
+
+void PacketBuilder::enableDedupBit() {
+    this->dedup = true;
+}
+
+void PacketBuilder::enableManifestBit() {
+    this->manifest = true;
+}
+
+void PacketBuilder::enableFastBit() {
+    this->fast = true;
+}
+
+void PacketBuilder::enableBatchBit() {
+    this->batch = true;
+}
+
 void PacketBuilder::resetFlags() {
     this->ack = false;
     this->syn = false;
     this->fin = false;
     this->ping = false;
+    this->fec = false;
+    this->compressed = false;
+    this->delta = false;
+    this->copy = false;
+    this->dedup = false;
+    this->manifest = false;
+    this->fast = false;
+    this->batch = false;
 }
 
 void PacketBuilder::setPktSize(unsigned int pktSize) {
@@ -81,16 +157,16 @@ void PacketBuilder::setPayload(const char *buffer, int buffLen) {
     }
 }
 
+// The same CRC-32 as boost::crc_32_type, but zlib's computes it several bytes at a time rather than one
 int PacketBuilder::generateChksum(Packet *pkt) {
-    boost::crc_32_type chksum;
-
-    chksum.process_bytes(&pkt->header, sizeof(Packet::Header));
+    uLong chksum = crc32(0L, (const Bytef *) &pkt->header, sizeof(Packet::Header));
+    if (pkt->header.handshakeSize() != 0) chksum = crc32(chksum, (const Bytef *) &pkt->handshake, sizeof(Packet::Handshake));
 
     if (pkt->header.pktSize != 0 && pkt->header.flags.ping != 1 && (pkt->header.flags.syn != 1 && pkt->header.flags.ack !=1)) {
-        chksum.process_bytes(pkt->payload, pkt->header.pktSize);
+        chksum = crc32(chksum, (const Bytef *) pkt->payload, pkt->header.pktSize);
     }
 
-    return chksum.checksum();
+    return (int) chksum;
 }
 
 struct Packet PacketBuilder::buildPacket() {
@@ -98,20 +174,44 @@ struct Packet PacketBuilder::buildPacket() {
 
     pkt->header.srcAddr = srcAddr;
     pkt->header.destAddr = destAddr;
-    pkt->header.sqn = sqn;
+    // Only the low sqnBits of the sequence number go on the wire; the receiver unwraps it against its window
+    pkt->sqn = sqn;
+    pkt->header.sqn = (sqnbits == 0 || sqnbits >= 32) ? (unsigned int) sqn : (unsigned int) (sqn & ((1ULL << sqnbits) - 1));
     pkt->header.sqnBits = sqnbits;
     pkt->header.wSize = wSize;
     pkt->header.pktSize = pktSize;
+    pkt->header.offset = offset;
+    pkt->header.protocol = protocol;
+    pkt->header.compression = compression;
+    pkt->header.rawSize = (compressed || copy) ? rawSize : 0;
+    pkt->header.fileId = fileId;
+    pkt->header.fecData = fecData;
+    pkt->header.fecParity = fecParity;
+    pkt->header.fecIndex = fecIndex;
     pkt->header.chksum = 0;
 
     pkt->header.flags.ack = (ack ? 1 : 0);
     pkt->header.flags.syn = (syn ? 1 : 0);
     pkt->header.flags.fin = (fin ? 1 : 0);
     pkt->header.flags.ping = (ping ? 1 : 0);
+    pkt->header.flags.fec = (fec ? 1 : 0);
+    pkt->header.flags.compressed = (compressed ? 1 : 0);
+    pkt->header.flags.delta = (delta ? 1 : 0);
+    pkt->header.flags.copy = (copy ? 1 : 0);
+    pkt->header.flags.dedup = (dedup ? 1 : 0);
+    pkt->header.flags.manifest = (manifest ? 1 : 0);
+    pkt->header.flags.fast = (fast ? 1 : 0);
+    pkt->header.flags.batch = (batch ? 1 : 0);
+
+    if (syn) {
+        pkt->handshake.transferId = transferId;
+        pkt->handshake.fileSize = fileSize;
+        pkt->handshake.mtime = mtime;
+    }
 
     if (this->payload == NULL) initPayload(); // Initialize the builders payload
     pkt->initPayload(); // Initialize the packets payload
-    memcpy(pkt->payload, this->payload, this->pktSize);
+    memcpy(pkt->payload, this->payload, pkt->header.payloadSize());
     pkt->header.chksum = generateChksum(this->pkt);
 
     return *pkt;
@@ -13,22 +13,40 @@
 #include <netdb.h>
 
 #include "Packet.h"
-#include "boost/crc.hpp"
 
 using namespace std;
 
 class PacketBuilder {
     Packet* pkt;
-    unsigned int sqn = 0;
+    uint64_t sqn = 0;
+    uint64_t offset = 0;
+    uint64_t transferId = 0;
+    uint64_t fileSize = 0;
+    int64_t mtime = 0;
     struct sockaddr_in srcAddr {0,0,0,0};
     struct sockaddr_in destAddr {0,0,0,0};
-    unsigned short wSize = 0;
+    unsigned int wSize = 0;
     unsigned char sqnbits= 0;
+    unsigned char protocol = 0;
+    unsigned char fecData = 0;
+    unsigned char fecParity = 0;
+    unsigned char fecIndex = 0;
     int pktSize = 0;
+    unsigned int rawSize = 0;
+    unsigned int fileId = 0;
+    unsigned char compression = 0;
     bool ack = false;
     bool syn = false;
     bool fin = false;
     bool ping = false;
+    bool fec = false;
+    bool compressed = false;
+    bool delta = false;
+    bool copy = false;
+    bool dedup = false;
+    bool manifest = false;
+    bool fast = false;
+    bool batch = false;
     char *payload = NULL;
 
     void initPayload();
@@ -38,16 +56,32 @@ public:
 
     void setPktSize(unsigned int pktSize);
 
-    void setSqn(unsigned int sqn);
+    void setSqn(uint64_t sqn);
+
+    void setOffset(uint64_t offset);
+
+    void setTransfer(uint64_t transferId, uint64_t fileSize, int64_t mtime);
 
     void setSrcAddr(struct sockaddr_in srcAddr);
 
     void setDestAddr(struct sockaddr_in destAddr);
 
-    void setWSize(unsigned short wSize);
+    void setWSize(unsigned int wSize);
 
     void setSqnBits(unsigned char bits);
 
+    void setProtocol(unsigned char protocol);
+
+    void setCompression(unsigned char codec);
+
+    void setRawSize(unsigned int rawSize);
+
+    void setFileId(unsigned int fileId);
+
+    void setFec(unsigned char dataPkts, unsigned char parityPkts);
+
+    void setFecIndex(unsigned char index);
+
     void setPayload(const char *buffer, int buffLen = 0);
 
     void emptyPayload();
@@ -60,6 +94,22 @@ public:
 
     void enablePingBit();
 
+    void enableFecBit();
+
+    void enableCompressedBit();
+
+    void enableDeltaBit();
+
+    void enableCopyBit();
+
+    void enableDedupBit();
+
+    void enableManifestBit();
+
+    void enableFastBit();
+
+    void enableBatchBit();
+
     void resetFlags();
 
     struct Packet buildPacket();
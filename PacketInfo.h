@@ -9,8 +9,8 @@
 struct PacketInfo {
     struct Packet pkt;
     chrono::time_point<chrono::system_clock> timeout{};
+    chrono::time_point<chrono::system_clock> sent{}; // last time this packet was sent, used for RTT samples
     unsigned char count = 0; // tracks the number of times this packet was sent/acked
-    bool acked = false;
 };
 
 
@@ -0,0 +1,46 @@
+//
+// Created on 10/19/26.
+//
+
+#include <algorithm>
+
+#include "PacketSizer.h"
+#include "Packet.h"
+
+PacketSizer::PacketSizer(bool adaptive, unsigned int maxSize, unsigned int mss) {
+    this->adaptive = adaptive;
+    this->maxSize = maxSize;
+    this->mss = mss;
+    this->current = maxSize;
+}
+
+unsigned int PacketSizer::fit(uint64_t size) const {
+    size = min(max(size, (uint64_t) min((unsigned int) SIZER_MIN_PKT_SIZE, maxSize)), (uint64_t) maxSize);
+    if (size == maxSize || mss == 0) return (unsigned int) size;
+
+    // Header and payload together fill a whole number of segments, unless a packet doesn't even fill one
+    uint64_t segments = (size + sizeof(Packet::Header)) / mss;
+    if (segments > 0 && segments * mss > sizeof(Packet::Header)) size = segments * mss - sizeof(Packet::Header);
+
+    return (unsigned int) size;
+}
+
+bool PacketSizer::onSend() {
+    if (!adaptive || ++sent < SIZER_SAMPLE_PKTS) return false;
+
+    lossRate = (double) lost / sent;
+    sent = 0;
+    lost = 0;
+
+    // Scaled with the header, so packets that filled whole segments still do
+    unsigned int previous = current;
+    uint64_t packet = current + sizeof(Packet::Header);
+    if (lossRate >= SIZER_SHRINK_LOSS) current = fit(packet / 2 > sizeof(Packet::Header) ? packet / 2 - sizeof(Packet::Header) : 0);
+    else if (lossRate <= SIZER_GROW_LOSS) current = fit(packet * 2 - sizeof(Packet::Header));
+
+    return current != previous;
+}
+
+void PacketSizer::onLoss() {
+    if (adaptive) lost++;
+}
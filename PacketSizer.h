@@ -0,0 +1,48 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_PACKETSIZER_H
+#define SLIDING_WINDOW_PACKETSIZER_H
+
+#include <cstdint>
+
+#define SIZER_SAMPLE_PKTS 64 // new packets sent between size adjustments
+#define SIZER_SHRINK_LOSS 0.05 // loss rate over a sample at or above which packets are halved
+#define SIZER_GROW_LOSS 0.01 // loss rate over a sample at or below which packets are doubled
+#define SIZER_MIN_PKT_SIZE 1024 // smallest payload packets are shrunk to
+
+using namespace std;
+
+/* Payload size of the data packets a client sends. Adaptive sizing halves it while losses are frequent, so each one costs
+ * less to resend, and doubles it back towards the negotiated packet size while the link is clean, so less goes on headers.
+ * Sizes below the negotiated one are rounded to fill whole TCP segments of the path so none goes out part empty.
+ */
+class PacketSizer {
+    bool adaptive = false;
+    unsigned int maxSize = 0; // the negotiated packet size
+    unsigned int mss = 0; // the path's TCP maximum segment size; 0 if unknown
+    unsigned int current = 0;
+    uint64_t sent = 0, lost = 0;
+
+    unsigned int fit(uint64_t size) const;
+
+public:
+    double lossRate = 0; // over the last complete sample
+
+    PacketSizer() = default;
+    PacketSizer(bool adaptive, unsigned int maxSize, unsigned int mss);
+
+    unsigned int size() const {
+        return current;
+    }
+
+    // A new data packet went out. Returns true if the sample it completed changed the size
+    bool onSend();
+
+    // A packet had to be resent
+    void onLoss();
+};
+
+
+#endif //SLIDING_WINDOW_PACKETSIZER_H
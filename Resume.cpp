@@ -0,0 +1,183 @@
+//
+// Created on 10/19/26.
+//
+
+#include <algorithm>
+#include <unistd.h>
+
+#include "Resume.h"
+
+#define RESUME_MAGIC 0x314d555345525753ULL // "SWRESUM1"
+
+uint64_t transferId(const string &fileName, uint64_t fileSize, int64_t mtime) {
+    // FNV-1a over the name, size and modification time
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto mix = [&hash](const void *data, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            hash ^= ((const unsigned char *) data)[i];
+            hash *= 0x100000001b3ULL;
+        }
+    };
+
+    mix(fileName.data(), fileName.size());
+    mix(&fileSize, sizeof(fileSize));
+    mix(&mtime, sizeof(mtime));
+
+    // 0 means the client didn't ask to resume
+    return hash == 0 ? 1 : hash;
+}
+
+uint64_t chunkCount(uint64_t fileSize, unsigned int chunkSize) {
+    return fileSize / chunkSize + 1;
+}
+
+ChunkSchedule::ChunkSchedule(uint64_t chunks) {
+    ranges.push_back({0, chunks});
+    total = chunks;
+}
+
+ChunkSchedule::ChunkSchedule(const vector<ChunkRange> &missing, uint64_t chunks) {
+    for (const ChunkRange &range : missing) {
+        if (range.first >= chunks || range.count == 0) continue;
+
+        uint64_t count = min(range.count, chunks - range.first);
+        ranges.push_back({range.first, count});
+        total += count;
+    }
+}
+
+uint64_t ChunkSchedule::next() {
+    ChunkRange &range = ranges.front();
+    uint64_t chunk = range.first;
+
+    range.first++;
+    if (--range.count == 0) ranges.pop_front();
+    handedOut++;
+
+    return chunk;
+}
+
+ReceiveBitmap::~ReceiveBitmap() {
+    if (file != NULL) fclose(file);
+}
+
+bool ReceiveBitmap::open(const string &outputPath, uint64_t transferId, uint64_t fileSize, int64_t mtime, unsigned int chunkSize) {
+    path = outputPath + RESUME_SUFFIX;
+    header = {RESUME_MAGIC, transferId, fileSize, mtime, chunkSize, chunkCount(fileSize, chunkSize)};
+    words.assign((header.chunks + 63) / 64, 0);
+    partial.clear();
+
+    // Only pick up where we left off if the partial file is still there and the bitmap is for this exact transfer
+    file = fopen(path.c_str(), "rb+");
+    if (file != NULL) {
+        Header saved{};
+        bool matches = access(outputPath.c_str(), F_OK) == 0 &&
+                fread(&saved, sizeof(saved), 1, file) == 1 &&
+                saved.magic == header.magic && saved.transferId == header.transferId && saved.fileSize == header.fileSize &&
+                saved.mtime == header.mtime && saved.chunkSize == header.chunkSize && saved.chunks == header.chunks &&
+                fread(words.data(), sizeof(uint64_t), words.size(), file) == words.size();
+
+        if (matches) {
+            for (uint64_t word : words) received += __builtin_popcountll(word);
+            return received > 0;
+        }
+
+        fclose(file);
+        words.assign(words.size(), 0);
+    }
+
+    file = fopen(path.c_str(), "wb+");
+    if (file == NULL) {
+        fprintf(stderr, "Unable to create %s; this transfer can't be resumed\n", path.c_str());
+        return false;
+    }
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(words.data(), sizeof(uint64_t), words.size(), file);
+    fflush(file);
+
+    return false;
+}
+
+bool ReceiveBitmap::mark(uint64_t offset, uint64_t length) {
+    uint64_t chunk = offset / header.chunkSize;
+    if (chunk >= header.chunks) return false;
+
+    uint64_t bit = 1ULL << (chunk % 64);
+    size_t word = chunk / 64;
+    if (words[word] & bit) return false;
+
+    // Out-of-order placement can write a chunk's last piece before an earlier one, so the pieces are added up. A resent
+    // piece has the same offset as the first copy and replaces it
+    uint64_t chunkStart = chunk * header.chunkSize;
+    uint64_t chunkLength = min(header.chunkSize, header.fileSize - chunkStart);
+    if (offset != chunkStart || length < chunkLength) {
+        map<uint64_t, uint64_t> &pieces = partial[chunk];
+        pieces[offset] = length;
+
+        uint64_t covered = 0;
+        for (auto &piece : pieces) covered += piece.second;
+        if (covered < chunkLength) return false;
+        partial.erase(chunk);
+    }
+
+    words[word] |= bit;
+    received++;
+    dirtyFirst = min(dirtyFirst, word);
+    dirtyLast = max(dirtyLast, word);
+
+    return ++unflushed >= RESUME_FLUSH_INTERVAL;
+}
+
+void ReceiveBitmap::flush() {
+    unflushed = 0;
+    if (file == NULL || dirtyFirst > dirtyLast) return;
+
+    fseeko(file, (off_t) (sizeof(Header) + dirtyFirst * sizeof(uint64_t)), SEEK_SET);
+    fwrite(&words[dirtyFirst], sizeof(uint64_t), dirtyLast - dirtyFirst + 1, file);
+    fflush(file);
+
+    dirtyFirst = SIZE_MAX;
+    dirtyLast = 0;
+}
+
+void ReceiveBitmap::finish() {
+    if (file == NULL) return;
+
+    fclose(file);
+    file = NULL;
+    remove(path.c_str());
+}
+
+vector<ChunkRange> ReceiveBitmap::missing() const {
+    vector<ChunkRange> ranges;
+    uint64_t chunk = 0;
+
+    while (chunk < header.chunks) {
+        // Skip over runs of received chunks a word at a time
+        if (chunk % 64 == 0 && words[chunk / 64] == ~0ULL) {
+            chunk += 64;
+            continue;
+        }
+
+        if (words[chunk / 64] & (1ULL << (chunk % 64))) {
+            chunk++;
+            continue;
+        }
+
+        // Too fragmented; resend everything from here on rather than grow the SYN-ACK further
+        if (ranges.size() == RESUME_MAX_RANGES - 1) {
+            ranges.push_back({chunk, header.chunks - chunk});
+            break;
+        }
+
+        uint64_t first = chunk;
+        while (chunk < header.chunks && !(words[chunk / 64] & (1ULL << (chunk % 64)))) chunk++;
+        ranges.push_back({first, chunk - first});
+    }
+
+    // Everything arrived but the FIN was never ACK'd; the last chunk closes the transfer out
+    if (ranges.empty()) ranges.push_back({header.chunks - 1, 1});
+
+    return ranges;
+}
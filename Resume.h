@@ -0,0 +1,124 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_RESUME_H
+#define SLIDING_WINDOW_RESUME_H
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define RESUME_SUFFIX ".resume" // appended to the output file's path for its receive bitmap
+#define RESUME_MAX_RANGES 4096 // missing ranges a SYN-ACK carries; any further holes are folded into the last one
+#define RESUME_FLUSH_INTERVAL 256 // chunks received between writes of the receive bitmap
+
+using namespace std;
+
+// Run of chunks (packet-sized pieces of the file, chunk n starting at byte n * pktSize) as sent in a SYN-ACK
+struct ChunkRange {
+    uint64_t first;
+    uint64_t count;
+};
+
+// Identifies a transfer across connections so a server only resumes from a partial file of the same source file
+uint64_t transferId(const string &fileName, uint64_t fileSize, int64_t mtime);
+
+// Chunks of a file of fileSize bytes, including the short (possibly empty) last chunk that carries the FIN
+uint64_t chunkCount(uint64_t fileSize, unsigned int chunkSize);
+
+// Chunks the client still has to send, in file order
+class ChunkSchedule {
+    deque<ChunkRange> ranges;
+    uint64_t total = 0;
+    uint64_t handedOut = 0;
+
+public:
+    ChunkSchedule() = default;
+
+    // Every chunk of the file
+    ChunkSchedule(uint64_t chunks);
+
+    // Only the missing chunks, dropping any past the end of the file
+    ChunkSchedule(const vector<ChunkRange> &missing, uint64_t chunks);
+
+    bool empty() const {
+        return ranges.empty();
+    }
+
+    uint64_t size() const {
+        return total;
+    }
+
+    // Chunks next() has returned so far
+    uint64_t taken() const {
+        return handedOut;
+    }
+
+    // Removes and returns the next chunk to send
+    uint64_t next();
+};
+
+/* Chunks of the output file received so far, persisted beside it so a transfer that dies part way through can pick up
+ * where it left off. The bitmap is written back every RESUME_FLUSH_INTERVAL chunks and when the connection closes, and
+ * removed once the transfer completes.
+ */
+class ReceiveBitmap {
+    struct Header {
+        uint64_t magic;
+        uint64_t transferId;
+        uint64_t fileSize;
+        int64_t mtime;
+        uint64_t chunkSize;
+        uint64_t chunks;
+    };
+
+    string path;
+    FILE *file = NULL;
+    Header header{};
+    vector<uint64_t> words;
+    uint64_t received = 0;
+    size_t dirtyFirst = SIZE_MAX, dirtyLast = 0; // words changed since the last flush
+    unsigned int unflushed = 0;
+    unordered_map<uint64_t, map<uint64_t, uint64_t>> partial; // lengths of the pieces of split chunks in so far, by offset
+
+public:
+    ReceiveBitmap() = default;
+    ~ReceiveBitmap();
+
+    ReceiveBitmap(const ReceiveBitmap &) = delete;
+    ReceiveBitmap &operator=(const ReceiveBitmap &) = delete;
+
+    // Loads the bitmap an earlier attempt at the same transfer left beside outputPath, or starts an empty one. Returns
+    // true if some of the file was already received
+    bool open(const string &outputPath, uint64_t transferId, uint64_t fileSize, int64_t mtime, unsigned int chunkSize);
+
+    // Records the length bytes at offset as written. A chunk sent in pieces is only marked once every piece is in, whatever
+    // order they were written in. Returns true once enough chunks have arrived that the bitmap is due a flush
+    bool mark(uint64_t offset, uint64_t length);
+
+    // Writes back the words changed since the last flush. The output file must be flushed first so the bitmap never
+    // claims data that is still only buffered
+    void flush();
+
+    // Removes the bitmap once the whole file is in place
+    void finish();
+
+    // Ranges of chunks not yet received, capped at RESUME_MAX_RANGES
+    vector<ChunkRange> missing() const;
+
+    uint64_t count() const {
+        return received;
+    }
+
+    uint64_t chunks() const {
+        return header.chunks;
+    }
+};
+
+
+#endif //SLIDING_WINDOW_RESUME_H
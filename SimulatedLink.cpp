@@ -0,0 +1,199 @@
+//
+// Created on 10/19/26.
+//
+
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <climits>
+
+#include "Clock.h"
+#include "SimulatedLink.h"
+
+SimulatedLink::SimulatedLink(const Impairments &up, const Impairments &down, uint64_t seed, int64_t startUs) {
+    impairments[SIM_CLIENT] = up;
+    impairments[SIM_SERVER] = down;
+    for (unsigned int side = 0; side < 2; side++) {
+        seed_seq sideSeed{seed, (uint64_t) side};
+        sides[side].model.reset(new ImpairmentModel(impairments[side], sideSeed));
+    }
+
+    now = startUs;
+    Clock::simulate(now);
+}
+
+void SimulatedLink::sampleEvery(int64_t intervalUs, const function<void(int64_t, const DirectionStats &, const DirectionStats &)> &sample) {
+    lock_guard<mutex> guard(lock);
+    sampleIntervalUs = intervalUs;
+    nextSample = now + intervalUs;
+    sampler = sample;
+}
+
+void SimulatedLink::leave(unsigned int side) {
+    lock_guard<mutex> guard(lock);
+    if (!sides[side].present) return;
+
+    sides[side].present = false;
+    sides[side].closed = true;
+    running--;
+    wake.notify_all();
+}
+
+int64_t SimulatedLink::elapsedUs(int64_t startUs) {
+    lock_guard<mutex> guard(lock);
+    return now - startUs;
+}
+
+bool SimulatedLink::wasStalled() {
+    lock_guard<mutex> guard(lock);
+    return stalled;
+}
+
+DirectionStats SimulatedLink::stats(unsigned int side) {
+    lock_guard<mutex> guard(lock);
+    return sides[side].model->stats;
+}
+
+// Moves the frames due by now from the wire to the side's arrivals
+void SimulatedLink::deliver(unsigned int side) {
+    FrameQueue &incoming = sides[side].incoming;
+    while (!incoming.empty() && incoming.top().release <= now) {
+        sides[side].arrived.push_back(move(const_cast<Frame &>(incoming.top()).bytes));
+        incoming.pop();
+    }
+}
+
+// Whether a read on the side would return straight away: bytes have arrived or the other side has closed and everything
+// it sent has been delivered
+bool SimulatedLink::readable(unsigned int side) {
+    deliver(side);
+    Side &self = sides[side];
+    return !self.arrived.empty() || (sides[1 - side].closed && self.incoming.empty()) || stalled;
+}
+
+// Lets every blocked side that can carry on run again, returning whether any could
+bool SimulatedLink::unblockReady() {
+    bool unblocked = false;
+    for (unsigned int side = 0; side < 2; side++) {
+        Side &waiting = sides[side];
+        if (waiting.blocked && (readable(side) || now >= waiting.deadline)) {
+            waiting.blocked = false;
+            running++;
+            unblocked = true;
+        }
+    }
+
+    if (unblocked) wake.notify_all();
+    return unblocked;
+}
+
+// With both sides blocked, jumps to the next frame arriving or wait running out
+void SimulatedLink::advance() {
+    if (unblockReady()) return;
+
+    int64_t next = LLONG_MAX;
+    for (Side &side : sides) {
+        if (!side.incoming.empty()) next = min(next, side.incoming.top().release);
+        if (side.blocked) next = min(next, side.deadline);
+    }
+
+    if (next == LLONG_MAX) {
+        // Neither side is waiting on anything that will happen, so they'd wait forever
+        stalled = true;
+        unblockReady();
+        return;
+    }
+
+    next = max(next, now);
+    while (sampler && nextSample <= next) {
+        sampler(nextSample, sides[SIM_CLIENT].model->stats, sides[SIM_SERVER].model->stats);
+        nextSample += sampleIntervalUs;
+    }
+
+    now = next;
+    Clock::simulate(now);
+    unblockReady();
+}
+
+// Waits, in virtual time, until the side is readable or its deadline passes. Whichever side blocks last moves time on
+void SimulatedLink::block(unique_lock<mutex> &guard, unsigned int side, int64_t deadline) {
+    Side &self = sides[side];
+    if (readable(side) || now >= deadline) return;
+
+    self.blocked = true;
+    self.deadline = deadline;
+    running--;
+
+    while (self.blocked) {
+        if (running == 0) advance();
+        else wake.wait(guard);
+    }
+}
+
+ssize_t SimulatedTransport::send(const void *bytes, size_t size) {
+    lock_guard<mutex> guard(link.lock);
+    SimulatedLink::Side &self = link.sides[side];
+    if (self.closed) {
+        errno = EPIPE;
+        return -1;
+    }
+
+    // Frames are impaired whole, so bytes wait here until the rest of their frame is written
+    const char *data = (const char *) bytes;
+    self.unframed.insert(self.unframed.end(), data, data + size);
+    ImpairmentModel::splitFrames(self.unframed, [&](vector<char> frame) {
+        self.model->apply(move(frame), link.now, link.sides[1 - side].incoming);
+    });
+
+    return (ssize_t) size;
+}
+
+ssize_t SimulatedTransport::receive(void *bytes, size_t size) {
+    unique_lock<mutex> guard(link.lock);
+    SimulatedLink::Side &self = link.sides[side];
+    int64_t deadline = self.receiveTimeoutUs > 0 ? link.now + self.receiveTimeoutUs : LLONG_MAX;
+    link.block(guard, side, deadline);
+    link.deliver(side);
+
+    if (self.arrived.empty()) {
+        if (link.stalled || link.sides[1 - side].closed) return 0;
+        errno = EAGAIN;
+        return -1;
+    }
+
+    // Like a stream, a read takes what's arrived, across frames, up to the size asked for
+    size_t copied = 0;
+    while (copied < size && !self.arrived.empty()) {
+        vector<char> &frame = self.arrived.front();
+        size_t take = min(size - copied, frame.size() - self.readOffset);
+        memcpy((char *) bytes + copied, frame.data() + self.readOffset, take);
+        copied += take;
+        self.readOffset += take;
+
+        if (self.readOffset == frame.size()) {
+            self.arrived.pop_front();
+            self.readOffset = 0;
+        }
+    }
+
+    return (ssize_t) copied;
+}
+
+bool SimulatedTransport::setReceiveTimeout(chrono::microseconds timeout) {
+    lock_guard<mutex> guard(link.lock);
+    link.sides[side].receiveTimeoutUs = timeout.count();
+    return true;
+}
+
+bool SimulatedTransport::wait(chrono::microseconds maxWait) {
+    unique_lock<mutex> guard(link.lock);
+    link.block(guard, side, link.now + maxWait.count());
+    link.deliver(side);
+
+    return !link.sides[side].arrived.empty();
+}
+
+void SimulatedTransport::close() {
+    lock_guard<mutex> guard(link.lock);
+    link.sides[side].closed = true;
+}
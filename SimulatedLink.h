@@ -0,0 +1,97 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_SIMULATEDLINK_H
+#define SLIDING_WINDOW_SIMULATEDLINK_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "Impairment.h"
+#include "Transport.h"
+
+#define SIM_CLIENT 0 // the side of the link each end is on
+#define SIM_SERVER 1
+
+using namespace std;
+
+class SimulatedLink;
+
+// One end of a simulated link
+class SimulatedTransport : public Transport {
+    SimulatedLink &link;
+    unsigned int side;
+
+public:
+    SimulatedTransport(SimulatedLink &link, unsigned int side) : link(link), side(side) {}
+
+    ssize_t send(const void *bytes, size_t size) override;
+    ssize_t receive(void *bytes, size_t size) override;
+    bool setReceiveTimeout(chrono::microseconds timeout) override;
+    bool wait(chrono::microseconds maxWait) override;
+    void close() override;
+};
+
+/* Two transports joined by an impaired network on a virtual clock. The client and server each run on a thread of their
+ * own, and a thread waiting on its transport is blocked; once both are, virtual time jumps straight to the next thing
+ * that happens, a frame arriving or a wait running out. Nothing sleeps, so a transfer runs as fast as its two ends can
+ * process its packets, however slow the link.
+ */
+class SimulatedLink {
+    friend class SimulatedTransport;
+
+    struct Side {
+        vector<char> unframed; // written, but not yet a whole frame
+        FrameQueue incoming; // frames on their way to this side
+        deque<vector<char>> arrived; // frames delivered to this side and not yet read
+        size_t readOffset = 0; // into the front of arrived
+        unique_ptr<ImpairmentModel> model; // impairs the frames this side sends
+        int64_t receiveTimeoutUs = 0;
+        bool closed = false;
+        bool blocked = false;
+        bool present = true; // still running on its thread
+        int64_t deadline = 0; // when a blocked side gives up waiting
+    };
+
+    Side sides[2];
+    Impairments impairments[2]; // of the frames each side sends
+    mutex lock;
+    condition_variable wake;
+    int64_t now; // us
+    unsigned int running = 2; // sides that aren't blocked
+    bool stalled = false; // both sides were waiting on nothing that would ever happen
+    function<void(int64_t, const DirectionStats &, const DirectionStats &)> sampler;
+    int64_t sampleIntervalUs = 0, nextSample = 0;
+
+    bool readable(unsigned int side);
+    void deliver(unsigned int side);
+    bool unblockReady();
+    void advance();
+    void block(unique_lock<mutex> &guard, unsigned int side, int64_t deadline);
+
+public:
+    SimulatedLink(const Impairments &up, const Impairments &down, uint64_t seed, int64_t startUs);
+
+    shared_ptr<Transport> transport(unsigned int side) {
+        return make_shared<SimulatedTransport>(*this, side);
+    }
+
+    /* Calls sample every intervalUs of virtual time with the time it's called for and the stats of the frames each side
+     * has sent so far. It's called with the link locked, so it mustn't use the link itself
+     */
+    void sampleEvery(int64_t intervalUs, const function<void(int64_t, const DirectionStats &, const DirectionStats &)> &sample);
+
+    // The side's thread is finished with the link, so time is no longer held up waiting on it
+    void leave(unsigned int side);
+
+    int64_t elapsedUs(int64_t startUs);
+    bool wasStalled();
+    DirectionStats stats(unsigned int side); // of the frames the side sent
+};
+
+
+#endif //SLIDING_WINDOW_SIMULATEDLINK_H
@@ -0,0 +1,47 @@
+//
+// Created on 10/19/26.
+//
+
+#include "SlidingWindow.h"
+
+void SlidingWindow::allocate(unsigned int wSize, bool withSlots) {
+    // Round up to a power of two (and at least one bitmap word) so slots can be found by masking
+    capacity = 64;
+    while (capacity < wSize) capacity <<= 1;
+    mask = capacity - 1;
+
+    slots.clear();
+    if (withSlots) slots.resize(capacity);
+    bits.assign(capacity / 64, 0);
+}
+
+void SlidingWindow::allocateSlots() {
+    if (slots.empty()) slots.resize(capacity);
+}
+
+unsigned int SlidingWindow::advance(uint64_t base, unsigned int limit) {
+    unsigned int run = 0;
+
+    while (run < limit) {
+        uint64_t pos = (base + run) & mask;
+        uint64_t &word = bits[pos >> 6];
+        unsigned int offset = pos & 63;
+
+        // Number of consecutive set bits from offset; ~0 means the rest of the word is set
+        uint64_t remaining = ~(word >> offset);
+        unsigned int length = (remaining == 0) ? 64 - offset : __builtin_ctzll(remaining);
+        if (length > 64 - offset) length = 64 - offset;
+        if (length > limit - run) length = limit - run;
+        if (length == 0) break;
+
+        // Clear the bits being slid over
+        uint64_t clear = (length == 64) ? ~0ULL : (((1ULL << length) - 1) << offset);
+        word &= ~clear;
+        run += length;
+
+        // Run ended before the end of this word
+        if (offset + length < 64) break;
+    }
+
+    return run;
+}
@@ -0,0 +1,64 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_SLIDINGWINDOW_H
+#define SLIDING_WINDOW_SLIDINGWINDOW_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "Packet.h"
+#include "PacketInfo.h"
+
+using namespace std;
+
+/* Packet buffer for a window of up to wSize packets in flight.
+ *
+ * Slots are sized to the next power of two >= wSize, so a sequence number maps to its slot with (sqn & mask). The
+ * ACK'd (client) / received (server) state of each slot is kept apart from the packets in a packed bitmap, which lets
+ * the window slide over a run of completed packets a 64-bit word at a time rather than rescanning every slot.
+ *
+ * Bits always describe sequence numbers at or above the base of the window (LAR + 1 / LFR + 1); advance() clears them
+ * as the base moves past, so a set bit never belongs to a previous lap of the buffer.
+ *
+ * A receiver that writes packets to the file as they arrive only needs the bitmap, so the slots can be left until a
+ * packet has to be held.
+ */
+class SlidingWindow {
+    vector<PacketInfo> slots;
+    vector<uint64_t> bits;
+    unsigned int capacity = 0;
+    unsigned int mask = 0;
+
+public:
+    void allocate(unsigned int wSize, bool withSlots = true);
+    void allocateSlots();
+
+    PacketInfo &operator[](uint64_t sqn) {
+        return slots[sqn & mask];
+    }
+
+    bool isSet(uint64_t sqn) const {
+        return (bits[(sqn & mask) >> 6] >> (sqn & 63)) & 1;
+    }
+
+    void set(uint64_t sqn) {
+        bits[(sqn & mask) >> 6] |= (1ULL << (sqn & 63));
+    }
+
+    // Length of the run of set bits starting at base (at most limit), clearing them as the window slides over them
+    unsigned int advance(uint64_t base, unsigned int limit);
+
+    unsigned int size() const {
+        return capacity;
+    }
+
+    bool hasSlots() const {
+        return !slots.empty();
+    }
+};
+
+
+#endif //SLIDING_WINDOW_SLIDINGWINDOW_H
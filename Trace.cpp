@@ -0,0 +1,90 @@
+//
+// Created on 10/19/26.
+//
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include "Clock.h"
+#include "Trace.h"
+
+static_assert(sizeof(TraceRecord) == 24, "trace records are written to files as they are");
+
+mutex Tracer::ringsLock;
+vector<unique_ptr<Tracer::Ring>> Tracer::rings;
+int Tracer::level = TRACE_LEVEL_OFF;
+
+Tracer::Ring &Tracer::threadRing() {
+    static thread_local Ring *ring = NULL;
+    if (ring != NULL) return *ring;
+
+    lock_guard<mutex> guard(ringsLock);
+    rings.emplace_back(new Ring());
+    ring = rings.back().get();
+    ring->records.resize(TRACE_RING_RECORDS);
+    ring->index = (uint8_t) (rings.size() - 1);
+
+    return *ring;
+}
+
+void Tracer::record(TraceEvent event, uint64_t sqn, uint32_t value, uint16_t fileId) {
+    Ring &ring = threadRing();
+    uint64_t written = ring.written.load(memory_order_relaxed);
+
+    TraceRecord &record = ring.records[written & (TRACE_RING_RECORDS - 1)];
+    record.time = (uint64_t) chrono::duration_cast<chrono::nanoseconds>(Clock::steadyNow().time_since_epoch()).count();
+    record.sqn = sqn;
+    record.value = value;
+    record.fileId = fileId;
+    record.event = event;
+    record.thread = ring.index;
+
+    ring.written.store(written + 1, memory_order_release);
+}
+
+bool Tracer::dump(const string &path, const string &role) {
+    lock_guard<mutex> guard(ringsLock);
+
+    TraceFileHeader header{};
+    memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    strncpy(header.role, role.c_str(), sizeof(header.role) - 1);
+    for (const unique_ptr<Ring> &ring : rings) {
+        header.records += min(ring->written.load(memory_order_acquire), (uint64_t) TRACE_RING_RECORDS);
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Unable to write the trace file %s\nError #: %d\n", path.c_str(), errno);
+        return false;
+    }
+
+    fwrite(&header, sizeof(header), 1, file);
+    for (const unique_ptr<Ring> &ring : rings) {
+        uint64_t written = ring->written.load(memory_order_acquire);
+        uint64_t count = min(written, (uint64_t) TRACE_RING_RECORDS);
+
+        // Once the ring has wrapped, the oldest record is the one about to be overwritten
+        uint64_t start = (written - count) & (TRACE_RING_RECORDS - 1);
+        uint64_t tail = min(count, (uint64_t) TRACE_RING_RECORDS - start);
+        fwrite(&ring->records[start], sizeof(TraceRecord), tail, file);
+        fwrite(&ring->records[0], sizeof(TraceRecord), count - tail, file);
+    }
+
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
+
+const char *Tracer::eventName(uint8_t event) {
+    static const char *names[TRACE_EVENT_COUNT] = {"unknown", "connection_opened", "connection_closed", "pkt_sent",
+                                                   "pkt_resent", "pkt_lost", "pkt_damaged", "parity_sent", "ack_sent",
+                                                   "pkt_received", "parity_received", "ack_received", "chksum_failed",
+                                                   "recv_timeout", "rto_fired", "acked_in_queue", "window"};
+
+    return event < TRACE_EVENT_COUNT ? names[event] : "unknown";
+}
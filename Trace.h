@@ -0,0 +1,105 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_TRACE_H
+#define SLIDING_WINDOW_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Trace levels; each includes the ones below it
+#define TRACE_LEVEL_OFF 0 // nothing is recorded
+#define TRACE_LEVEL_EVENTS 1 // losses, damage, timeouts and resends
+#define TRACE_LEVEL_PACKETS 2 // every packet and ACK sent or received
+#define TRACE_LEVEL_WINDOW 3 // the window, every time round the send and receive loops
+
+// Events above this level are compiled out entirely (-DTRACE_MAX_LEVEL=0 removes tracing)
+#ifndef TRACE_MAX_LEVEL
+#define TRACE_MAX_LEVEL TRACE_LEVEL_WINDOW
+#endif
+
+#define TRACE_RING_RECORDS (1 << 16) // records each thread keeps; the oldest are overwritten
+#define TRACE_MAGIC "SWTRACE" // starts every trace file
+#define TRACE_VERSION 1 // of the file format
+
+// Records an event if tracing is compiled in and switched on at its level; otherwise costs a comparison or nothing
+#define TRACE(traceLevel, event, sqn, value, fileId) \
+    do { \
+        if ((traceLevel) <= TRACE_MAX_LEVEL && (traceLevel) <= Tracer::level) Tracer::record(event, sqn, value, fileId); \
+    } while (0)
+
+using namespace std;
+
+enum TraceEvent : uint8_t {
+    TRACE_CONNECTION_OPENED = 1, // value: the peer's port
+    TRACE_CONNECTION_CLOSED, // sqn: the Protocol the connection settled on; value: its Status
+    TRACE_PKT_SENT, // value: payload bytes
+    TRACE_PKT_RESENT, // value: times sent, this one included
+    TRACE_PKT_LOST, // simulated loss; value: times sent
+    TRACE_PKT_DAMAGED, // simulated damage; value: times sent
+    TRACE_PARITY_SENT, // sqn: the block's first packet; value: parity index
+    TRACE_ACK_SENT,
+    TRACE_PKT_RECEIVED, // value: payload bytes
+    TRACE_PARITY_RECEIVED, // sqn: the block's first packet; value: parity index
+    TRACE_ACK_RECEIVED,
+    TRACE_CHKSUM_FAILED,
+    TRACE_RECV_TIMEOUT, // nothing arrived within the socket's timeout
+    TRACE_RTO_FIRED, // value: times the packet had been sent
+    TRACE_ACKED_IN_QUEUE, // an ACK'd packet was still at the head of the timeout queue; value: queue size after
+    TRACE_WINDOW, // sqn: base of the window; value: packets in flight (client) / buffered out of order (server)
+    TRACE_EVENT_COUNT
+};
+
+// Fixed size so the rings can be written to a file as they are
+struct TraceRecord {
+    uint64_t time; // steady clock, in ns; shared by every process on the host
+    uint64_t sqn;
+    uint32_t value;
+    uint16_t fileId;
+    uint8_t event;
+    uint8_t thread; // index of the ring it was written to
+};
+
+struct TraceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    char role[8]; // "client" or "server"
+    uint64_t records;
+};
+
+/* Per-thread rings of binary trace records. Writing one is a clock read and a 24 byte store into the calling thread's
+ * ring; nothing is formatted until the decoder reads the file dump() writes.
+ */
+class Tracer {
+    struct Ring {
+        vector<TraceRecord> records;
+        atomic<uint64_t> written{0};
+        uint8_t index = 0;
+    };
+
+    static mutex ringsLock; // taken when a thread first traces, and to dump
+    static vector<unique_ptr<Ring>> rings;
+
+    static Ring &threadRing();
+
+public:
+    static int level; // runtime level; TRACE_LEVEL_OFF unless --trace is given
+
+    static void record(TraceEvent event, uint64_t sqn, uint32_t value, uint16_t fileId);
+
+    /* Writes every thread's ring, oldest record first, to path. Threads still tracing while this runs may have their
+     * newest records torn, so it's called between connections.
+     */
+    static bool dump(const string &path, const string &role);
+
+    static const char *eventName(uint8_t event);
+};
+
+
+#endif //SLIDING_WINDOW_TRACE_H
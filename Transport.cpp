@@ -0,0 +1,56 @@
+//
+// Created on 10/19/26.
+//
+
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <algorithm>
+
+#include "Transport.h"
+
+ssize_t SocketTransport::send(const void *bytes, size_t size) {
+    return write(sockfd, bytes, size);
+}
+
+ssize_t SocketTransport::receive(void *bytes, size_t size) {
+    if (readStart < readEnd) {
+        size_t buffered = min(size, readEnd - readStart);
+        memcpy(bytes, readahead.data() + readStart, buffered);
+        readStart += buffered;
+        return (ssize_t) buffered;
+    }
+
+    struct iovec iov[2] = {{bytes, size}, {readahead.data(), readahead.size()}};
+    ssize_t bytesRead = readv(sockfd, iov, 2);
+    readStart = 0;
+    readEnd = 0;
+    if (bytesRead <= (ssize_t) size) return bytesRead;
+
+    readEnd = bytesRead - size;
+    return (ssize_t) size;
+}
+
+bool SocketTransport::setReceiveTimeout(chrono::microseconds timeout) {
+    chrono::seconds seconds = chrono::duration_cast<chrono::seconds>(timeout);
+    timeval tv{seconds.count(), (suseconds_t) (timeout - seconds).count()};
+
+    return setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == 0;
+}
+
+bool SocketTransport::wait(chrono::microseconds maxWait) {
+    if (readStart < readEnd) return true;
+
+    pollfd pfd{sockfd, POLLIN, 0};
+    chrono::seconds seconds = chrono::duration_cast<chrono::seconds>(maxWait);
+    timespec ts{seconds.count(), (long) chrono::duration_cast<chrono::nanoseconds>(maxWait - seconds).count()};
+
+    return ppoll(&pfd, 1, &ts, NULL) > 0;
+}
+
+void SocketTransport::close() {
+    ::close(sockfd);
+}
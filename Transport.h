@@ -0,0 +1,56 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_TRANSPORT_H
+#define SLIDING_WINDOW_TRANSPORT_H
+
+#include <sys/types.h>
+#include <chrono>
+#include <vector>
+
+#define TRANSPORT_READAHEAD_BYTES 4096 // read past the caller's buffer in the same call, to pick up the next headers
+
+using namespace std;
+
+/* The byte stream a connection's packets travel over. Reads and writes follow read() and write(): a read that times out
+ * returns -1 with errno set to EAGAIN, and one at the end of the stream returns 0.
+ */
+class Transport {
+public:
+    virtual ~Transport() {}
+
+    virtual ssize_t send(const void *bytes, size_t size) = 0;
+    virtual ssize_t receive(void *bytes, size_t size) = 0;
+
+    // How long a receive waits for bytes before giving up; 0 waits indefinitely
+    virtual bool setReceiveTimeout(chrono::microseconds timeout) = 0;
+
+    // Waits up to maxWait for bytes to arrive, returning false if none did
+    virtual bool wait(chrono::microseconds maxWait) = 0;
+
+    virtual void close() = 0;
+};
+
+/* A connected TCP socket. Each read fills the caller's buffer straight from the socket and, with the same readv, a small
+ * readahead buffer behind it. Headers and ACKs are then mostly served from the readahead without a syscall, while a
+ * payload only has its first few bytes copied out of it and the rest lands where it was asked for.
+ */
+class SocketTransport : public Transport {
+    int sockfd;
+    vector<char> readahead;
+    size_t readStart = 0; // unread bytes of the readahead are [readStart, readEnd)
+    size_t readEnd = 0;
+
+public:
+    explicit SocketTransport(int sockfd) : sockfd(sockfd), readahead(TRANSPORT_READAHEAD_BYTES) {}
+
+    ssize_t send(const void *bytes, size_t size) override;
+    ssize_t receive(void *bytes, size_t size) override;
+    bool setReceiveTimeout(chrono::microseconds timeout) override;
+    bool wait(chrono::microseconds maxWait) override;
+    void close() override;
+};
+
+
+#endif //SLIDING_WINDOW_TRANSPORT_H
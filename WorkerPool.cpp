@@ -0,0 +1,51 @@
+//
+// Created on 10/19/26.
+//
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(unsigned int threads) {
+    if (threads == 0) threads = 1;
+
+    for (unsigned int i = 0; i < threads; i++) {
+        workers.emplace_back(&WorkerPool::run, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        lock_guard<mutex> guard(jobsLock);
+        stopping = true;
+    }
+
+    jobAvailable.notify_all();
+    for (thread &worker : workers) worker.join();
+}
+
+void WorkerPool::submit(function<void()> job) {
+    {
+        lock_guard<mutex> guard(jobsLock);
+        jobs.push(move(job));
+    }
+
+    jobAvailable.notify_one();
+}
+
+void WorkerPool::run() {
+    while (true) {
+        function<void()> job;
+
+        {
+            unique_lock<mutex> guard(jobsLock);
+            jobAvailable.wait(guard, [this] { return stopping || !jobs.empty(); });
+
+            // Finish what's queued before stopping
+            if (jobs.empty()) return;
+
+            job = move(jobs.front());
+            jobs.pop();
+        }
+
+        job();
+    }
+}
@@ -0,0 +1,38 @@
+//
+// Created on 10/19/26.
+//
+
+#ifndef SLIDING_WINDOW_WORKERPOOL_H
+#define SLIDING_WINDOW_WORKERPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Fixed set of threads running submitted jobs in FIFO order
+class WorkerPool {
+    vector<thread> workers;
+    queue<function<void()>> jobs;
+    mutex jobsLock;
+    condition_variable jobAvailable;
+    bool stopping = false;
+
+    void run();
+
+public:
+    explicit WorkerPool(unsigned int threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    void submit(function<void()> job);
+};
+
+
+#endif //SLIDING_WINDOW_WORKERPOOL_H
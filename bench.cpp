@@ -0,0 +1,293 @@
+//
+// Created on 10/19/26.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "ApplicationState.h"
+#include "ConnectionController.h"
+#include "PacketBuilder.h"
+
+#define BENCH_MIN_TIME_MS 200 // each case runs for at least this long
+#define BENCH_PAYLOAD_SIZES {64, 512, 1024, 4096, 16384, 32768, 65536}
+#define BENCH_WINDOW_SIZES {8, 64, 512, 4096, 65536}
+
+using namespace std;
+
+enum OutputFormat {
+    TABLE, CSV, JSON
+};
+
+struct BenchResult {
+    string name;
+    uint64_t param; // payload size or window size the case ran at
+    uint64_t ops;
+    double nsPerOp;
+    double bytesPerSec; // 0 where the case doesn't move bytes
+};
+
+// Keeps the compiler from discarding work whose result is otherwise unused
+static volatile uint64_t sink;
+
+/* Microbenchmarks of the packet hot path, reaching into ConnectionController for the window bookkeeping the send and
+ * receive loops do. Each case runs batches of doubling size until one takes the minimum time, and reports that batch.
+ */
+class HotPathBench {
+    ApplicationState appState{};
+    ConnectionController controller{appState};
+    chrono::milliseconds minTime;
+    string filter;
+    vector<BenchResult> results;
+
+    template<typename Op>
+    void run(const string &name, uint64_t param, uint64_t bytesPerOp, Op op) {
+        if (!filter.empty() && name.find(filter) == string::npos) return;
+
+        for (uint64_t ops = 1;; ops *= 2) {
+            auto start = chrono::steady_clock::now();
+            op(ops);
+            chrono::nanoseconds elapsed = chrono::steady_clock::now() - start;
+
+            if (elapsed >= minTime || ops >= (1ULL << 40)) {
+                double ns = (double) elapsed.count();
+                results.push_back({name, param, ops, ns / ops, bytesPerOp * ops / (ns / 1e9)});
+                return;
+            }
+        }
+    }
+
+    static PacketBuilder dataBuilder(unsigned int pktSize) {
+        vector<char> payload(pktSize, 'x');
+        PacketBuilder pktBuilder;
+        pktBuilder.setSqnBits(16);
+        pktBuilder.setWSize(64);
+        pktBuilder.setPktSize(pktSize);
+        pktBuilder.setOffset(0);
+        pktBuilder.setPayload(payload.data(), pktSize);
+
+        return pktBuilder;
+    }
+
+    void packetCases() {
+        for (unsigned int size : BENCH_PAYLOAD_SIZES) {
+            PacketBuilder pktBuilder = dataBuilder(size);
+            run("build_packet", size, sizeof(Packet::Header) + size, [&pktBuilder](uint64_t ops) {
+                for (uint64_t i = 0; i < ops; i++) {
+                    pktBuilder.setSqn(i);
+                    Packet pkt = pktBuilder.buildPacket();
+                    sink = pkt.header.chksum;
+                    delete[] pkt.payload;
+                }
+            });
+
+            Packet pkt = pktBuilder.buildPacket();
+            run("generate_chksum", size, sizeof(Packet::Header) + size, [&pkt](uint64_t ops) {
+                for (uint64_t i = 0; i < ops; i++) {
+                    pkt.header.sqn = (unsigned int) i;
+                    sink = PacketBuilder::generateChksum(&pkt);
+                }
+            });
+            delete[] pkt.payload;
+
+            // A client's packet opened by the server, once the SYN has brought the server the client's salt
+            vector<unsigned char> psk(CIPHER_KEY_BYTES, 'k');
+            for (CipherSuite suite : {AES_256_GCM, CHACHA20_POLY1305}) {
+                PacketCipher client(suite, psk, true), server(suite, psk, false);
+                Packet syn, wire;
+                syn.header.flags.syn = 1;
+                client.seal(syn, wire);
+                server.open(wire);
+
+                Packet data = pktBuilder.buildPacket();
+                run(suite == AES_256_GCM ? "seal_open_aes_gcm" : "seal_open_chacha20", size, sizeof(Packet::Header) + size, [&](uint64_t ops) {
+                    for (uint64_t i = 0; i < ops; i++) {
+                        client.seal(data, wire);
+                        sink = server.open(wire);
+                    }
+                });
+                delete[] data.payload;
+            }
+        }
+    }
+
+    // What sendPacket and recPacket do with the header of each packet: checksum it and copy it to the wire, then copy it
+    // back off, unwrap its sequence number and verify the checksum
+    void headerCases() {
+        Connection connection;
+        connection.sqnBits = 16;
+        connection.sqnRange = 1ULL << 16;
+
+        PacketBuilder ackBuilder;
+        ackBuilder.setSqnBits(connection.sqnBits);
+        ackBuilder.setPktSize(0);
+        ackBuilder.enableAckBit();
+        ackBuilder.emptyPayload();
+        Packet ack = ackBuilder.buildPacket();
+        delete[] ack.payload;
+        ack.payload = NULL;
+
+        char wire[sizeof(Packet::Header)];
+        run("header_encode", 0, sizeof(Packet::Header), [&](uint64_t ops) {
+            for (uint64_t i = 0; i < ops; i++) {
+                ack.header.sqn = (unsigned int) (i & (connection.sqnRange - 1));
+                ack.header.chksum = 0;
+                ack.header.chksum = PacketBuilder::generateChksum(&ack);
+                memcpy(wire, &ack.header, sizeof(Packet::Header));
+                sink = wire[0];
+            }
+        });
+
+        Packet received;
+        run("header_decode", 0, sizeof(Packet::Header), [&](uint64_t ops) {
+            for (uint64_t i = 0; i < ops; i++) {
+                memcpy(&received.header, wire, sizeof(Packet::Header));
+                received.sqn = controller.unwrapSqn(connection, received.header.sqn, i);
+
+                int chksum = received.header.chksum;
+                received.header.chksum = 0;
+                sink = received.sqn + (chksum == PacketBuilder::generateChksum(&received));
+            }
+        });
+    }
+
+    // The send loop's bookkeeping per packet: buffering it, sliding the window over its ACK, and the timeout queue it
+    // passes through
+    void windowCases() {
+        for (unsigned int wSize : BENCH_WINDOW_SIZES) {
+            Connection connection;
+            connection.wSize = wSize;
+            connection.pktBuffer.allocate(wSize);
+
+            PacketBuilder pktBuilder;
+            pktBuilder.setPktSize(0);
+            pktBuilder.emptyPayload();
+            Packet pkt = pktBuilder.buildPacket();
+            delete[] pkt.payload;
+            pkt.payload = NULL;
+
+            run("add_to_pkt_buffer", wSize, 0, [&](uint64_t ops) {
+                for (uint64_t i = 0; i < ops; i++) {
+                    pkt.sqn = i;
+                    controller.addToPktBuffer(connection, pkt);
+                }
+            });
+
+            // ACKs in order: each slides the window by one
+            run("ack_advance_in_order", wSize, 0, [&](uint64_t ops) {
+                connection.lastRec.lastAckRec = 0;
+                for (uint64_t i = 0; i < ops; i++) {
+                    uint64_t sqn = connection.lastRec.lastAckRec + 1;
+                    connection.pktBuffer.set(sqn);
+                    connection.lastRec.lastAckRec += connection.pktBuffer.advance(sqn, connection.wSize);
+                }
+                sink = connection.lastRec.lastAckRec;
+            });
+
+            // ACKs last to first: nothing slides until the oldest is ACK'd, then the whole window does at once
+            run("ack_advance_reversed", wSize, 0, [&](uint64_t ops) {
+                connection.lastRec.lastAckRec = 0;
+                for (uint64_t done = 0; done < ops; done += wSize) {
+                    uint64_t base = connection.lastRec.lastAckRec + 1;
+                    for (uint64_t sqn = base + min((uint64_t) wSize, ops - done); sqn-- > base;) {
+                        connection.pktBuffer.set(sqn);
+                        connection.lastRec.lastAckRec += connection.pktBuffer.advance(connection.lastRec.lastAckRec + 1, connection.wSize);
+                    }
+                }
+                sink = connection.lastRec.lastAckRec;
+            });
+
+            // A full window in the timeout queue; each ACK pops the oldest entry and the packet filling the window
+            // behind it is queued
+            run("timeout_queue_churn", wSize, 0, [&](uint64_t ops) {
+                connection.lastRec.lastAckRec = 0;
+                connection.timeoutQueue = queue<PacketInfo *>();
+                for (uint64_t sqn = 1; sqn <= wSize; sqn++) {
+                    connection.pktBuffer[sqn].pkt.sqn = sqn;
+                    connection.timeoutQueue.push(&connection.pktBuffer[sqn]);
+                }
+
+                for (uint64_t i = 0; i < ops; i++) {
+                    uint64_t sqn = connection.lastRec.lastAckRec + 1;
+                    connection.pktBuffer.set(sqn);
+                    connection.lastRec.lastAckRec += connection.pktBuffer.advance(sqn, connection.wSize);
+
+                    while (!connection.timeoutQueue.empty() && controller.isAcked(connection, connection.timeoutQueue.front()->pkt.sqn)) {
+                        connection.timeoutQueue.pop();
+                    }
+
+                    uint64_t next = sqn + wSize;
+                    connection.pktBuffer[next].pkt.sqn = next;
+                    connection.timeoutQueue.push(&connection.pktBuffer[next]);
+                }
+                sink = connection.timeoutQueue.size();
+            });
+
+            connection.timeoutQueue = queue<PacketInfo *>();
+        }
+    }
+
+public:
+    HotPathBench(chrono::milliseconds minTime, const string &filter) : minTime(minTime), filter(filter) {}
+
+    const vector<BenchResult> &runAll() {
+        packetCases();
+        headerCases();
+        windowCases();
+
+        return results;
+    }
+};
+
+static void printResults(const vector<BenchResult> &results, OutputFormat format) {
+    if (format == CSV) {
+        printf("name,param,ops,ns_per_op,bytes_per_sec\n");
+        for (const BenchResult &result : results) {
+            printf("%s,%lu,%lu,%.2f,%.0f\n", result.name.c_str(), result.param, result.ops, result.nsPerOp, result.bytesPerSec);
+        }
+    } else if (format == JSON) {
+        printf("[\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult &result = results[i];
+            printf("  {\"name\": \"%s\", \"param\": %lu, \"ops\": %lu, \"ns_per_op\": %.2f, \"bytes_per_sec\": %.0f}%s\n",
+                   result.name.c_str(), result.param, result.ops, result.nsPerOp, result.bytesPerSec, i + 1 < results.size() ? "," : "");
+        }
+        printf("]\n");
+    } else {
+        printf("%-24s %8s %12s %12s %14s\n", "Benchmark", "Param", "Ops", "ns/op", "MB/s");
+        for (const BenchResult &result : results) {
+            printf("%-24s %8lu %12lu %12.2f ", result.name.c_str(), result.param, result.ops, result.nsPerOp);
+            if (result.bytesPerSec > 0) printf("%14.1f\n", result.bytesPerSec / 1e6);
+            else printf("%14s\n", "-");
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    OutputFormat format = TABLE;
+    chrono::milliseconds minTime(BENCH_MIN_TIME_MS);
+    string filter;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            format = CSV;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            format = JSON;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            minTime = chrono::milliseconds(atoi(argv[++i]));
+        } else {
+            fprintf(stderr, "Usage: %s [--csv | --json] [--filter name] [--min-time ms]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    HotPathBench bench(minTime, filter);
+    printResults(bench.runAll(), format);
+
+    return 0;
+}
@@ -0,0 +1,419 @@
+//
+// Created on 10/19/26.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "InputHelper.h"
+
+#define MATRIX_PORT 9410 // loopback port the server under test listens on
+#define MATRIX_TIMEOUT_MS 200 // packet timeout the client is given, rather than one calculated from pings
+#define MATRIX_CELL_LIMIT_S 300 // a cell still running after this long is killed and reported as failed
+#define MATRIX_LISTEN_WAIT_MS 5000 // how long the server is given to start listening
+#define MATRIX_DEDUP_INSERT 777 // bytes inserted into the file re-sent under --dedup, shifting every chunk after them
+
+using namespace std;
+
+enum OutputFormat {
+    CSV, JSON
+};
+
+struct MatrixCell {
+    string protocol;
+    unsigned int wSize;
+    unsigned int pktSizeKB;
+    unsigned int sqnBits;
+    double damageProb;
+    double lostProb;
+    uint64_t fileBytes;
+};
+
+struct CellResult {
+    MatrixCell cell;
+    bool ok; // both ends exited cleanly and the file arrived intact
+    uint64_t elapsedMs;
+    uint64_t originalPkts;
+    uint64_t resentPkts;
+    double clientCpuMs, serverCpuMs;
+    long clientRssKB, serverRssKB;
+};
+
+struct ProcessResult {
+    bool exited; // exited with status 0, rather than failing or being killed
+    double cpuMs; // user and system time
+    long maxRssKB;
+};
+
+struct TransferResult {
+    bool ok;
+    ProcessResult client, server;
+    string clientLog;
+};
+
+// Comma separated values of an option, each converted by parse
+template<typename T, typename Parse>
+static vector<T> parseList(const string &list, Parse parse) {
+    vector<T> values;
+    stringstream stream(list);
+    string value;
+    while (getline(stream, value, ',')) {
+        if (!value.empty()) values.push_back(parse(value));
+    }
+
+    return values;
+}
+
+static double cpuMs(const struct rusage &usage) {
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e3;
+}
+
+// Starts bin with args, its output going to logPath
+static pid_t spawn(const string &bin, const vector<string> &args, const string &logPath) {
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    int log = open(logPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int null = open("/dev/null", O_RDONLY);
+    if (log < 0 || null < 0) _exit(127);
+    dup2(null, STDIN_FILENO);
+    dup2(log, STDOUT_FILENO);
+    dup2(log, STDERR_FILENO);
+
+    vector<char *> argv{const_cast<char *>(bin.c_str())};
+    for (const string &arg : args) argv.push_back(const_cast<char *>(arg.c_str()));
+    argv.push_back(NULL);
+
+    execv(bin.c_str(), argv.data());
+    _exit(127);
+}
+
+// Waits for a process to exit, killing it if it's still running at the deadline
+static ProcessResult reap(pid_t pid, chrono::steady_clock::time_point deadline) {
+    int status = 0;
+    struct rusage usage{};
+
+    while (wait4(pid, &status, WNOHANG, &usage) == 0) {
+        if (chrono::steady_clock::now() >= deadline) {
+            kill(pid, SIGKILL);
+            wait4(pid, &status, 0, &usage);
+            break;
+        }
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    return {WIFEXITED(status) && WEXITSTATUS(status) == 0, cpuMs(usage), usage.ru_maxrss};
+}
+
+// Whether anything is listening on a TCP port, going by the kernel's socket table
+static bool listening(unsigned int port) {
+    for (const char *table : {"/proc/net/tcp", "/proc/net/tcp6"}) {
+        ifstream sockets(table);
+        string line;
+        getline(sockets, line); // column headings
+
+        while (getline(sockets, line)) {
+            char local[64];
+            unsigned int localPort, state;
+            if (sscanf(line.c_str(), "%*d: %63[0-9A-Fa-f]:%x %*[0-9A-Fa-f]:%*x %x", local, &localPort, &state) == 3 &&
+                    localPort == port && state == 0x0A) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Last value printed after label in a log, or empty if it never was
+static string logValue(const string &logPath, const string &label) {
+    ifstream log(logPath);
+    string line, value;
+    while (getline(log, line)) {
+        size_t at = line.find(label);
+        if (at != string::npos) value = line.substr(at + label.size());
+    }
+
+    return value;
+}
+
+static uint64_t logNumber(const string &logPath, const string &label) {
+    string value = logValue(logPath, label);
+    return value.empty() ? 0 : stoull(value);
+}
+
+/* Runs the real client and server against each other over loopback for every combination of the settings swept, one
+ * transfer per cell. The client's own report gives the elapsed time and packet counts, the kernel gives each process'
+ * CPU time and peak resident set, and the MD5 each end prints of the file confirms it arrived intact. Under --dedup each
+ * cell first fills a chunk store with the file, then sends a modified copy against it.
+ */
+class ThroughputMatrix {
+    string bin;
+    string workDir;
+    unsigned int port;
+    unsigned int timeoutMs;
+    bool dedup;
+    vector<string> extraArgs; // passed to the client as given
+
+    string inputFile(uint64_t bytes) {
+        string path = workDir + "/input_" + to_string(bytes);
+        struct stat fileStat{};
+        if (stat(path.c_str(), &fileStat) == 0) return path;
+
+        // Random, so compression or dedup given in the extra arguments find nothing to save
+        mt19937_64 random(bytes);
+        vector<uint64_t> block(8192);
+        FILE *file = fopen(path.c_str(), "wb");
+        for (uint64_t written = 0; written < bytes;) {
+            for (uint64_t &word : block) word = random();
+            size_t length = (size_t) min((uint64_t) (block.size() * sizeof(uint64_t)), bytes - written);
+            fwrite(block.data(), sizeof(char), length, file);
+            written += length;
+        }
+        fclose(file);
+
+        return path;
+    }
+
+    // The input with bytes inserted at its start and middle, so most of its chunks are in the store but none where they were
+    string modifiedFile(uint64_t bytes) {
+        string input = inputFile(bytes), path = workDir + "/modified_" + to_string(bytes);
+        struct stat fileStat{};
+        if (stat(path.c_str(), &fileStat) == 0) return path;
+
+        vector<char> data(bytes), inserted(MATRIX_DEDUP_INSERT, '#');
+        FILE *file = fopen(input.c_str(), "rb");
+        data.resize(fread(data.data(), sizeof(char), data.size(), file));
+        fclose(file);
+
+        file = fopen(path.c_str(), "wb");
+        fwrite(inserted.data(), sizeof(char), inserted.size(), file);
+        fwrite(data.data(), sizeof(char), data.size() / 2, file);
+        fwrite(inserted.data(), sizeof(char), inserted.size(), file);
+        fwrite(data.data() + data.size() / 2, sizeof(char), data.size() - data.size() / 2, file);
+        fclose(file);
+
+        return path;
+    }
+
+    // Sends input from the client to the server, logging each to logPrefix.client.log and logPrefix.server.log
+    TransferResult transfer(const MatrixCell &cell, const string &input, const string &logPrefix, const string &storeDir) {
+        string outDir = workDir + "/out/";
+        string received = outDir + input.substr(input.find_last_of('/') + 1);
+        string serverLog = logPrefix + ".server.log";
+        string clientLog = logPrefix + ".client.log";
+        mkdir(outDir.c_str(), 0755);
+        remove(received.c_str());
+
+        // The server decides the protocol settings and sends them to the client in the handshake; both are given them
+        vector<string> settings{cell.protocol == "gbn" ? "--gbn" : "--sr", "--pkt", to_string(cell.pktSizeKB),
+                                "--wsize", to_string(cell.wSize), "--sqn", to_string(cell.sqnBits)};
+
+        auto deadline = chrono::steady_clock::now() + chrono::seconds(MATRIX_CELL_LIMIT_S);
+        vector<string> serverArgs{"--server", "--no-prompt", "--once", "--port", to_string(port), "--fp", outDir};
+        serverArgs.insert(serverArgs.end(), settings.begin(), settings.end());
+        if (dedup) serverArgs.insert(serverArgs.end(), {"--store", storeDir});
+        pid_t server = spawn(bin, serverArgs, serverLog);
+
+        auto listenDeadline = chrono::steady_clock::now() + chrono::milliseconds(MATRIX_LISTEN_WAIT_MS);
+        while (!listening(port) && chrono::steady_clock::now() < listenDeadline) {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+
+        vector<string> args{"--no-prompt", "--ip", "127.0.0.1", "--port", to_string(port), "--file", input, "--ti", to_string(timeoutMs)};
+        args.insert(args.end(), settings.begin(), settings.end());
+        if (cell.damageProb > 0) args.insert(args.end(), {"--dp", to_string(cell.damageProb)});
+        if (cell.lostProb > 0) args.insert(args.end(), {"--lp", to_string(cell.lostProb)});
+        if (dedup) args.push_back("--dedup");
+        args.insert(args.end(), extraArgs.begin(), extraArgs.end());
+
+        pid_t client = spawn(bin, args, clientLog);
+        ProcessResult clientResult = reap(client, deadline);
+        // A server whose client never reached it is still waiting for one
+        ProcessResult serverResult = reap(server, clientResult.exited ? deadline : chrono::steady_clock::now());
+
+        string sentMd5 = logValue(clientLog, "MD5: "), receivedMd5 = logValue(serverLog, "MD5: ");
+        bool ok = clientResult.exited && serverResult.exited && !sentMd5.empty() && sentMd5 == receivedMd5;
+        remove(received.c_str());
+
+        return {ok, clientResult, serverResult, clientLog};
+    }
+
+public:
+    ThroughputMatrix(const string &bin, const string &workDir, unsigned int port, unsigned int timeoutMs, bool dedup,
+                     const vector<string> &extraArgs)
+            : bin(bin), workDir(workDir), port(port), timeoutMs(timeoutMs), dedup(dedup), extraArgs(extraArgs) {}
+
+    CellResult run(const MatrixCell &cell, size_t index) {
+        string logPrefix = workDir + "/cell" + to_string(index);
+        string input = inputFile(cell.fileBytes), storeDir = logPrefix + ".store";
+
+        // The cell measures the modified copy's transfer, which only passes if it's assembled right from the store
+        if (dedup) {
+            TransferResult seed = transfer(cell, input, logPrefix + ".seed", storeDir);
+            if (!seed.ok) return {cell, false, 0, 0, 0, 0, 0, 0, 0};
+            input = modifiedFile(cell.fileBytes);
+        }
+
+        TransferResult result = transfer(cell, input, logPrefix, storeDir);
+        string clientLog = result.clientLog;
+        uint64_t resent = logNumber(clientLog, "Number of retransmitted packets: ");
+        return {cell, result.ok, logNumber(clientLog, "Total elapsed time (ms): "), logNumber(clientLog, "Number of original packets sent: "),
+                resent, result.client.cpuMs, result.server.cpuMs, result.client.maxRssKB, result.server.maxRssKB};
+    }
+};
+
+static double goodputMbps(const CellResult &result) {
+    if (!result.ok || result.elapsedMs == 0) return 0;
+    return result.cell.fileBytes * 8 / (result.elapsedMs / 1e3) / 1e6;
+}
+
+static double retransmitRatio(const CellResult &result) {
+    return result.originalPkts == 0 ? 0 : (double) result.resentPkts / result.originalPkts;
+}
+
+static void printResult(const CellResult &result, OutputFormat format, bool last) {
+    const MatrixCell &cell = result.cell;
+    if (format == CSV) {
+        printf("%s,%u,%u,%u,%g,%g,%lu,%d,%lu,%.2f,%lu,%lu,%.4f,%.0f,%.0f,%ld,%ld\n", cell.protocol.c_str(), cell.wSize,
+               cell.pktSizeKB, cell.sqnBits, cell.damageProb, cell.lostProb, cell.fileBytes, result.ok, result.elapsedMs,
+               goodputMbps(result), result.originalPkts, result.resentPkts, retransmitRatio(result), result.clientCpuMs,
+               result.serverCpuMs, result.clientRssKB, result.serverRssKB);
+    } else {
+        printf("  {\"protocol\": \"%s\", \"wsize\": %u, \"pkt_kb\": %u, \"sqn_bits\": %u, \"damage\": %g, \"loss\": %g, "
+               "\"file_bytes\": %lu, \"ok\": %s, \"elapsed_ms\": %lu, \"goodput_mbps\": %.2f, \"original_pkts\": %lu, "
+               "\"resent_pkts\": %lu, \"retransmit_ratio\": %.4f, \"client_cpu_ms\": %.0f, \"server_cpu_ms\": %.0f, "
+               "\"client_rss_kb\": %ld, \"server_rss_kb\": %ld}%s\n", cell.protocol.c_str(), cell.wSize, cell.pktSizeKB,
+               cell.sqnBits, cell.damageProb, cell.lostProb, cell.fileBytes, result.ok ? "true" : "false", result.elapsedMs,
+               goodputMbps(result), result.originalPkts, result.resentPkts, retransmitRatio(result), result.clientCpuMs,
+               result.serverCpuMs, result.clientRssKB, result.serverRssKB, last ? "" : ",");
+    }
+    fflush(stdout);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--csv | --json] [--dedup] [--bin path] [--port n] [--ti ms] [--repeat n] [--protocols sr,gbn]\n"
+                    "       [--wsizes 8,64] [--pkt-sizes kb,...] [--sqn-bits 16,...] [--damage p,...] [--loss p,...]\n"
+                    "       [--file-sizes 1M,...] [-- client arguments...]\n", name);
+}
+
+int main(int argc, char *argv[]) {
+    OutputFormat format = CSV;
+    string bin = SLIDING_WINDOW_BIN;
+    unsigned int port = MATRIX_PORT, timeoutMs = MATRIX_TIMEOUT_MS, repeat = 1;
+    bool dedup = false;
+    auto toUnsigned = [](const string &value) { return (unsigned int) stoul(value); };
+    auto toDouble = [](const string &value) { return stod(value); };
+    vector<string> protocols{"sr", "gbn"}, extraArgs;
+    vector<unsigned int> wSizes{8, 64}, pktSizes{1}, sqnBits{16};
+    vector<double> damageProbs{0}, lostProbs{0, 0.01};
+    vector<uint64_t> fileSizes{1 << 20};
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            string option = argv[i];
+            if (option == "--csv") {
+                format = CSV;
+            } else if (option == "--json") {
+                format = JSON;
+            } else if (option == "--dedup") {
+                dedup = true;
+            } else if (option == "--") {
+                extraArgs.assign(argv + i + 1, argv + argc);
+                break;
+            } else if (i + 1 >= argc) {
+                usage(argv[0]);
+                return -1;
+            } else if (option == "--bin") {
+                bin = argv[++i];
+            } else if (option == "--port") {
+                port = toUnsigned(argv[++i]);
+            } else if (option == "--ti") {
+                timeoutMs = toUnsigned(argv[++i]);
+            } else if (option == "--repeat") {
+                repeat = toUnsigned(argv[++i]);
+            } else if (option == "--protocols") {
+                protocols = parseList<string>(argv[++i], [](const string &value) { return value; });
+            } else if (option == "--wsizes") {
+                wSizes = parseList<unsigned int>(argv[++i], toUnsigned);
+            } else if (option == "--pkt-sizes") {
+                pktSizes = parseList<unsigned int>(argv[++i], toUnsigned);
+            } else if (option == "--sqn-bits") {
+                sqnBits = parseList<unsigned int>(argv[++i], toUnsigned);
+            } else if (option == "--damage") {
+                damageProbs = parseList<double>(argv[++i], toDouble);
+            } else if (option == "--loss") {
+                lostProbs = parseList<double>(argv[++i], toDouble);
+            } else if (option == "--file-sizes") {
+                fileSizes = parseList<uint64_t>(argv[++i], InputHelper::parseSize);
+            } else {
+                usage(argv[0]);
+                return -1;
+            }
+        }
+    } catch (logic_error &e) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    const char *tmpDir = getenv("TMPDIR");
+    string workDir = string(tmpDir != NULL && *tmpDir != '\0' ? tmpDir : "/tmp") + "/sliding_window_matrix.XXXXXX";
+    if (mkdtemp(&workDir[0]) == NULL) {
+        fprintf(stderr, "Unable to create a working directory\nError #: %d\n", errno);
+        return -1;
+    }
+
+    vector<MatrixCell> cells;
+    for (const string &protocol : protocols)
+        for (unsigned int wSize : wSizes)
+            for (unsigned int pktSize : pktSizes)
+                for (unsigned int bits : sqnBits)
+                    for (double damageProb : damageProbs)
+                        for (double lostProb : lostProbs)
+                            for (uint64_t fileSize : fileSizes)
+                                for (unsigned int r = 0; r < repeat; r++)
+                                    cells.push_back({protocol, wSize, pktSize, bits, damageProb, lostProb, fileSize});
+
+    if (format == CSV) {
+        printf("protocol,wsize,pkt_kb,sqn_bits,damage,loss,file_bytes,ok,elapsed_ms,goodput_mbps,original_pkts,"
+               "resent_pkts,retransmit_ratio,client_cpu_ms,server_cpu_ms,client_rss_kb,server_rss_kb\n");
+    } else {
+        printf("[\n");
+    }
+
+    ThroughputMatrix matrix(bin, workDir, port, timeoutMs, dedup, extraArgs);
+    bool allOk = true;
+    for (size_t i = 0; i < cells.size(); i++) {
+        CellResult result = matrix.run(cells[i], i + 1);
+        if (!result.ok) {
+            fprintf(stderr, "Cell %lu failed; its logs are in %s\n", i + 1, workDir.c_str());
+            allOk = false;
+        }
+        printResult(result, format, i + 1 == cells.size());
+    }
+
+    if (format == JSON) printf("]\n");
+
+    // Logs are kept when something failed
+    if (allOk) {
+        string cleanup = "rm -rf '" + workDir + "'";
+        if (system(cleanup.c_str()) != 0) fprintf(stderr, "Unable to remove %s\n", workDir.c_str());
+    }
+
+    return allOk ? 0 : 1;
+}
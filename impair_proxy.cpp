@@ -0,0 +1,239 @@
+//
+// Created on 10/19/26.
+//
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Impairment.h"
+
+#define PROXY_PORT 9430 // loopback port the proxy listens on
+#define PROXY_READ_BYTES (256 << 10) // read from a socket at a time
+
+using namespace std;
+
+enum Direction {
+    UP, DOWN // client to server, server to client
+};
+
+static int64_t nowUs() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool writeAll(int fd, const char *bytes, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        bytes += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+// Relays the frames read from one socket to the other, each at the time its impairments release it
+static void relay(int from, int to, ImpairmentModel &model) {
+    FrameQueue frames;
+    vector<char> pending, buffer(PROXY_READ_BYTES);
+    bool open = true;
+
+    while (open || !frames.empty()) {
+        struct timespec wait{};
+        struct timespec *timeout = NULL;
+        if (!frames.empty()) {
+            int64_t waitUs = max((int64_t) 0, frames.top().release - nowUs());
+            wait.tv_sec = waitUs / 1000000;
+            wait.tv_nsec = (waitUs % 1000000) * 1000;
+            timeout = &wait;
+        }
+
+        struct pollfd readable{from, POLLIN, 0};
+        int ready = ppoll(&readable, open ? 1 : 0, timeout, NULL);
+        if (ready < 0 && errno != EINTR) break;
+
+        if (ready > 0) {
+            ssize_t bytesRead = read(from, buffer.data(), buffer.size());
+            if (bytesRead <= 0) {
+                open = false;
+            } else {
+                pending.insert(pending.end(), buffer.begin(), buffer.begin() + bytesRead);
+            }
+
+            // Split off every whole frame: a header, then the payload it describes
+            int64_t arrival = nowUs();
+            ImpairmentModel::splitFrames(pending, [&](vector<char> frame) { model.apply(move(frame), arrival, frames); });
+        }
+
+        int64_t now = nowUs();
+        while (!frames.empty() && frames.top().release <= now) {
+            if (!writeAll(to, frames.top().bytes.data(), frames.top().bytes.size())) {
+                // The receiving end has gone, so stop reading from the sending one too
+                shutdown(from, SHUT_RDWR);
+                return;
+            }
+            frames.pop();
+        }
+    }
+
+    shutdown(to, SHUT_WR);
+}
+
+static void printStats(unsigned int connection, const char *direction, const DirectionStats &stats) {
+    printf("Connection %u %s: %lu frames, %lu lost (%lu bursts), %lu damaged, %lu duplicated, %lu reordered, %lu dropped by the queue\n",
+           connection, direction, stats.frames, stats.lost, stats.bursts, stats.damaged, stats.duplicated, stats.reordered,
+           stats.queueDrops);
+    fflush(stdout);
+}
+
+static void proxyConnection(int clientFd, const struct sockaddr_in &upstream, unsigned int connection, uint64_t seed,
+                            const Impairments &impairments, bool impairUp, bool impairDown) {
+    Impairments none;
+    int serverFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (serverFd < 0 || connect(serverFd, (struct sockaddr *) &upstream, sizeof(upstream)) < 0) {
+        fprintf(stderr, "Unable to connect to the server\nError #: %d\n", errno);
+        if (serverFd >= 0) close(serverFd);
+        close(clientFd);
+        return;
+    }
+
+    // Frames are written whole, the moment they're released
+    int noDelay = 1;
+    setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    setsockopt(serverFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    seed_seq upSeed{seed, (uint64_t) connection, (uint64_t) UP}, downSeed{seed, (uint64_t) connection, (uint64_t) DOWN};
+    ImpairmentModel up(impairUp ? impairments : none, upSeed), down(impairDown ? impairments : none, downSeed);
+
+    thread upstreamRelay(relay, clientFd, serverFd, ref(up));
+    relay(serverFd, clientFd, down);
+    upstreamRelay.join();
+
+    close(serverFd);
+    close(clientFd);
+    printStats(connection, "client->server", up.stats);
+    printStats(connection, "server->client", down.stats);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s --to ip:port [--port n] [--once] [--seed n] [--dir up|down|both] [--loss p]\n"
+                    "       [--burst p-enter,p-leave[,p-loss]] [--damage p] [--delay ms] [--jitter ms] [--reorder p]\n"
+                    "       [--reorder-gap ms] [--duplicate p] [--rate mbps] [--queue bytes]\n", name);
+}
+
+int main(int argc, char *argv[]) {
+    Impairments impairments;
+    unsigned int port = PROXY_PORT;
+    uint64_t seed = 1;
+    bool once = false, impairUp = true, impairDown = true;
+    string target;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            string option = argv[i];
+            if (option == "--once") {
+                once = true;
+            } else if (i + 1 >= argc) {
+                usage(argv[0]);
+                return -1;
+            } else if (option == "--to") {
+                target = argv[++i];
+            } else if (option == "--port") {
+                port = (unsigned int) stoul(argv[++i]);
+            } else if (option == "--seed") {
+                seed = stoull(argv[++i]);
+            } else if (option == "--dir") {
+                string dir = argv[++i];
+                impairUp = dir != "down";
+                impairDown = dir != "up";
+            } else if (option == "--loss") {
+                impairments.goodLoss = stod(argv[++i]);
+            } else if (option == "--burst") {
+                string burst = argv[++i];
+                size_t first = burst.find(','), second = burst.find(',', first + 1);
+                impairments.goodToBad = stod(burst.substr(0, first));
+                impairments.badToGood = stod(burst.substr(first + 1));
+                if (second != string::npos) impairments.badLoss = stod(burst.substr(second + 1));
+            } else if (option == "--damage") {
+                impairments.damage = stod(argv[++i]);
+            } else if (option == "--delay") {
+                impairments.delayMs = stod(argv[++i]);
+            } else if (option == "--jitter") {
+                impairments.jitterMs = stod(argv[++i]);
+            } else if (option == "--reorder") {
+                impairments.reorder = stod(argv[++i]);
+            } else if (option == "--reorder-gap") {
+                impairments.reorderGapMs = stod(argv[++i]);
+            } else if (option == "--duplicate") {
+                impairments.duplicate = stod(argv[++i]);
+            } else if (option == "--rate") {
+                impairments.rateMbps = stod(argv[++i]);
+            } else if (option == "--queue") {
+                impairments.queueBytes = stoull(argv[++i]);
+            } else {
+                usage(argv[0]);
+                return -1;
+            }
+        }
+    } catch (logic_error &e) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    struct sockaddr_in upstream{};
+    size_t colon = target.rfind(':');
+    upstream.sin_family = AF_INET;
+    if (colon == string::npos || inet_pton(AF_INET, target.substr(0, colon).c_str(), &upstream.sin_addr) != 1) {
+        usage(argv[0]);
+        return -1;
+    }
+    upstream.sin_port = htons((uint16_t) stoul(target.substr(colon + 1)));
+
+    // A peer vanishing mid-write is reported by write() rather than ending the proxy
+    signal(SIGPIPE, SIG_IGN);
+
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((uint16_t) port);
+    if (bind(listenFd, (struct sockaddr *) &address, sizeof(address)) < 0 || listen(listenFd, 8) < 0) {
+        fprintf(stderr, "Unable to listen on port %u\nError #: %d\n", port, errno);
+        return -1;
+    }
+    printf("Relaying 127.0.0.1:%u to %s\n", port, target.c_str());
+    fflush(stdout);
+
+    for (unsigned int connection = 0;; connection++) {
+        int clientFd = accept(listenFd, NULL, NULL);
+        if (clientFd < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Unable to accept a connection\nError #: %d\n", errno);
+            return -1;
+        }
+
+        if (once) {
+            proxyConnection(clientFd, upstream, connection, seed, impairments, impairUp, impairDown);
+            break;
+        }
+        thread(proxyConnection, clientFd, upstream, connection, seed, impairments, impairUp, impairDown).detach();
+    }
+
+    close(listenFd);
+    return 0;
+}
@@ -4,6 +4,7 @@
 
 #include "ApplicationState.h"
 #include "ConnectionController.h"
+#include "GaloisField.h"
 #include "InputHelper.h"
 
 
@@ -16,6 +17,7 @@ int main(int argc, char *argv[]) {
 
     InputHelper::parseArgs(argc, argv, &appState);
     InputHelper::promptForParameters(&appState);
+    if (!appState.tracePath.empty()) Tracer::level = appState.traceLevel;
 
     if (appState.verbose) {
         printf("-----\n");
@@ -32,7 +34,14 @@ int main(int argc, char *argv[]) {
         }
 
         printf("Port: %i\n", appState.connectionSettings.port);
-        printf("File path: %s\n", appState.filePath.c_str());
+        if (appState.filePaths.size() > 1) {
+            printf("File paths: \n");
+            for (auto &filePath : appState.filePaths) {
+                printf("\t%s\n", filePath.c_str());
+            }
+        } else {
+            printf("File path: %s\n", appState.filePath.c_str());
+        }
 
         switch(appState.connectionSettings.protocol) {
             case GBN:
@@ -55,8 +64,46 @@ int main(int argc, char *argv[]) {
         }
 
         printf("Window size: %i\n", appState.connectionSettings.wSize);
+
+        switch(appState.connectionSettings.congestionAlgorithm) {
+            case CUBIC:
+                printf("Congestion control: CUBIC\n");
+                break;
+            case RENO:
+                printf("Congestion control: Reno\n");
+                break;
+            default:
+                printf("Congestion control: None\n");
+                break;
+        }
+
+        printf("Pacing: %s\n", appState.connectionSettings.pacing ? "ON" : "OFF");
+        if (appState.connectionSettings.rateLimit > 0) printf("Rate cap (Mbps): %g\n", appState.connectionSettings.rateLimit);
+        if (appState.connectionSettings.processRateLimit > 0) printf("Process rate cap (Mbps): %g\n", appState.connectionSettings.processRateLimit);
+        if (appState.connectionSettings.fecData > 0) {
+            printf("FEC: %u data + %u parity packets per block (%s)\n", appState.connectionSettings.fecData, appState.connectionSettings.fecParity, GaloisField::kernel());
+        } else {
+            printf("FEC: OFF\n");
+        }
+        if (appState.connectionSettings.compression == DEFLATE) {
+            printf("Compression: deflate (%u threads)\n", appState.connectionSettings.compressionThreads);
+        } else {
+            printf("Compression: OFF\n");
+        }
+        printf("Delta transfer: %s\n", appState.connectionSettings.delta ? "ON" : "OFF");
+        printf("Dedup: %s\n", appState.connectionSettings.dedup ? "ON" : "OFF");
+        const char *ioModes[] = {"buffered", "direct", "sync"};
+        printf("File I/O: %s%s\n", ioModes[appState.connectionSettings.ioMode], appState.connectionSettings.ackDurable ? ", ACK after durable" : "");
+        printf("Encryption: %s\n", appState.connectionSettings.psk.empty() ? "OFF" : cipherName(appState.connectionSettings.cipher));
+        if (!appState.connectionSettings.storePath.empty()) printf("Chunk store: %s\n", appState.connectionSettings.storePath.c_str());
+        if (!appState.tracePath.empty()) printf("Trace file: %s (level %d)\n", appState.tracePath.c_str(), appState.traceLevel);
+        if (!appState.connectionSettings.statsPath.empty()) printf("Stats file: %s\n", appState.connectionSettings.statsPath.c_str());
+        if (!appState.connectionSettings.metricsSocket.empty()) printf("Metrics socket: %s\n", appState.connectionSettings.metricsSocket.c_str());
+        printf("Fast start: %s\n", appState.connectionSettings.fastStart ? "ON" : "OFF");
+        printf("TCP Fast Open: %s\n", appState.connectionSettings.tcpFastOpen ? "ON" : "OFF");
+        printf("Adaptive packet size: %s\n", appState.connectionSettings.adaptivePktSize ? "ON" : "OFF");
         printf("Sequence bits: %i\n", appState.connectionSettings.sqnBits);
-        printf("Sequence range: %i\n", appState.connectionSettings.sqnRange);
+        printf("Sequence range: %lu\n", appState.connectionSettings.sqnRange);
         printf("Damage probability: %g\n", appState.connectionSettings.damageProb);
         printf("Lost probability: %g\n", appState.connectionSettings.lostProb);
 
@@ -0,0 +1,264 @@
+//
+// Created on 10/19/26.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ApplicationState.h"
+#include "ConnectionController.h"
+#include "InputHelper.h"
+#include "SimulatedLink.h"
+
+#define SIM_RTT_MS 200 // round trip time of the simulated link
+#define SIM_RATE_MBPS 1000 // its bandwidth, each way
+#define SIM_FILE_SIZE "100M" // of the file sent
+#define SIM_FILE_NAME "simulated" // it's sent as
+#define SIM_INTERVAL_MS 1000 // virtual time between samples
+#define SIM_TTL_MS 30000 // how long the server waits on a silent client
+#define SIM_START_US 1000000000000 // virtual time the transfer starts at; any time later than 0 would do
+
+using namespace std;
+
+static double cpuMs(const struct rusage &usage) {
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e3;
+}
+
+static double mbps(uint64_t bytes, int64_t us) {
+    return us > 0 ? bytes * 8.0 / us : 0;
+}
+
+// The data sent: zeros, made up as they're read, so a transfer of any size needs neither memory nor disk
+struct ZeroSource {
+    uint64_t size;
+    uint64_t position;
+};
+
+static ssize_t readZeros(void *cookie, char *buffer, size_t size) {
+    auto *source = (ZeroSource *) cookie;
+    size_t length = (size_t) min((uint64_t) size, source->size - min(source->position, source->size));
+    memset(buffer, 0, length);
+    source->position += length;
+    return (ssize_t) length;
+}
+
+static int seekZeros(void *cookie, off64_t *offset, int whence) {
+    auto *source = (ZeroSource *) cookie;
+    int64_t base = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? (int64_t) source->position : (int64_t) source->size;
+    if (base + *offset < 0) return -1;
+
+    source->position = (uint64_t) (base + *offset);
+    *offset = (off64_t) source->position;
+    return 0;
+}
+
+static int closeZeros(void *cookie) {
+    delete (ZeroSource *) cookie;
+    return 0;
+}
+
+// Parses the arguments one end of the transfer would be started with into its state, and has it send zeros (client) or
+// throw away what it receives (server) rather than use files
+static void configure(ApplicationState &appState, const vector<string> &args, uint64_t fileBytes, FILE *log) {
+    vector<char *> argv{const_cast<char *>("sliding_window")};
+    for (const string &arg : args) argv.push_back(const_cast<char *>(arg.c_str()));
+
+    InputHelper::parseArgs((int) argv.size(), argv.data(), &appState);
+    if (appState.role == SERVER) {
+        appState.filePath = "./";
+    } else {
+        appState.filePath = appState.fileName = SIM_FILE_NAME;
+        appState.filePaths = {SIM_FILE_NAME};
+    }
+    InputHelper::promptForParameters(&appState);
+
+    appState.console = log;
+    appState.streams.openSource = [fileBytes](const string &, uint64_t &size) {
+        size = fileBytes;
+        return fopencookie(new ZeroSource{fileBytes, 0}, "rb", cookie_io_functions_t{readZeros, NULL, seekZeros, closeZeros});
+    };
+    appState.streams.openSink = [](const string &) { return fopen("/dev/null", "wb"); };
+}
+
+// The running totals a sample is the difference of
+struct Totals {
+    uint64_t sentBytes = 0, receivedBytes = 0, retransmits = 0, rtos = 0, lost = 0, queueDrops = 0;
+};
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--size bytes] [--rtt ms] [--rate mbps] [--queue bytes] [--dir up|down|both] [--loss p]\n"
+                    "       [--burst p-enter,p-leave[,p-loss]] [--damage p] [--jitter ms] [--reorder p] [--reorder-gap ms]\n"
+                    "       [--duplicate p] [--seed n] [--interval ms] [--ttl ms] [--csv] [--log path] [-- sliding_window args...]\n", name);
+}
+
+int main(int argc, char *argv[]) {
+    Impairments impairments;
+    double rttMs = SIM_RTT_MS, rateMbps = SIM_RATE_MBPS, intervalMs = SIM_INTERVAL_MS;
+    uint64_t fileBytes = InputHelper::parseSize(SIM_FILE_SIZE), seed = 1, queueBytes = 0, ttlMs = SIM_TTL_MS;
+    bool csv = false, impairUp = true, impairDown = true;
+    string logPath = "/dev/null";
+    vector<string> extraArgs;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            string option = argv[i];
+            if (option == "--") {
+                extraArgs.assign(argv + i + 1, argv + argc);
+                break;
+            } else if (option == "--csv") {
+                csv = true;
+            } else if (i + 1 >= argc) {
+                usage(argv[0]);
+                return -1;
+            } else if (option == "--size") {
+                fileBytes = InputHelper::parseSize(argv[++i]);
+            } else if (option == "--rtt") {
+                rttMs = stod(argv[++i]);
+            } else if (option == "--rate") {
+                rateMbps = stod(argv[++i]);
+            } else if (option == "--queue") {
+                queueBytes = stoull(argv[++i]);
+            } else if (option == "--dir") {
+                string dir = argv[++i];
+                impairUp = dir != "down";
+                impairDown = dir != "up";
+            } else if (option == "--loss") {
+                impairments.goodLoss = stod(argv[++i]);
+            } else if (option == "--burst") {
+                string burst = argv[++i];
+                size_t first = burst.find(','), second = burst.find(',', first + 1);
+                impairments.goodToBad = stod(burst.substr(0, first));
+                impairments.badToGood = stod(burst.substr(first + 1));
+                if (second != string::npos) impairments.badLoss = stod(burst.substr(second + 1));
+            } else if (option == "--damage") {
+                impairments.damage = stod(argv[++i]);
+            } else if (option == "--jitter") {
+                impairments.jitterMs = stod(argv[++i]);
+            } else if (option == "--reorder") {
+                impairments.reorder = stod(argv[++i]);
+            } else if (option == "--reorder-gap") {
+                impairments.reorderGapMs = stod(argv[++i]);
+            } else if (option == "--duplicate") {
+                impairments.duplicate = stod(argv[++i]);
+            } else if (option == "--seed") {
+                seed = stoull(argv[++i]);
+            } else if (option == "--interval") {
+                intervalMs = stod(argv[++i]);
+            } else if (option == "--ttl") {
+                ttlMs = stoull(argv[++i]);
+            } else if (option == "--log") {
+                logPath = argv[++i];
+            } else {
+                usage(argv[0]);
+                return -1;
+            }
+        }
+    } catch (logic_error &e) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    // The link's delay is half the round trip each way, and its queue holds a bandwidth-delay product unless told otherwise
+    Impairments up = impairUp ? impairments : Impairments(), down = impairDown ? impairments : Impairments();
+    for (Impairments *direction : {&up, &down}) {
+        direction->delayMs = rttMs / 2;
+        direction->rateMbps = rateMbps;
+        direction->queueBytes = queueBytes > 0 ? queueBytes : max((uint64_t) IMPAIR_QUEUE_BYTES, (uint64_t) (rateMbps * rttMs * 1e3 / 8));
+    }
+
+    // Both ends report what they're doing to the log, leaving stdout to the curves
+    FILE *log = fopen(logPath.c_str(), "w");
+    if (log == NULL) {
+        fprintf(stderr, "Unable to open %s\n", logPath.c_str());
+        return -1;
+    }
+
+    // Arguments after -- go to both ends; the client's packet timeout defaults to a few round trips
+    ApplicationState clientState{}, serverState{};
+    vector<string> clientArgs{"--no-prompt", "--ip", "127.0.0.1", "--ti", to_string((unsigned long) (3 * rttMs))};
+    vector<string> serverArgs{"--server", "--no-prompt"};
+    clientArgs.insert(clientArgs.end(), extraArgs.begin(), extraArgs.end());
+    serverArgs.insert(serverArgs.end(), extraArgs.begin(), extraArgs.end());
+    serverArgs.insert(serverArgs.end(), {"--ti", to_string(ttlMs)});
+    ConnectionController client(clientState), server(serverState);
+
+    // The argument parser prints its prompts even when it takes the defaults without asking, so they go to the log too
+    fflush(stdout);
+    int savedStdout = dup(STDOUT_FILENO);
+    dup2(fileno(log), STDOUT_FILENO);
+    configure(clientState, clientArgs, fileBytes, log);
+    configure(serverState, serverArgs, fileBytes, log);
+    fflush(stdout);
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+
+    SimulatedLink link(up, down, seed, SIM_START_US);
+    Totals last;
+    int64_t intervalUs = (int64_t) (intervalMs * 1e3);
+
+    if (csv) printf("time_s,sent_mbps,goodput_mbps,retransmits,rtos,window,lost,queue_drops\n");
+    else printf("%9s %10s %13s %11s %6s %7s %6s %11s\n", "time (s)", "sent Mbps", "goodput Mbps", "retransmits", "rtos",
+                "window", "lost", "queue drops");
+    fflush(stdout);
+
+    // Sampled as virtual time passes, so the curves are of the simulated transfer however long it takes to run
+    link.sampleEvery(intervalUs, [&](int64_t now, const DirectionStats &upStats, const DirectionStats &downStats) {
+        ConnectionMetrics sender, receiver;
+        client.metricsRegistry().total(sender);
+        server.metricsRegistry().total(receiver);
+
+        Totals current;
+        current.sentBytes = sender.payloadBytes.value();
+        current.receivedBytes = receiver.payloadBytes.value();
+        current.retransmits = sender.retransmits.value();
+        current.rtos = sender.rtoFirings.value();
+        current.lost = upStats.lost + downStats.lost;
+        current.queueDrops = upStats.queueDrops + downStats.queueDrops;
+
+        const char *format = csv ? "%.3f,%.1f,%.1f,%lu,%lu,%ld,%lu,%lu\n" : "%9.3f %10.1f %13.1f %11lu %6lu %7ld %6lu %11lu\n";
+        printf(format, (now - SIM_START_US) / 1e6, mbps(current.sentBytes - last.sentBytes, intervalUs),
+               mbps(current.receivedBytes - last.receivedBytes, intervalUs), current.retransmits - last.retransmits,
+               current.rtos - last.rtos, sender.windowOccupancy.value(), current.lost - last.lost, current.queueDrops - last.queueDrops);
+        fflush(stdout);
+        last = current;
+    });
+
+    auto wallStarted = chrono::steady_clock::now();
+    thread serverThread([&]() {
+        server.runConnection(link.transport(SIM_SERVER));
+        link.leave(SIM_SERVER);
+    });
+    client.runConnection(link.transport(SIM_CLIENT));
+    link.leave(SIM_CLIENT);
+    serverThread.join();
+    double wallMs = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - wallStarted).count() / 1e3;
+
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    ConnectionMetrics sender, receiver;
+    client.metricsRegistry().total(sender);
+    server.metricsRegistry().total(receiver);
+    DirectionStats upStats = link.stats(SIM_CLIENT), downStats = link.stats(SIM_SERVER);
+    int64_t elapsedUs = link.elapsedUs(SIM_START_US);
+
+    printf("\n%s after %.3f s of simulated time: %lu payload bytes received for a %lu byte file, %.1f Mbps goodput\n",
+           receiver.payloadBytes.value() >= fileBytes ? "Transferred" : "Stopped", elapsedUs / 1e6, receiver.payloadBytes.value(),
+           fileBytes, mbps(receiver.payloadBytes.value(), elapsedUs));
+    printf("%lu packets sent, %lu resent, %lu RTOs; ACK latency p50 %lu us, p99 %lu us\n", sender.pktsSent.value(),
+            sender.retransmits.value(), sender.rtoFirings.value(), sender.ackLatencyUs.quantile(0.5), sender.ackLatencyUs.quantile(0.99));
+    printf("Link: %lu frames up (%lu lost, %lu dropped by the queue), %lu frames down (%lu lost, %lu dropped by the queue)\n",
+           upStats.frames, upStats.lost, upStats.queueDrops, downStats.frames, downStats.lost, downStats.queueDrops);
+    printf("Ran in %.0f ms of CPU time, %.0f ms of wall time; %.1fx real time\n", cpuMs(usage), wallMs,
+            wallMs > 0 ? elapsedUs / 1e3 / wallMs : 0);
+    if (link.wasStalled()) printf("Both ends ended up waiting on each other, so the transfer was cut short\n");
+    fclose(log);
+
+    return 0;
+}
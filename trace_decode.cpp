@@ -0,0 +1,272 @@
+//
+// Created on 10/19/26.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ConnectionSettings.h"
+#include "Trace.h"
+
+using namespace std;
+
+enum OutputFormat {
+    TABLE, CSV
+};
+
+// A record together with the trace it came from and the connection it belongs to
+struct DecodedRecord {
+    TraceRecord record;
+    string role;
+    unsigned int connection; // counted from the first connection in its trace
+};
+
+// Key of one packet across the client's and the server's traces
+struct PacketKey {
+    unsigned int connection;
+    uint16_t fileId;
+    uint64_t sqn;
+
+    bool operator<(const PacketKey &other) const {
+        if (connection != other.connection) return connection < other.connection;
+        if (fileId != other.fileId) return fileId < other.fileId;
+        return sqn < other.sqn;
+    }
+};
+
+struct PacketTimeline {
+    uint64_t firstSent = 0, lastSent = 0; // ns; 0 until it happens
+    uint64_t lastReceived = 0, firstReceived = 0; // at the server; the first is of a copy that arrived intact
+    uint64_t acked = 0; // the ACK covering it reached the client
+    unsigned int sends = 0, lost = 0, damaged = 0, rtos = 0, receives = 0, chksumFailures = 0;
+};
+
+static bool readTrace(const string &path, vector<DecodedRecord> &records) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Unable to open %s\n", path.c_str());
+        return false;
+    }
+
+    TraceFileHeader header{};
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+            header.version != TRACE_VERSION || header.recordSize != sizeof(TraceRecord)) {
+        fprintf(stderr, "%s isn't a trace this decoder reads\n", path.c_str());
+        fclose(file);
+        return false;
+    }
+
+    string role(header.role, strnlen(header.role, sizeof(header.role)));
+    vector<TraceRecord> raw(header.records);
+    raw.resize(fread(raw.data(), sizeof(TraceRecord), raw.size(), file));
+    fclose(file);
+    if (raw.size() != header.records) fprintf(stderr, "%s is truncated; decoding the %lu records read\n", path.c_str(), raw.size());
+
+    // Each thread's ring is written oldest first, so the trace is put back in time order before numbering connections
+    stable_sort(raw.begin(), raw.end(), [](const TraceRecord &a, const TraceRecord &b) { return a.time < b.time; });
+    unsigned int connection = 0;
+    bool opened = false;
+    for (const TraceRecord &record : raw) {
+        if (record.event == TRACE_CONNECTION_OPENED) {
+            if (opened) connection++;
+            opened = true;
+        }
+        records.push_back({record, role, connection});
+    }
+
+    return true;
+}
+
+static void printTimeline(const vector<DecodedRecord> &records, OutputFormat format, bool filterSqn, uint64_t sqn, const string &event) {
+    if (records.empty()) return;
+    uint64_t start = records.front().record.time;
+
+    if (format == CSV) printf("time_us,role,connection,thread,file,event,sqn,value\n");
+    for (const DecodedRecord &decoded : records) {
+        const TraceRecord &record = decoded.record;
+        if (filterSqn && record.sqn != sqn) continue;
+        if (!event.empty() && event != Tracer::eventName(record.event)) continue;
+
+        double time = (record.time - start) / 1e3;
+        if (format == CSV) {
+            printf("%.3f,%s,%u,%u,%u,%s,%lu,%u\n", time, decoded.role.c_str(), decoded.connection, record.thread, record.fileId,
+                   Tracer::eventName(record.event), record.sqn, record.value);
+        } else {
+            printf("%14.3f us  %-6s c%-2u t%-2u f%-3u %-18s sqn %-10lu %u\n", time, decoded.role.c_str(), decoded.connection,
+                   record.thread, record.fileId, Tracer::eventName(record.event), record.sqn, record.value);
+        }
+    }
+}
+
+// Rebuilds each packet's history from the events of both ends: when it was sent and how often, what befell it, when the
+// server had it and when its ACK got back
+static map<PacketKey, PacketTimeline> packetTimelines(const vector<DecodedRecord> &records) {
+    map<unsigned int, uint64_t> protocols; // the protocol each connection settled on, from its close
+    for (const DecodedRecord &decoded : records) {
+        if (decoded.record.event == TRACE_CONNECTION_CLOSED) protocols[decoded.connection] = decoded.record.sqn;
+    }
+
+    map<PacketKey, PacketTimeline> packets;
+    map<pair<unsigned int, uint16_t>, set<uint64_t>> unacked; // sent and not yet ACK'd, per connection and file
+    for (const DecodedRecord &decoded : records) {
+        const TraceRecord &record = decoded.record;
+        PacketKey key{decoded.connection, record.fileId, record.sqn};
+        bool client = decoded.role == "client";
+
+        switch (record.event) {
+            case TRACE_PKT_SENT:
+            case TRACE_PKT_RESENT: {
+                if (!client) break;
+                PacketTimeline &packet = packets[key];
+                if (packet.firstSent == 0) packet.firstSent = record.time;
+                packet.lastSent = record.time;
+                packet.sends++;
+                unacked[{decoded.connection, record.fileId}].insert(record.sqn);
+                break;
+            }
+            case TRACE_PKT_LOST:
+                packets[key].lost++;
+                break;
+            case TRACE_PKT_DAMAGED:
+                packets[key].damaged++;
+                break;
+            case TRACE_RTO_FIRED:
+                packets[key].rtos++;
+                break;
+            case TRACE_PKT_RECEIVED:
+                if (!client) {
+                    packets[key].receives++;
+                    packets[key].lastReceived = record.time;
+                }
+                break;
+            case TRACE_CHKSUM_FAILED:
+                if (!client) packets[key].chksumFailures++;
+                break;
+            case TRACE_ACK_SENT: {
+                // The server only ACKs a packet that arrived intact, so the copy it last received was
+                auto found = packets.find(key);
+                if (!client && found != packets.end() && found->second.firstReceived == 0) {
+                    found->second.firstReceived = found->second.lastReceived;
+                }
+                break;
+            }
+            case TRACE_ACK_RECEIVED: {
+                if (!client) break;
+
+                // Go-Back-N ACKs are cumulative; Selective Repeat ACKs cover the one packet
+                set<uint64_t> &outstanding = unacked[{decoded.connection, record.fileId}];
+                auto last = protocols[decoded.connection] == GBN ? outstanding.upper_bound(record.sqn) : outstanding.find(record.sqn);
+                auto first = protocols[decoded.connection] == GBN ? outstanding.begin() : last;
+                if (protocols[decoded.connection] != GBN) {
+                    if (last == outstanding.end()) break;
+                    last++;
+                }
+                for (auto it = first; it != last; it++) {
+                    packets[{decoded.connection, record.fileId, *it}].acked = record.time;
+                }
+                outstanding.erase(first, last);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return packets;
+}
+
+static void printPackets(const vector<DecodedRecord> &records, OutputFormat format) {
+    if (records.empty()) return;
+    uint64_t start = records.front().record.time;
+    map<PacketKey, PacketTimeline> packets = packetTimelines(records);
+
+    auto since = [start](uint64_t time) { return time == 0 ? -1.0 : (time - start) / 1e3; };
+    uint64_t resent = 0, lost = 0, damaged = 0, acked = 0, latencySum = 0, latencyMax = 0;
+
+    if (format == CSV) {
+        printf("connection,file,sqn,sent_us,sends,lost,damaged,rtos,received_us,acked_us,ack_latency_us\n");
+    } else {
+        printf("%-4s %-5s %-10s %14s %5s %4s %7s %4s %14s %14s %12s\n", "conn", "file", "sqn", "sent (us)", "sends", "lost",
+               "damaged", "rtos", "received (us)", "acked (us)", "latency (us)");
+    }
+
+    for (const auto &entry : packets) {
+        const PacketKey &key = entry.first;
+        const PacketTimeline &packet = entry.second;
+        if (packet.sends == 0 && packet.receives == 0) continue;
+
+        // Latency of the send that got through, so resent packets aren't charged for the ones that didn't
+        double latency = packet.acked != 0 && packet.lastSent != 0 ? (packet.acked - packet.lastSent) / 1e3 : -1;
+        if (packet.sends > 1) resent += packet.sends - 1;
+        lost += packet.lost;
+        damaged += packet.damaged;
+        if (latency >= 0) {
+            acked++;
+            latencySum += (uint64_t) latency;
+            latencyMax = max(latencyMax, (uint64_t) latency);
+        }
+
+        if (format == CSV) {
+            printf("%u,%u,%lu,%.3f,%u,%u,%u,%u,%.3f,%.3f,%.3f\n", key.connection, key.fileId, key.sqn, since(packet.firstSent),
+                   packet.sends, packet.lost, packet.damaged, packet.rtos, since(packet.firstReceived), since(packet.acked), latency);
+        } else {
+            printf("%-4u %-5u %-10lu %14.3f %5u %4u %7u %4u %14.3f %14.3f %12.3f\n", key.connection, key.fileId, key.sqn,
+                   since(packet.firstSent), packet.sends, packet.lost, packet.damaged, packet.rtos, since(packet.firstReceived),
+                   since(packet.acked), latency);
+        }
+    }
+
+    if (format == TABLE) {
+        printf("\n%lu packets, %lu resends, %lu lost, %lu damaged; ACK latency mean %.0f us, max %lu us (-1: never happened)\n",
+               packets.size(), resent, lost, damaged, acked > 0 ? (double) latencySum / acked : 0.0, latencyMax);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    OutputFormat format = TABLE;
+    bool packets = false, filterSqn = false;
+    uint64_t sqn = 0;
+    string event;
+    vector<string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            format = CSV;
+        } else if (strcmp(argv[i], "--packets") == 0) {
+            packets = true;
+        } else if (strcmp(argv[i], "--sqn") == 0 && i + 1 < argc) {
+            filterSqn = true;
+            sqn = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--event") == 0 && i + 1 < argc) {
+            event = argv[++i];
+        } else if (argv[i][0] != '-') {
+            paths.push_back(argv[i]);
+        } else {
+            paths.clear();
+            break;
+        }
+    }
+
+    if (paths.empty()) {
+        fprintf(stderr, "Usage: %s [--packets] [--csv] [--sqn n] [--event name] trace... (e.g. the client's and the server's)\n", argv[0]);
+        return -1;
+    }
+
+    vector<DecodedRecord> records;
+    for (const string &path : paths) {
+        if (!readTrace(path, records)) return -1;
+    }
+
+    // Both ends read the same steady clock, so traces from one host interleave as they happened
+    stable_sort(records.begin(), records.end(), [](const DecodedRecord &a, const DecodedRecord &b) { return a.record.time < b.record.time; });
+
+    if (packets) printPackets(records, format);
+    else printTimeline(records, format, filterSqn, sqn, event);
+
+    return 0;
+}